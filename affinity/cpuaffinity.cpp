@@ -0,0 +1,186 @@
+#include "cpuaffinity.h"
+
+#include <dirent.h>
+
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#include "../log/log.h"
+
+static std::string trim(const std::string &s) {
+    size_t begin = s.find_first_not_of(" \t\r");
+    if (begin == std::string::npos) {
+        return "";
+    }
+    size_t end = s.find_last_not_of(" \t\r");
+    return s.substr(begin, end - begin + 1);
+}
+
+bool CpuAffinity::load(const std::string &path) {
+    reactors_.clear();
+    workers_.clear();
+    io_.clear();
+    log_.clear();
+
+    std::ifstream in(path);
+    if (!in) {
+        LOG_ERROR("Open topology config %s error!", path.c_str());
+        return false;
+    }
+    std::string line;
+    int lineNo = 0;
+    while (std::getline(in, line)) {
+        lineNo++;
+        line = trim(line.substr(0, line.find('#')));
+        if (line.empty()) {
+            continue;
+        }
+        size_t eq = line.find('=');
+        std::vector<int> *cpus = nullptr;
+        std::string key = eq == std::string::npos ? "" : trim(line.substr(0, eq));
+        if (key == "reactor") {
+            cpus = &reactors_;
+        } else if (key == "worker") {
+            cpus = &workers_;
+        } else if (key == "io") {
+            cpus = &io_;
+        } else if (key == "log") {
+            cpus = &log_;
+        }
+        if (!cpus || !parseValue_(trim(line.substr(eq + 1)), cpus)) {
+            LOG_ERROR("Topology config %s:%d invalid: %s", path.c_str(), lineNo, line.c_str());
+            reactors_.clear();
+            workers_.clear();
+            io_.clear();
+            log_.clear();
+            return false;
+        }
+    }
+    return true;
+}
+
+int CpuAffinity::reactorCpu(size_t i) const {
+    return reactors_.empty() ? -1 : reactors_[i % reactors_.size()];
+}
+
+int CpuAffinity::workerCpu(size_t i) const {
+    return workers_.empty() ? -1 : workers_[i % workers_.size()];
+}
+
+const std::vector<int> &CpuAffinity::workerCpus() const {
+    return workers_;
+}
+
+const std::vector<int> &CpuAffinity::ioCpus() const {
+    return io_;
+}
+
+const std::vector<int> &CpuAffinity::logCpus() const {
+    return log_;
+}
+
+bool CpuAffinity::parseCpuList(const std::string &str, std::vector<int> *cpus) {
+    // 形如 "0-3,8,10-11"
+    std::stringstream ss(str);
+    std::string item;
+    bool any = false;
+    while (std::getline(ss, item, ',')) {
+        item = trim(item);
+        if (item.empty()) {
+            continue;
+        }
+        char *end = nullptr;
+        long first = strtol(item.c_str(), &end, 10);
+        long last = first;
+        if (*end == '-') {
+            last = strtol(end + 1, &end, 10);
+        }
+        if (*end != '\0' || first < 0 || last < first || last >= CPU_SETSIZE) {
+            return false;
+        }
+        for (long cpu = first; cpu <= last; cpu++) {
+            cpus->push_back(static_cast<int>(cpu));
+        }
+        any = true;
+    }
+    return any;
+}
+
+bool CpuAffinity::nodeCpus(int node, std::vector<int> *cpus) {
+    std::ifstream in("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+    std::string list;
+    if (!in || !std::getline(in, list)) {
+        return false;
+    }
+    return parseCpuList(trim(list), cpus);
+}
+
+int CpuAffinity::cpuNode(int cpu) {
+    // /sys/devices/system/cpu/cpuN/ 下有一个 nodeM 目录
+    std::string dir = "/sys/devices/system/cpu/cpu" + std::to_string(cpu);
+    DIR *dp = opendir(dir.c_str());
+    if (!dp) {
+        return 0;
+    }
+    int node = 0;
+    while (struct dirent *entry = readdir(dp)) {
+        if (strncmp(entry->d_name, "node", 4) == 0 && isdigit(static_cast<unsigned char>(entry->d_name[4]))) {
+            node = atoi(entry->d_name + 4);
+            break;
+        }
+    }
+    closedir(dp);
+    return node;
+}
+
+bool CpuAffinity::pinThread(pthread_t tid, const std::vector<int> &cpus) {
+    if (cpus.empty()) {
+        return true;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus) {
+        CPU_SET(cpu, &set);
+    }
+    int ret = pthread_setaffinity_np(tid, sizeof(set), &set);
+    if (ret != 0) {
+        LOG_WARN("Set thread affinity error: %s", strerror(ret));
+        return false;
+    }
+    return true;
+}
+
+bool CpuAffinity::pinThread(const std::vector<int> &cpus) {
+    return pinThread(pthread_self(), cpus);
+}
+
+bool CpuAffinity::pinThread(int cpu) {
+    if (cpu < 0) {
+        return true;
+    }
+    return pinThread(std::vector<int>{cpu});
+}
+
+bool CpuAffinity::parseValue_(const std::string &value, std::vector<int> *cpus) {
+    /* 逗号分隔, 每项是 cpu、cpu 区间或 node:N */
+    std::stringstream ss(value);
+    std::string item;
+    bool any = false;
+    while (std::getline(ss, item, ',')) {
+        item = trim(item);
+        if (item.compare(0, 5, "node:") == 0) {
+            char *end = nullptr;
+            long node = strtol(item.c_str() + 5, &end, 10);
+            if (*end != '\0' || node < 0 || !nodeCpus(static_cast<int>(node), cpus)) {
+                return false;
+            }
+        } else if (!parseCpuList(item, cpus)) {
+            return false;
+        }
+        any = true;
+    }
+    return any;
+}
@@ -0,0 +1,50 @@
+#ifndef CPU_AFFINITY_H
+#define CPU_AFFINITY_H
+
+#include <pthread.h>
+#include <sched.h>
+
+#include <string>
+#include <vector>
+
+/*
+ * 线程的 CPU 绑定配置, 从 topology 配置文件读取 (示例见 topology.example.conf)
+ * 每行 "键 = cpu 列表", 列表格式同 /sys/devices/system/cpu/online (如 0-3,8),
+ * 也可以写 node:N, 表示 NUMA 节点 N 的全部 cpu (读 /sys/devices/system/node/nodeN/cpulist)
+ *   reactor  第 i 个 Reactor 绑定到列表中第 i 个 cpu (循环使用)
+ *   worker   CPU 通道第 i 个工作线程绑定到列表中第 i 个 cpu (循环使用)
+ *   io       IO 通道(阻塞的用户存储)第 i 个线程绑定到列表中第 i 个 cpu (循环使用), 与 worker 分开, 等数据库的线程不占热路径的核
+ *   log      异步日志写线程, 可以在列表中任意 cpu 上运行
+ * 没有配置的线程不绑定
+ * 内存的节点归属靠绑核后的 first-touch, 不显式按节点分配: 连接缓冲区的块(ChunkPool)在一个线程取、另一个线程还时
+ * 会进入还的线程的池, 连接槽(ConnSlab)的页由所有 Reactor 共用; 所以 worker 要和它服务的 reactor 配在同一节点
+ */
+class CpuAffinity {
+public:
+    bool load(const std::string &path);  // 文件不存在或格式错误时返回 false, 已读到的配置清空
+
+    int reactorCpu(size_t i) const;  // 不绑定时返回 -1
+    int workerCpu(size_t i) const;
+    const std::vector<int> &workerCpus() const;
+    const std::vector<int> &ioCpus() const;
+    const std::vector<int> &logCpus() const;
+
+    static bool parseCpuList(const std::string &str, std::vector<int> *cpus);
+    static bool nodeCpus(int node, std::vector<int> *cpus);
+    static int cpuNode(int cpu);  // cpu 所在的 NUMA 节点, 没有 NUMA 信息时返回 0
+
+    /* 绑定线程, 列表为空或 cpu < 0 时什么也不做 */
+    static bool pinThread(pthread_t tid, const std::vector<int> &cpus);
+    static bool pinThread(const std::vector<int> &cpus);
+    static bool pinThread(int cpu);
+
+private:
+    static bool parseValue_(const std::string &value, std::vector<int> *cpus);
+
+    std::vector<int> reactors_;
+    std::vector<int> workers_;
+    std::vector<int> io_;
+    std::vector<int> log_;
+};
+
+#endif  // CPU_AFFINITY_H
@@ -0,0 +1,77 @@
+#include "buffer.h"
+
+namespace baseline {
+
+Buffer::Buffer(int bufferSize) : buff_(bufferSize), readPos_(0), writePos_(0) {
+}
+
+size_t Buffer::readableBytes() const {
+    return writePos_ - readPos_;
+}
+
+size_t Buffer::writableBytes() const {
+    return buff_.size() - writePos_;
+}
+
+size_t Buffer::prependableBytes() const {
+    return readPos_;
+}
+
+const char *Buffer::peek() const {
+    return beginPtr_() + readPos_;
+}
+
+void Buffer::retrieve(size_t len) {
+    assert(len <= readableBytes());
+    readPos_ += len;
+}
+
+void Buffer::retrieveAll() {
+    bzero(beginPtr_(), buff_.size());
+    readPos_ = 0;
+    writePos_ = 0;
+}
+
+void Buffer::hasWritten(size_t len) {
+    writePos_ += len;
+}
+
+char *Buffer::beginWrite() {
+    return beginPtr_() + writePos_;
+}
+
+void Buffer::ensureWriteable(size_t len) {
+    if (writableBytes() < len) {
+        makeSpace_(len);
+    }
+    assert(writableBytes() >= len);
+}
+
+void Buffer::append(const char *data, size_t len) {
+    assert(len > 0);
+    ensureWriteable(len);
+    std::copy(data, data + len, beginWrite());
+    hasWritten(len);
+}
+
+char *Buffer::beginPtr_() {
+    return buff_.data();
+}
+
+const char *Buffer::beginPtr_() const {
+    return buff_.data();
+}
+
+void Buffer::makeSpace_(size_t len) {
+    if (prependableBytes() + writableBytes() < len) {
+        buff_.resize(writePos_ + len + 1);
+    } else {
+        size_t readabel = readableBytes();
+        std::copy(beginPtr_() + readPos_, beginPtr_() + writePos_, beginPtr_());
+        readPos_ = 0;
+        writePos_ = readabel;
+        assert(readabel == readableBytes());
+    }
+}
+
+}  // namespace baseline
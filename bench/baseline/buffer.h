@@ -0,0 +1,51 @@
+#ifndef BASELINE_BUFFER_H
+#define BASELINE_BUFFER_H
+
+#include <atomic>
+#include <cassert>
+#include <cstring>
+#include <string>
+#include <vector>
+
+/*
+ * 改用 ChunkPool 之前的缓冲区: 构造时就分配 std::vector<char>, 只增不减, 连接关闭后仍留在连接对象里
+ * 只用于基准测试对比, 去掉了 readFd/writeFd, 内存管理部分与原实现相同
+ */
+namespace baseline {
+
+class Buffer {
+public:
+    Buffer(int bufferSize = 1024);
+    ~Buffer() = default;
+
+    size_t readableBytes() const;
+    size_t writableBytes() const;
+    size_t prependableBytes() const;
+
+    const char *peek() const;
+
+    void retrieve(size_t len);
+    void retrieveAll();
+
+    void hasWritten(size_t len);
+
+    char *beginWrite();
+    void ensureWriteable(size_t len);
+
+    void append(const char *data, size_t len);
+    size_t capacity() const { return buff_.capacity(); }
+
+private:
+    char *beginPtr_();
+    const char *beginPtr_() const;
+    void makeSpace_(size_t len);
+
+private:
+    std::vector<char> buff_;
+    std::atomic<size_t> readPos_;
+    std::atomic<size_t> writePos_;
+};
+
+}  // namespace baseline
+
+#endif  // BASELINE_BUFFER_H
@@ -1,6 +1,6 @@
 #include "heaptimer.h"
 
-#include <iostream>
+namespace baseline {
 
 HeapTimer::HeapTimer() {
     heap_.reserve(64);
@@ -11,21 +11,12 @@ HeapTimer::~HeapTimer() {
 }
 
 void HeapTimer::adjust(int id, int timeout) {  // 调整指定的id节点
-    // for (auto& node : heap_) {
-    //     printf("node.id = %d\n", node.id);
-    // }
-    // for (auto& [id, index] : ref_) {
-    //     printf("{%d,%ld} ", id, index);
-    // }
-    // printf("\n");
-
     assert(!heap_.empty() && ref_.count(id) > 0);
     heap_[ref_[id]].expires = Clock::now() + MS(timeout);
     siftdown_(ref_[id], heap_.size());
 }
 
 void HeapTimer::add(int id, int timeout, const TimeoutCallBack& cb) {
-    //printf("HeapTimer::add() fd = %d\n", id);
     assert(id >= 0);
     size_t i;
     if (ref_.count(id) == 0) {  // 插入新节点
@@ -43,16 +34,6 @@ void HeapTimer::add(int id, int timeout, const TimeoutCallBack& cb) {
     }
 }
 
-void HeapTimer::doWork(int id) {
-    if (heap_.empty() || ref_.count(id) == 0) {
-        return;
-    }
-    size_t i = id;
-    TimerNode node = heap_[i];
-    node.cb();
-    del_(i);
-}
-
 void HeapTimer::clear() {
     ref_.clear();
     heap_.clear();
@@ -91,9 +72,8 @@ int HeapTimer::getNextTick() {
 
 void HeapTimer::del_(size_t i) {
     // 删除指定节点
-    assert(!heap_.empty() && i >= 0 && i < heap_.size());
+    assert(!heap_.empty() && i < heap_.size());
     size_t n = heap_.size() - 1;
-    assert(i <= n);
     if (i < n) {
         swapNode_(i, n);
         if (!siftdown_(i, n)) {
@@ -105,21 +85,20 @@ void HeapTimer::del_(size_t i) {
 }
 
 void HeapTimer::siftup_(size_t i) {
-    assert(i >= 0 && i < heap_.size());
-    size_t j = (i - 1) / 2;  // 父节点下标
-    while (j >= 0) {
+    assert(i < heap_.size());
+    while (i > 0) {
+        size_t j = (i - 1) / 2;  // 父节点下标
         if (heap_[j] < heap_[i]) {
             break;
         }
         swapNode_(i, j);
         i = j;
-        j = (i - 1) / 2;
     }
 }
 
 bool HeapTimer::siftdown_(size_t index, size_t n) {
-    assert(index >= 0 && index < heap_.size());
-    assert(n >= 0 && n <= heap_.size());
+    assert(index < heap_.size());
+    assert(n <= heap_.size());
     size_t i = index;
     size_t j = i * 2 + 1;  // 子节点下标
     while (j < n) {
@@ -137,9 +116,11 @@ bool HeapTimer::siftdown_(size_t index, size_t n) {
 }
 
 void HeapTimer::swapNode_(size_t i, size_t j) {
-    assert(i >= 0 && j < heap_.size());
-    assert(j >= 0 && j < heap_.size());
+    assert(i < heap_.size());
+    assert(j < heap_.size());
     std::swap(heap_[i], heap_[j]);
     ref_[heap_[i].id] = i;
     ref_[heap_[j].id] = j;
-}
\ No newline at end of file
+}
+
+}  // namespace baseline
@@ -1,5 +1,5 @@
-#ifndef HEAP_TIMER_H
-#define HEAP_TIMER_H
+#ifndef BASELINE_HEAP_TIMER_H
+#define BASELINE_HEAP_TIMER_H
 
 #include <cassert>
 #include <chrono>
@@ -7,6 +7,12 @@
 #include <unordered_map>
 #include <vector>
 
+/*
+ * 改用时间轮之前的小根堆定时器, 只用于基准测试对比
+ * 放在 baseline 命名空间里, 避免与 TimingWheel 的 TimerNode 重名; 修正了 siftup_ 在堆顶时的越界, 其余与原实现相同
+ */
+namespace baseline {
+
 using TimeoutCallBack = std::function<void()>;
 using Clock = std::chrono::high_resolution_clock;
 using MS = std::chrono::milliseconds;
@@ -28,12 +34,12 @@ public:
 
     void adjust(int id, int timeout);
     void add(int id, int timeout, const TimeoutCallBack& cb);
-    void doWork(int id);
     void clear();
     void tick();
     void pop();
 
     int getNextTick();
+    size_t size() const { return heap_.size(); }
 
 private:
     void del_(size_t i);
@@ -46,4 +52,6 @@ private:
     std::unordered_map<int, size_t> ref_;  // id到vector下标索引
 };
 
-#endif  // HEAP_TIMER_H
\ No newline at end of file
+}  // namespace baseline
+
+#endif  // BASELINE_HEAP_TIMER_H
@@ -0,0 +1,59 @@
+#ifndef BASELINE_HTTP_REQUEST_H
+#define BASELINE_HTTP_REQUEST_H
+
+#include <regex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "../../buffer/buffer.h"
+#include "../../log/log.h"
+
+/*
+ * 改成状态机解析之前的按行 std::regex 解析, 只用于基准测试对比
+ * 去掉了登录/注册时直连 MySQL 的 userVerify, 解析部分与原实现相同
+ */
+namespace baseline {
+
+class HttpRequest {
+public:
+    enum PARSE_STATE {
+        REQUEST_LINE,
+        HEADERS,
+        BODY,
+        FINISH,
+    };
+    HttpRequest() { init(); }
+    ~HttpRequest() = default;
+
+    void init();
+    bool parse(Buffer &buff);
+
+    std::string path() const;
+    std::string method() const;
+    std::string version() const;
+    std::string getPost(const std::string &key) const;
+
+    bool isKeepAlive() const;
+
+private:
+    bool parseRequestLine_(const std::string &line);
+    void parseHeader_(const std::string &line);
+    void parseBody_(const std::string &line);
+
+    void parsePath_();
+    void parsePost_();
+    void parseFromUrlencoded_();
+
+    PARSE_STATE state_;
+    std::string method_, path_, version_, body_;
+    std::unordered_map<std::string, std::string> header_;
+    std::unordered_map<std::string, std::string> post_;
+
+    static const std::unordered_set<std::string> DEFAULT_HTML;
+    static int converHex(char ch);
+};
+
+}  // namespace baseline
+
+#endif  // BASELINE_HTTP_REQUEST_H
@@ -0,0 +1,46 @@
+#ifndef BASELINE_THREADPOOL_H
+#define BASELINE_THREADPOOL_H
+
+#include <cassert>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+
+/* 改成工作窃取之前的线程池: 一把锁保护一个 std::queue<std::function>, 只用于基准测试对比 */
+namespace baseline {
+
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t threadNum = 8);
+    ThreadPool() = default;
+    ThreadPool(ThreadPool &&) = default;
+    ~ThreadPool();
+
+    template <typename T>
+    void addTask(T &&task);
+
+private:
+    struct Pool {
+        std::queue<std::function<void()>> tasks;
+        std::mutex mtx;
+        std::condition_variable cond;
+        bool isClose;
+    };
+    std::shared_ptr<Pool> pool_;
+};
+
+template <typename T>
+void ThreadPool::addTask(T &&task) {
+    {
+        std::lock_guard<std::mutex> locker(pool_->mtx);
+        pool_->tasks.emplace(std::forward<T>(task));  // 这里使用完美转发
+    }
+    pool_->cond.notify_one();
+}
+
+}  // namespace baseline
+
+#endif  // BASELINE_THREADPOOL_H
@@ -0,0 +1,51 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+/*
+ * 性能基准, 每项一个函数, 在 main.cpp 的表里登记, 结果以表格打印到标准输出
+ * 对比的旧实现在 baseline/ 下, 是改动之前的代码, 只在这里编译
+ * 数字只在同一台机器的两次运行之间有比较意义; 绑核、关掉 CPU 调频后更稳定
+ */
+namespace bench {
+
+using Clock = std::chrono::steady_clock;
+
+inline double elapsedNs(Clock::time_point start) {
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+}
+
+/* 排好序的样本的分位数, q 取 0~1 */
+inline double percentile(const std::vector<double> &sorted, double q) {
+    if (sorted.empty()) {
+        return 0;
+    }
+    size_t i = static_cast<size_t>(q * (sorted.size() - 1) + 0.5);
+    return sorted[std::min(i, sorted.size() - 1)];
+}
+
+/* 简单的 xorshift, 各项基准的随机输入可复现 */
+inline uint32_t nextRand(uint32_t *seed) {
+    uint32_t x = *seed;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *seed = x;
+}
+
+}  // namespace bench
+
+void benchTimer();
+void benchThreadPool();
+void benchParser();
+void benchSendfile();
+void benchChunkPool();
+void benchLatency();
+void benchSyscalls();
+
+#endif  // BENCH_H
@@ -0,0 +1,125 @@
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#include <memory>
+#include <string>
+
+#include "../buffer/buffer.h"
+#include "baseline/buffer.h"
+#include "bench.h"
+
+/*
+ * 连接反复建立和关闭时缓冲区占用的内存, 两种缓冲区各在一个子进程里跑同一串操作, RSS 和缺页互不干扰:
+ *   ChunkPool  现在的 Buffer, 第一次写入才取块, 连接关闭时 release() 还给内存池
+ *   vector     改动前的 Buffer, 构造即分配, 只增不减, 连接槽一直持有
+ * SLOTS 个连接槽, 每轮随机挑一个处理一个请求(读缓冲收请求, 写缓冲放响应头), 之后以 1/CLOSE_EVERY 的概率关闭
+ * 请求大小按 94% 的 400B, 5% 的 16KB, 1% 的 256KB 分布, 大请求会把缓冲区撑大
+ * 报告耗时、结束时和峰值的 RSS、期间的次缺页数, 以及全部连接关闭后的 RSS
+ */
+namespace {
+const int SLOTS = 10000;
+const int ROUNDS = 300000;
+const int CLOSE_EVERY = 8;
+
+struct Result {
+    double ms;
+    double rssMb;
+    double peakMb;
+    double idleMb;
+    long minorFaults;
+};
+
+double rssMb() {
+    long pages = 0, resident = 0;
+    FILE *fp = fopen("/proc/self/statm", "r");
+    if (fp) {
+        if (fscanf(fp, "%ld %ld", &pages, &resident) != 2) {
+            resident = 0;
+        }
+        fclose(fp);
+    }
+    return resident * sysconf(_SC_PAGESIZE) / double(1 << 20);
+}
+
+size_t requestSize(uint32_t *seed) {
+    uint32_t r = bench::nextRand(seed) % 100;
+    return r < 94 ? 400 : r < 99 ? 16 << 10 : 256 << 10;
+}
+
+template <typename Buf, typename Close>
+Result churn(Close closeConn) {
+    std::string payload(256 << 10, 'x');
+    const char HEADER[] = "HTTP/1.1 200 OK\r\nConnection: keep-alive\r\nContent-type: text/html\r\nContent-length: 3000\r\n\r\n";
+    std::unique_ptr<Buf[]> readBuffs(new Buf[SLOTS]);
+    std::unique_ptr<Buf[]> writeBuffs(new Buf[SLOTS]);
+    uint32_t seed = 7;
+
+    struct rusage before, after;
+    getrusage(RUSAGE_SELF, &before);
+    auto start = bench::Clock::now();
+    for (int i = 0; i < ROUNDS; i++) {
+        int slot = bench::nextRand(&seed) % SLOTS;
+        readBuffs[slot].append(payload.data(), requestSize(&seed));
+        readBuffs[slot].retrieveAll();
+        writeBuffs[slot].append(HEADER, sizeof(HEADER) - 1);
+        writeBuffs[slot].retrieveAll();
+        if (bench::nextRand(&seed) % CLOSE_EVERY == 0) {
+            closeConn(&readBuffs[slot], &writeBuffs[slot]);
+        }
+    }
+    Result res;
+    res.ms = bench::elapsedNs(start) / 1e6;
+    getrusage(RUSAGE_SELF, &after);
+    res.minorFaults = after.ru_minflt - before.ru_minflt;
+    res.rssMb = rssMb();
+    res.peakMb = after.ru_maxrss / 1024.0;
+    for (int i = 0; i < SLOTS; i++) {
+        closeConn(&readBuffs[i], &writeBuffs[i]);
+    }
+    res.idleMb = rssMb();
+    return res;
+}
+
+/* 在子进程里运行, 结果经管道传回 */
+template <typename Run>
+bool inChild(Run run, Result *res) {
+    int fds[2];
+    if (pipe(fds) < 0) {
+        return false;
+    }
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(fds[0]);
+        Result r = run();
+        ssize_t n = write(fds[1], &r, sizeof(r));
+        _exit(n == sizeof(r) ? 0 : 1);
+    }
+    close(fds[1]);
+    bool ok = pid > 0 && read(fds[0], res, sizeof(*res)) == sizeof(*res);
+    close(fds[0]);
+    if (pid > 0) {
+        waitpid(pid, nullptr, 0);
+    }
+    return ok;
+}
+}  // namespace
+
+void benchChunkPool() {
+    printf("%d connection slots, %d requests, 1/%d closed after each request\n", SLOTS, ROUNDS, CLOSE_EVERY);
+    printf("%-10s %9s %9s %9s %9s %12s\n", "buffer", "ms", "RSS MB", "peak MB", "idle MB", "minor faults");
+    Result pool, vec;
+    bool ok = inChild([] { return churn<Buffer>([](Buffer *r, Buffer *w) {
+                              r->release();
+                              w->release();
+                          }); },
+                      &pool);
+    // 改动前关闭连接不动缓冲区, 下一个连接复用这个槽时 init() 才清空
+    ok = ok && inChild([] { return churn<baseline::Buffer>([](baseline::Buffer *, baseline::Buffer *) {}); }, &vec);
+    if (!ok) {
+        printf("child failed\n");
+        return;
+    }
+    printf("%-10s %9.0f %9.1f %9.1f %9.1f %12ld\n", "vector", vec.ms, vec.rssMb, vec.peakMb, vec.idleMb, vec.minorFaults);
+    printf("%-10s %9.0f %9.1f %9.1f %9.1f %12ld\n", "ChunkPool", pool.ms, pool.rssMb, pool.peakMb, pool.idleMb, pool.minorFaults);
+}
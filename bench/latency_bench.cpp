@@ -0,0 +1,219 @@
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <thread>
+
+#include "../affinity/cpuaffinity.h"
+#include "../webserver/webserver.h"
+#include "bench.h"
+
+/*
+ * 端到端的请求延迟分位数, 服务端绑核与不绑核对比
+ * 服务端在子进程里运行(单 Reactor, CPU 通道, 内存用户存储, 不写日志), 本进程起 CLIENTS 个线程,
+ * 各用一条 keep-alive 连接循环 GET /index.html, 预热后记录 RUN_MS 内每个请求的往返时间
+ * 绑核的配置按本进程可用的 cpu 生成: reactor 用第一个 cpu, worker 用同一节点上的其余 cpu, 日志用最后一个
+ * 只有一个 cpu 或单节点的机器上两者差别不大, 双路机器上绑核主要改善的是 p99/p999
+ */
+namespace {
+const int PORT = 13160;
+const int CLIENTS = 8;
+const int WORKERS = 4;
+const int WARMUP_MS = 500;
+const int RUN_MS = 3000;
+const char REQUEST[] = "GET /index.html HTTP/1.1\r\nHost: 127.0.0.1\r\nConnection: keep-alive\r\n\r\n";
+
+std::vector<int> allowedCpus() {
+    std::vector<int> cpus;
+    cpu_set_t set;
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+            if (CPU_ISSET(cpu, &set)) {
+                cpus.push_back(cpu);
+            }
+        }
+    }
+    return cpus;
+}
+
+/* 生成绑核配置文件, 返回路径; 描述写入 *desc */
+std::string writeTopology(std::string *desc) {
+    std::vector<int> cpus = allowedCpus();
+    if (cpus.empty()) {
+        return "";
+    }
+    int reactor = cpus[0];
+    int node = CpuAffinity::cpuNode(reactor);
+    std::string workers;
+    for (size_t i = 1; i < cpus.size(); i++) {
+        if (CpuAffinity::cpuNode(cpus[i]) == node) {
+            workers += (workers.empty() ? "" : ",") + std::to_string(cpus[i]);
+        }
+    }
+    if (workers.empty()) {
+        workers = std::to_string(reactor);  // 只有一个 cpu
+    }
+    std::string path = "/tmp/latency_bench_topology.conf";
+    std::ofstream out(path);
+    out << "reactor = " << reactor << "\nworker = " << workers << "\nlog = " << cpus.back() << "\n";
+    *desc = "reactor " + std::to_string(reactor) + ", worker " + workers + ", node " + std::to_string(node);
+    return out ? path : "";
+}
+
+pid_t startServer(const char *topology) {
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        ConnLimits limits = {10000, 60000, 10000, 1024, 0};
+        WebServer server(PORT, 3, limits, false, "", 0, "", "", "", 1, WORKERS, 0, 1, false, 256 << 10,
+                         false, 1, 0, topology, "memory");
+        server.start();
+        _exit(0);
+    }
+    return pid;
+}
+
+int connectServer() {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(PORT);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (fd < 0 || connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    return fd;
+}
+
+/* 发一个请求并读完整个响应, 出错返回 false */
+bool roundTrip(int fd, std::string *buf) {
+    if (write(fd, REQUEST, sizeof(REQUEST) - 1) != sizeof(REQUEST) - 1) {
+        return false;
+    }
+    buf->clear();
+    size_t need = std::string::npos;
+    char tmp[16 << 10];
+    while (buf->size() < need) {
+        ssize_t n = read(fd, tmp, sizeof(tmp));
+        if (n <= 0) {
+            return false;
+        }
+        buf->append(tmp, n);
+        size_t end = buf->find("\r\n\r\n");
+        if (need == std::string::npos && end != std::string::npos) {
+            size_t pos = buf->find("Content-length: ");
+            if (pos == std::string::npos || pos > end) {
+                return false;
+            }
+            need = end + 4 + strtoul(buf->c_str() + pos + 16, nullptr, 10);
+        }
+    }
+    return true;
+}
+
+struct Result {
+    bool ok;
+    double rps, p50, p99, p999, max;
+};
+
+Result measure() {
+    std::atomic<bool> recording{false}, stop{false}, failed{false};
+    std::vector<std::vector<double>> samples(CLIENTS);
+    std::vector<std::thread> clients;
+    for (int i = 0; i < CLIENTS; i++) {
+        clients.emplace_back([&, i] {
+            std::string buf;
+            int fd = connectServer();
+            while (fd >= 0 && !stop) {
+                auto start = bench::Clock::now();
+                if (!roundTrip(fd, &buf)) {
+                    failed = true;
+                    break;
+                }
+                if (recording) {
+                    samples[i].push_back(bench::elapsedNs(start) / 1e3);
+                }
+            }
+            if (fd < 0) {
+                failed = true;
+            }
+            close(fd);
+        });
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(WARMUP_MS));
+    recording = true;
+    std::this_thread::sleep_for(std::chrono::milliseconds(RUN_MS));
+    recording = false;
+    stop = true;
+    for (auto &t : clients) {
+        t.join();
+    }
+
+    std::vector<double> all;
+    for (auto &s : samples) {
+        all.insert(all.end(), s.begin(), s.end());
+    }
+    std::sort(all.begin(), all.end());
+    Result res = {!failed && !all.empty(), 0, 0, 0, 0, 0};
+    if (res.ok) {
+        res.rps = all.size() / (RUN_MS / 1000.0);
+        res.p50 = bench::percentile(all, 0.5);
+        res.p99 = bench::percentile(all, 0.99);
+        res.p999 = bench::percentile(all, 0.999);
+        res.max = all.back();
+    }
+    return res;
+}
+
+bool waitReady() {
+    for (int i = 0; i < 50; i++) {
+        int fd = connectServer();
+        if (fd >= 0) {
+            close(fd);
+            return true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    return false;
+}
+}  // namespace
+
+void benchLatency() {
+    std::string desc;
+    std::string topology = writeTopology(&desc);
+    printf("%d keep-alive clients, GET /index.html, %d CPU lane workers, %dms per run\n", CLIENTS, WORKERS, RUN_MS);
+    printf("pinned: %s\n", topology.empty() ? "no topology, skipped" : desc.c_str());
+    printf("%-9s %10s %10s %10s %10s %10s\n", "threads", "req/s", "p50 us", "p99 us", "p999 us", "max us");
+    for (int pinned = 0; pinned < 2; pinned++) {
+        if (pinned && topology.empty()) {
+            break;
+        }
+        pid_t pid = startServer(pinned ? topology.c_str() : nullptr);
+        Result res = {false, 0, 0, 0, 0, 0};
+        if (pid > 0 && waitReady()) {
+            res = measure();
+        }
+        if (pid > 0) {
+            kill(pid, SIGKILL);
+            waitpid(pid, nullptr, 0);
+        }
+        if (!res.ok) {
+            printf("%-9s server on port %d failed\n", pinned ? "pinned" : "floating", PORT);
+            continue;
+        }
+        printf("%-9s %10.0f %10.1f %10.1f %10.1f %10.1f\n", pinned ? "pinned" : "floating", res.rps, res.p50, res.p99, res.p999, res.max);
+    }
+    if (!topology.empty()) {
+        unlink(topology.c_str());
+    }
+}
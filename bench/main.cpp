@@ -0,0 +1,48 @@
+#include <cstring>
+
+#include "bench.h"
+
+/* 用法: bench [名字...], 不带参数时依次运行全部 */
+namespace {
+struct Entry {
+    const char *name;
+    void (*run)();
+    const char *desc;
+};
+
+const Entry BENCHES[] = {
+    {"timer", benchTimer, "TimingWheel vs HeapTimer, 10k/100k/1M timers"},
+    {"threadpool", benchThreadPool, "work-stealing ThreadPool vs mutex + std::queue pool, 1-64 workers"},
+    {"parser", benchParser, "state machine HttpRequest parser vs std::regex parser, requests/s per core"},
+    {"sendfile", benchSendfile, "mmap+writev vs sendfile for static files around the sendfile threshold"},
+    {"chunkpool", benchChunkPool, "ChunkPool Buffer vs std::vector Buffer under connection churn, RSS and page faults"},
+    {"latency", benchLatency, "end-to-end p50/p99/p999 latency, pinned vs floating threads"},
+    {"syscalls", benchSyscalls, "server syscalls per request, epoll vs io_uring recv/writev submission"},
+};
+}  // namespace
+
+int main(int argc, char *argv[]) {
+    for (int i = 1; i < argc; i++) {
+        bool known = false;
+        for (const Entry &entry : BENCHES) {
+            known = known || strcmp(argv[i], entry.name) == 0;
+        }
+        if (!known) {
+            fprintf(stderr, "unknown bench: %s\n", argv[i]);
+            return 1;
+        }
+    }
+    for (const Entry &entry : BENCHES) {
+        bool selected = argc <= 1;
+        for (int i = 1; i < argc && !selected; i++) {
+            selected = strcmp(argv[i], entry.name) == 0;
+        }
+        if (selected) {
+            printf("== %s: %s\n", entry.name, entry.desc);
+            entry.run();
+            printf("\n");
+            fflush(stdout);
+        }
+    }
+    return 0;
+}
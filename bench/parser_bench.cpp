@@ -0,0 +1,107 @@
+#include <string>
+
+#include "../http/httprequest.h"
+#include "baseline/httprequest.h"
+#include "bench.h"
+
+/*
+ * 单线程反复把同一个请求写进 Buffer 再解析, 持续 RUN_NS, 得到每个核每秒能解析的请求数
+ * 两个解析器用同样的输入, 先核对解析出的方法、路径、版本一致, 防止测到的是错误路径
+ */
+namespace {
+const double RUN_NS = 5e8;
+
+struct Sample {
+    const char *name;
+    std::string request;
+};
+
+const Sample SAMPLES[] = {
+    {"small", "GET /index.html HTTP/1.1\r\nHost: 127.0.0.1:1316\r\nConnection: keep-alive\r\n\r\n"},
+    {"browser",
+     "GET /images/profile-image.jpg HTTP/1.1\r\n"
+     "Host: 127.0.0.1:1316\r\n"
+     "Connection: keep-alive\r\n"
+     "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/120.0.0.0 Safari/537.36\r\n"
+     "Accept: image/avif,image/webp,image/apng,image/svg+xml,image/*,*/*;q=0.8\r\n"
+     "Accept-Encoding: gzip, deflate, br\r\n"
+     "Accept-Language: zh-CN,zh;q=0.9,en;q=0.8\r\n"
+     "Cache-Control: no-cache\r\n"
+     "Pragma: no-cache\r\n"
+     "Referer: http://127.0.0.1:1316/picture.html\r\n"
+     "Sec-Fetch-Dest: image\r\n"
+     "Sec-Fetch-Mode: no-cors\r\n"
+     "Sec-Fetch-Site: same-origin\r\n"
+     "\r\n"},
+    {"post",
+     "POST /picture HTTP/1.1\r\n"
+     "Host: 127.0.0.1:1316\r\n"
+     "Connection: keep-alive\r\n"
+     "Content-Type: application/x-www-form-urlencoded\r\n"
+     "Content-Length: 31\r\n"
+     "\r\n"
+     "username=someone&password=p%40s"},
+};
+
+const char *simdName() {
+#if defined(__AVX2__)
+    return "AVX2";
+#elif defined(__SSE2__)
+    return "SSE2";
+#else
+    return "scalar";
+#endif
+}
+
+template <typename Parse>
+double run(const std::string &request, Parse parse) {
+    Buffer buff;
+    long n = 0;
+    auto start = bench::Clock::now();
+    double ns;
+    do {
+        for (int i = 0; i < 256; i++) {
+            buff.append(request.data(), request.size());
+            parse(buff);
+            buff.retrieveAll();
+        }
+        n += 256;
+    } while ((ns = bench::elapsedNs(start)) < RUN_NS);
+    return n / (ns / 1e9);
+}
+
+bool check(const std::string &request) {
+    Buffer a, b;
+    a.append(request.data(), request.size());
+    b.append(request.data(), request.size());
+    HttpRequest req;
+    baseline::HttpRequest old;
+    if (req.parse(a) != HttpRequest::GET_REQUSET || !old.parse(b)) {
+        return false;
+    }
+    return req.method() == old.method() && req.path() == old.path() && req.version() == old.version() &&
+           req.isKeepAlive() == old.isKeepAlive() && req.getPost("password") == old.getPost("password");
+}
+}  // namespace
+
+void benchParser() {
+    printf("state machine parser built with %s line search\n", simdName());
+    printf("%-8s %6s %14s %14s %8s\n", "request", "bytes", "regex req/s", "new req/s", "speedup");
+    for (const Sample &sample : SAMPLES) {
+        if (!check(sample.request)) {
+            printf("%-8s parsers disagree, skipped\n", sample.name);
+            continue;
+        }
+        HttpRequest req;
+        double newRate = run(sample.request, [&req](Buffer &buff) {
+            req.init();
+            req.parse(buff);
+        });
+        baseline::HttpRequest old;
+        double oldRate = run(sample.request, [&old](Buffer &buff) {
+            old.init();
+            old.parse(buff);
+        });
+        printf("%-8s %6zu %14.0f %14.0f %7.1fx\n", sample.name, sample.request.size(), oldRate, newRate, newRate / oldRate);
+    }
+}
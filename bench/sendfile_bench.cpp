@@ -0,0 +1,133 @@
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+
+#include <string>
+#include <thread>
+
+#include "../buffer/outputqueue.h"
+#include "bench.h"
+
+/*
+ * 静态文件的两种发送方式在 sendfile 阈值(默认 256KB)上下的对比, 经回环 TCP 发给一个只管读的线程:
+ *   mmap+writev  FileCache 给阈值以下的文件建好共享映射, 响应头和映射区合成一次 writev
+ *   sendfile     阈值及以上的只留 fd, 响应头 writev 之后文件段 sendfile
+ * 两者都走 OutputQueue::writeTo, 与 HttpConn 的发送路径相同; 映射事先建好, 不计入耗时, 与缓存命中时一致
+ * 每个大小发 TARGET_BYTES 左右, 报告每个响应的耗时、吞吐和系统调用次数
+ */
+namespace {
+const size_t SIZES[] = {16 << 10, 64 << 10, 128 << 10, 256 << 10, 512 << 10, 1 << 20, 4 << 20};
+const size_t TARGET_BYTES = 256 << 20;
+const size_t MIN_ROUNDS = 64;
+const char HEADER[] = "HTTP/1.1 200 OK\r\nConnection: keep-alive\r\nContent-type: image/jpeg\r\nContent-length: 0000000\r\n\r\n";
+
+struct Result {
+    double usPerResp;
+    double mbPerSec;
+    double callsPerResp;
+};
+
+/* 回环上的一对 TCP 连接, 读端由 drain 线程读空 */
+bool connectPair(int *sender, int *receiver) {
+    int listenFd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(addr);
+    if (listenFd < 0 || bind(listenFd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(listenFd, 1) < 0 ||
+        getsockname(listenFd, (struct sockaddr *)&addr, &len) < 0) {
+        close(listenFd);
+        return false;
+    }
+    *sender = socket(AF_INET, SOCK_STREAM, 0);
+    bool ok = connect(*sender, (struct sockaddr *)&addr, sizeof(addr)) == 0 && (*receiver = accept(listenFd, nullptr, nullptr)) >= 0;
+    close(listenFd);
+    return ok;
+}
+
+bool makeFile(size_t size, int *fd, char **addr) {
+    char path[] = "/tmp/sendfile_bench_XXXXXX";
+    *fd = mkstemp(path);
+    if (*fd < 0) {
+        return false;
+    }
+    unlink(path);
+    std::string block(64 << 10, 'x');
+    for (size_t done = 0; done < size; done += block.size()) {
+        if (write(*fd, block.data(), std::min(block.size(), size - done)) < 0) {
+            return false;
+        }
+    }
+    *addr = static_cast<char *>(mmap(nullptr, size, PROT_READ, MAP_SHARED, *fd, 0));
+    if (*addr == MAP_FAILED) {
+        return false;
+    }
+    madvise(*addr, size, MADV_WILLNEED);
+    return true;
+}
+
+Result run(int sock, int fd, const char *addr, size_t size, bool useSendfile, size_t rounds) {
+    OutputQueue output;
+    std::shared_ptr<const void> owner;  // 文件由调用方保活
+    long calls = 0;
+    auto start = bench::Clock::now();
+    for (size_t i = 0; i < rounds; i++) {
+        output.append(HEADER, sizeof(HEADER) - 1);
+        if (useSendfile) {
+            output.appendFile(owner, fd, 0, size);
+        } else {
+            output.appendShared(owner, addr, size);
+        }
+        int err = 0;
+        while (!output.empty()) {
+            if (output.writeTo(sock, &err) < 0 && err != EINTR) {
+                printf("write failed: %s\n", strerror(err));
+                return {};
+            }
+            calls++;
+        }
+        output.clear();
+    }
+    double ns = bench::elapsedNs(start);
+    return {ns / 1e3 / rounds, (size + sizeof(HEADER) - 1) * rounds / (ns / 1e9) / (1 << 20), double(calls) / rounds};
+}
+}  // namespace
+
+void benchSendfile() {
+    int sender = -1, receiver = -1;
+    if (!connectPair(&sender, &receiver)) {
+        printf("loopback connect failed: %s\n", strerror(errno));
+        return;
+    }
+    std::thread drain([receiver] {
+        std::vector<char> buf(1 << 20);
+        while (read(receiver, buf.data(), buf.size()) > 0) {
+        }
+    });
+
+    printf("%-8s %-12s %10s %10s %8s\n", "KB", "method", "us/resp", "MB/s", "calls");
+    for (size_t size : SIZES) {
+        int fd;
+        char *addr;
+        if (!makeFile(size, &fd, &addr)) {
+            printf("temp file failed: %s\n", strerror(errno));
+            break;
+        }
+        size_t rounds = std::max(MIN_ROUNDS, TARGET_BYTES / size);
+        Result mapped = run(sender, fd, addr, size, false, rounds);
+        Result sent = run(sender, fd, addr, size, true, rounds);
+        printf("%-8zu %-12s %10.1f %10.0f %8.1f\n", size >> 10, "mmap+writev", mapped.usPerResp, mapped.mbPerSec, mapped.callsPerResp);
+        printf("%-8s %-12s %10.1f %10.0f %8.1f %s\n", "", "sendfile", sent.usPerResp, sent.mbPerSec, sent.callsPerResp,
+               sent.usPerResp < mapped.usPerResp ? "<- faster" : "");
+        munmap(addr, size);
+        close(fd);
+    }
+    printf("server default sendfile threshold: 256KB\n");
+    shutdown(sender, SHUT_WR);
+    drain.join();
+    close(sender);
+    close(receiver);
+}
@@ -0,0 +1,231 @@
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <signal.h>
+#include <sys/ptrace.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+
+#include <atomic>
+#include <cstring>
+#include <map>
+#include <string>
+#include <thread>
+
+#include "../webserver/webserver.h"
+#include "bench.h"
+
+/*
+ * 服务端每个请求发出的系统调用数: epoll(LT/ET)对比 io_uring 完成式读写
+ * 服务端在子进程里运行(单 Reactor, 静态文件命中缓存在本线程处理, 内存用户存储, 不写日志), 由本进程的一个线程用 ptrace 跟踪,
+ * 只在计数窗口内按系统调用号统计进入次数; CLIENTS 条 keep-alive 连接预热后各发 REQUESTS 个 GET /index.html
+ * ptrace 让服务端慢得多, 这里只看次数, 不看耗时; vDSO 里的 clock_gettime 不进内核, 不计入
+ */
+namespace {
+const int PORT = 13161;
+const int CLIENTS = 8;
+const int WARMUP = 20;
+const int REQUESTS = 500;
+const char REQUEST[] = "GET /index.html HTTP/1.1\r\nHost: 127.0.0.1\r\nConnection: keep-alive\r\n\r\n";
+
+struct Config {
+    const char *name;
+    int trigMode;
+    bool useUring;
+};
+
+const Config CONFIGS[] = {
+    {"epoll LT", 2, false},
+    {"epoll ET", 3, false},
+    {"io_uring", 3, true},
+};
+
+const std::map<long, const char *> NAMES = {
+    {SYS_read, "read"},           {SYS_write, "write"},         {SYS_readv, "readv"},
+    {SYS_writev, "writev"},       {SYS_recvfrom, "recvfrom"},   {SYS_sendto, "sendto"},
+    {SYS_sendfile, "sendfile"},   {SYS_epoll_wait, "epoll_wait"}, {SYS_epoll_pwait, "epoll_pwait"},
+    {SYS_epoll_ctl, "epoll_ctl"}, {SYS_io_uring_enter, "io_uring_enter"}, {SYS_setsockopt, "setsockopt"},
+    {SYS_futex, "futex"},         {SYS_accept, "accept"},       {SYS_accept4, "accept4"},
+    {SYS_close, "close"},         {SYS_sched_yield, "sched_yield"},
+};
+
+std::atomic<bool> counting{false};
+
+/* 在调用线程上 fork 出服务端并跟踪它的所有线程, 直到服务端进程退出; ptrace 只认发起跟踪的线程 */
+void traceServer(const Config &cfg, std::atomic<pid_t> *child, std::map<long, uint64_t> *counts) {
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        ptrace(PTRACE_TRACEME, 0, nullptr, nullptr);
+        raise(SIGSTOP);
+        ConnLimits limits = {10000, 60000, 10000, 1024, 0};
+        WebServer server(PORT, cfg.trigMode, limits, false, "", 0, "", "", "", 1, 1, 0, 1, cfg.useUring, 256 << 10,
+                         false, 1, 0, nullptr, "memory");
+        server.start();
+        _exit(0);
+    }
+    if (pid < 0) {
+        child->store(-1);
+        return;
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);  // TRACEME 之后的 SIGSTOP
+    ptrace(PTRACE_SETOPTIONS, pid, nullptr, PTRACE_O_TRACESYSGOOD | PTRACE_O_TRACECLONE | PTRACE_O_EXITKILL);
+    ptrace(PTRACE_SYSCALL, pid, nullptr, nullptr);
+    child->store(pid);
+    while (true) {
+        pid_t tid = waitpid(-1, &status, __WALL);
+        if (tid < 0) {
+            break;
+        }
+        if (WIFEXITED(status) || WIFSIGNALED(status)) {
+            if (tid == pid) {
+                break;
+            }
+            continue;
+        }
+        int sig = WSTOPSIG(status);
+        if (sig == (SIGTRAP | 0x80)) {
+            struct __ptrace_syscall_info info;
+            if (counting && ptrace(PTRACE_GET_SYSCALL_INFO, tid, sizeof(info), &info) > 0 && info.op == PTRACE_SYSCALL_INFO_ENTRY) {
+                (*counts)[info.entry.nr]++;
+            }
+            sig = 0;
+        } else if (sig == SIGTRAP || sig == SIGSTOP) {
+            sig = 0;  // clone 事件和新线程开始时的 SIGSTOP, 不转发
+        }
+        ptrace(PTRACE_SYSCALL, tid, nullptr, sig);
+    }
+}
+
+int connectServer() {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(PORT);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (fd < 0 || connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    return fd;
+}
+
+/* 发一个请求并读完整个响应, 出错返回 false */
+bool roundTrip(int fd, std::string *buf) {
+    if (write(fd, REQUEST, sizeof(REQUEST) - 1) != sizeof(REQUEST) - 1) {
+        return false;
+    }
+    buf->clear();
+    size_t need = std::string::npos;
+    char tmp[16 << 10];
+    while (buf->size() < need) {
+        ssize_t n = read(fd, tmp, sizeof(tmp));
+        if (n <= 0) {
+            return false;
+        }
+        buf->append(tmp, n);
+        size_t end = buf->find("\r\n\r\n");
+        if (need == std::string::npos && end != std::string::npos) {
+            size_t pos = buf->find("Content-length: ");
+            if (pos == std::string::npos || pos > end) {
+                return false;
+            }
+            need = end + 4 + strtoul(buf->c_str() + pos + 16, nullptr, 10);
+        }
+    }
+    return true;
+}
+
+/* 每个客户端 n 个请求, 全部成功返回 true */
+bool runClients(const std::vector<int> &fds, int n) {
+    std::atomic<bool> failed{false};
+    std::vector<std::thread> clients;
+    for (int fd : fds) {
+        clients.emplace_back([&, fd] {
+            std::string buf;
+            for (int i = 0; i < n && !failed; i++) {
+                if (!roundTrip(fd, &buf)) {
+                    failed = true;
+                }
+            }
+        });
+    }
+    for (auto &t : clients) {
+        t.join();
+    }
+    return !failed;
+}
+
+bool measure(std::vector<int> *fds) {
+    for (int i = 0; i < 50 && fds->size() < CLIENTS; i++) {
+        int fd = connectServer();
+        if (fd >= 0) {
+            fds->push_back(fd);
+        } else {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+    }
+    if (fds->size() < CLIENTS || !runClients(*fds, WARMUP)) {
+        return false;
+    }
+    counting = true;
+    bool ok = runClients(*fds, REQUESTS);
+    counting = false;
+    return ok;
+}
+}  // namespace
+
+void benchSyscalls() {
+    printf("%d keep-alive clients x %d GET /index.html, single reactor, server syscalls counted with ptrace\n", CLIENTS, REQUESTS);
+    printf("%-9s %8s  %s\n", "backend", "sys/req", "per request");
+    for (const Config &cfg : CONFIGS) {
+        std::atomic<pid_t> child{0};
+        std::map<long, uint64_t> counts;
+        std::thread tracer(traceServer, std::cref(cfg), &child, &counts);
+        while (child == 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        std::vector<int> fds;
+        bool ok = child > 0 && measure(&fds);
+        for (int fd : fds) {
+            close(fd);
+        }
+        if (child > 0) {
+            kill(child, SIGKILL);
+        }
+        tracer.join();
+        if (child > 0) {
+            waitpid(child, nullptr, 0);
+        }
+        if (!ok) {
+            printf("%-9s server on port %d failed\n", cfg.name, PORT);
+            continue;
+        }
+
+        double requests = static_cast<double>(CLIENTS) * REQUESTS;
+        uint64_t total = 0;
+        std::vector<std::pair<uint64_t, long>> sorted;
+        for (auto &[nr, cnt] : counts) {
+            total += cnt;
+            sorted.push_back({cnt, nr});
+        }
+        std::sort(sorted.rbegin(), sorted.rend());
+        std::string detail;
+        for (auto &[cnt, nr] : sorted) {
+            if (cnt / requests < 0.01) {
+                break;
+            }
+            auto it = NAMES.find(nr);
+            char item[64];
+            snprintf(item, sizeof(item), "%s%s %.2f", detail.empty() ? "" : ", ",
+                     it != NAMES.end() ? it->second : ("#" + std::to_string(nr)).c_str(), cnt / requests);
+            detail += item;
+        }
+        bool fellBack = cfg.useUring && counts.find(SYS_io_uring_enter) == counts.end();
+        printf("%-9s %8.2f  %s%s\n", cfg.name, total / requests, detail.c_str(), fellBack ? " (io_uring unavailable, fell back to epoll)" : "");
+    }
+}
@@ -0,0 +1,76 @@
+#include <atomic>
+#include <thread>
+
+#include "../threadpool/threadpool.h"
+#include "baseline/threadpool.h"
+#include "bench.h"
+
+/*
+ * 单个提交线程(相当于 Reactor)连续提交 TASK_NUM 个任务, 等全部执行完, 算每秒完成的任务数
+ *   empty  任务只做一次原子加, 测的是队列和唤醒本身的开销
+ *   1us    任务空转约 1 微秒, 接近解析加组装响应的量级, 看线程数增加时能否线性扩展
+ * 新线程池的注入队列满时 addTask 返回 false, 提交方让出 CPU 后重试
+ */
+namespace {
+const int WORKERS[] = {1, 2, 4, 8, 16, 32, 64};
+const int TASK_NUM = 200000;
+
+void spin(int ns) {
+    auto start = bench::Clock::now();
+    while (bench::elapsedNs(start) < ns) {
+    }
+}
+
+void waitDone(const std::atomic<int> &done, int n) {
+    while (done.load(std::memory_order_acquire) < n) {
+        std::this_thread::yield();
+    }
+}
+
+double runOld(int workers, int workNs) {
+    std::atomic<int> done{0};
+    baseline::ThreadPool pool(workers);
+    auto start = bench::Clock::now();
+    for (int i = 0; i < TASK_NUM; i++) {
+        pool.addTask([&done, workNs] {
+            if (workNs > 0) {
+                spin(workNs);
+            }
+            done.fetch_add(1, std::memory_order_release);
+        });
+    }
+    waitDone(done, TASK_NUM);
+    return TASK_NUM / (bench::elapsedNs(start) / 1e9);
+}
+
+double runNew(int workers, int workNs) {
+    std::atomic<int> done{0};
+    ThreadPool pool(workers);
+    auto start = bench::Clock::now();
+    for (int i = 0; i < TASK_NUM; i++) {
+        while (!pool.addTask([&done, workNs] {
+            if (workNs > 0) {
+                spin(workNs);
+            }
+            done.fetch_add(1, std::memory_order_release);
+        })) {
+            std::this_thread::yield();
+        }
+    }
+    waitDone(done, TASK_NUM);
+    return TASK_NUM / (bench::elapsedNs(start) / 1e9);
+}
+}  // namespace
+
+void benchThreadPool() {
+    printf("%u hardware threads, %d tasks per run\n", std::thread::hardware_concurrency(), TASK_NUM);
+    printf("%-6s %-8s %14s %14s %8s\n", "task", "workers", "old tasks/s", "new tasks/s", "speedup");
+    const int WORK_NS[] = {0, 1000};
+    for (int workNs : WORK_NS) {
+        for (int workers : WORKERS) {
+            double oldRate = runOld(workers, workNs);
+            double newRate = runNew(workers, workNs);
+            printf("%-6s %-8d %14.0f %14.0f %7.2fx\n", workNs ? "1us" : "empty", workers, oldRate, newRate, newRate / oldRate);
+        }
+    }
+}
@@ -0,0 +1,98 @@
+#include <thread>
+
+#include "../timer/timingwheel.h"
+#include "baseline/heaptimer.h"
+#include "bench.h"
+
+/*
+ * 三种操作各做 n 次, 取每次的平均耗时:
+ *   add      新建 n 个 1~60 秒的定时器
+ *   refresh  随机挑已有的定时器改成新的时限, 对应 keep-alive 连接每个请求刷新一次
+ *   expire   n 个 20 毫秒内到期的定时器, 等它们全部到期后一次 tick 处理完
+ */
+namespace {
+const int SIZES[] = {10000, 100000, 1000000};
+const int EXPIRE_WITHIN_MS = 20;
+
+struct Result {
+    double add, refresh, expire;
+};
+
+Result runHeap(int n) {
+    Result res;
+    uint32_t seed = 1;
+    size_t fired = 0;
+    auto cb = [&fired] { fired++; };
+    {
+        baseline::HeapTimer timer;
+        auto start = bench::Clock::now();
+        for (int i = 0; i < n; i++) {
+            timer.add(i, 1000 + bench::nextRand(&seed) % 59000, cb);
+        }
+        res.add = bench::elapsedNs(start) / n;
+        start = bench::Clock::now();
+        for (int i = 0; i < n; i++) {
+            timer.adjust(bench::nextRand(&seed) % n, 1000 + bench::nextRand(&seed) % 59000);
+        }
+        res.refresh = bench::elapsedNs(start) / n;
+    }
+    baseline::HeapTimer timer;
+    for (int i = 0; i < n; i++) {
+        timer.add(i, bench::nextRand(&seed) % EXPIRE_WITHIN_MS, cb);
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(EXPIRE_WITHIN_MS + 10));
+    auto start = bench::Clock::now();
+    timer.getNextTick();
+    res.expire = bench::elapsedNs(start) / n;
+    if (fired != static_cast<size_t>(n) || timer.size() != 0) {
+        printf("HeapTimer: %zu of %d fired\n", fired, n);
+    }
+    return res;
+}
+
+Result runWheel(int n) {
+    Result res;
+    uint32_t seed = 1;
+    size_t fired = 0;
+    std::vector<TimerNode> nodes(n);
+    {
+        TimingWheel timer([&fired](TimerNode *) { fired++; });
+        auto start = bench::Clock::now();
+        for (int i = 0; i < n; i++) {
+            timer.add(&nodes[i], 1000 + bench::nextRand(&seed) % 59000);
+        }
+        res.add = bench::elapsedNs(start) / n;
+        start = bench::Clock::now();
+        for (int i = 0; i < n; i++) {
+            timer.add(&nodes[bench::nextRand(&seed) % n], 1000 + bench::nextRand(&seed) % 59000);
+        }
+        res.refresh = bench::elapsedNs(start) / n;
+    }
+    TimingWheel timer([&fired](TimerNode *) { fired++; });
+    for (int i = 0; i < n; i++) {
+        timer.add(&nodes[i], bench::nextRand(&seed) % EXPIRE_WITHIN_MS);
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(EXPIRE_WITHIN_MS + 10));
+    auto start = bench::Clock::now();
+    int next = timer.getNextTick();
+    res.expire = bench::elapsedNs(start) / n;
+    if (fired != static_cast<size_t>(n) || next != -1) {
+        printf("TimingWheel: %zu of %d fired\n", fired, n);
+    }
+    return res;
+}
+}  // namespace
+
+void benchTimer() {
+    printf("%-9s %-8s %14s %14s %8s\n", "timers", "op", "heap ns/op", "wheel ns/op", "speedup");
+    for (int n : SIZES) {
+        Result heap = runHeap(n);
+        Result wheel = runWheel(n);
+        const char *ops[] = {"add", "refresh", "expire"};
+        double heapNs[] = {heap.add, heap.refresh, heap.expire};
+        double wheelNs[] = {wheel.add, wheel.refresh, wheel.expire};
+        for (int i = 0; i < 3; i++) {
+            printf("%-9d %-8s %14.1f %14.1f %7.1fx\n", n, ops[i], heapNs[i], wheelNs[i], heapNs[i] / wheelNs[i]);
+        }
+    }
+}
@@ -1,6 +1,12 @@
 #include "buffer.h"
 
-Buffer::Buffer(int bufferSize) : buff_(bufferSize), readPos_(0), writePos_(0) {
+#include <algorithm>
+
+Buffer::Buffer(int bufferSize) : buff_(nullptr), cap_(0), initSize_(bufferSize > 0 ? bufferSize : 0), readPos_(0), writePos_(0) {
+}
+
+Buffer::~Buffer() {
+    release();
 }
 
 size_t Buffer::readableBytes() const {
@@ -8,7 +14,7 @@ size_t Buffer::readableBytes() const {
 }
 
 size_t Buffer::writableBytes() const {
-    return buff_.size() - writePos_;
+    return cap_ - writePos_;
 }
 
 size_t Buffer::prependableBytes() const {
@@ -22,6 +28,10 @@ const char *Buffer::peek() const {
 void Buffer::retrieve(size_t len) {
     assert(len <= readableBytes());
     readPos_ += len;
+    if (readPos_ == writePos_) {
+        readPos_ = 0;  // 读空之后从头写, 减少挪动
+        writePos_ = 0;
+    }
 }
 
 void Buffer::retrieveUntil(const char *end) {
@@ -30,9 +40,12 @@ void Buffer::retrieveUntil(const char *end) {
 }
 
 void Buffer::retrieveAll() {
-    bzero(beginPtr_(), buff_.size());
+    /* 只重置位置, 不清零内容; 偶尔的大请求撑大的存储还给内存池 */
     readPos_ = 0;
     writePos_ = 0;
+    if (cap_ > KEEP_CAP) {
+        release();
+    }
 }
 
 std::string Buffer::retrieveAllToStr() {
@@ -41,6 +54,14 @@ std::string Buffer::retrieveAllToStr() {
     return str;
 }
 
+void Buffer::release() {
+    ChunkPool::release(buff_, cap_);
+    buff_ = nullptr;
+    cap_ = 0;
+    readPos_ = 0;
+    writePos_ = 0;
+}
+
 void Buffer::hasWritten(size_t len) {
     writePos_ += len;
 }
@@ -68,27 +89,29 @@ void Buffer::append(std::string data) {
 }
 
 ssize_t Buffer::readFd(int fd, int *saveErrno) {
-    char buff[65535];
-    struct iovec iov[2];
-    const size_t writable = writableBytes();
-    /* 分散读， 保证数据全部读完 */
-    iov[0].iov_base = beginPtr_() + writePos_;
-    iov[0].iov_len = writable;
-    iov[1].iov_base = buff;
-    iov[1].iov_len = sizeof(buff);
-
-    const ssize_t len = readv(fd, iov, 2);
+    /*
+     * 直接读进缓冲区的可写部分, 不足 MIN_READ 时先腾出空间(挪动或换一块更大的池块)
+     * 一次没读完的数据由调用方再读(ET 下 HttpConn::read 会读到 EAGAIN 为止), 缓冲区按倍数增长
+     */
+    size_t space = 0;
+    char *buf = prepareRead(&space);
+    const ssize_t len = ::read(fd, buf, space);
     if (len < 0) {
         *saveErrno = errno;
-    } else if (static_cast<size_t>(len) <= writable) {
-        writePos_ += len;
     } else {
-        writePos_ = buff_.size();
-        append(buff, len - writable);
+        writePos_ += len;
     }
     return len;
 }
 
+char *Buffer::prepareRead(size_t *len) {
+    if (writableBytes() < MIN_READ) {
+        makeSpace_(MIN_READ);
+    }
+    *len = writableBytes();
+    return beginWrite();
+}
+
 ssize_t Buffer::writeFd(int fd, int *saveErrno) {
     size_t readSize = readableBytes();
     ssize_t len = write(fd, peek(), readSize);
@@ -101,21 +124,31 @@ ssize_t Buffer::writeFd(int fd, int *saveErrno) {
 }
 
 char *Buffer::beginPtr_() {
-    return buff_.data();
+    return buff_;
 }
 
 const char *Buffer::beginPtr_() const {
-    return buff_.data();
+    return buff_;
 }
 
 void Buffer::makeSpace_(size_t len) {
-    if (prependableBytes() + writableBytes() < len) {
-        buff_.resize(writePos_ + len + 1);
+    size_t readable = readableBytes();
+    if (buff_ && prependableBytes() + writableBytes() >= len && readable < cap_ / 2) {
+        /* 已读部分腾出的空间够用且要挪的数据不多, 挪到开头 */
+        memmove(beginPtr_(), beginPtr_() + readPos_, readable);
     } else {
-        size_t readabel = readableBytes();
-        std::copy(beginPtr_() + readPos_, beginPtr_() + writePos_, beginPtr_());
-        readPos_ = 0;
-        writePos_ = readabel;
-        assert(readabel == readableBytes());
+        /* 换一块更大的池块, 至少翻倍 */
+        size_t cap = 0;
+        char *chunk = ChunkPool::acquire(std::max({readable + len, cap_ * 2, initSize_}), &cap);
+        assert(chunk);
+        if (readable > 0) {
+            memcpy(chunk, beginPtr_() + readPos_, readable);
+        }
+        ChunkPool::release(buff_, cap_);
+        buff_ = chunk;
+        cap_ = cap;
     }
-}
\ No newline at end of file
+    readPos_ = 0;
+    writePos_ = readable;
+    assert(readable == readableBytes());
+}
@@ -8,15 +8,23 @@
 #include <cassert>
 #include <cstring>
 #include <iostream>
-#include <vector>
+#include <string>
 
+#include "chunkpool.h"
+
+/*
+ * 连续的读写缓冲区, 存储从 ChunkPool 按需取得
+ * 构造时不分配, 第一次写入时才取一块; release() 把存储还给内存池, 空闲连接不占内存
+ */
 class Buffer {
 public:
-    Buffer(int bufferSize = 1024);
-    ~Buffer() = default;
+    Buffer(int bufferSize = 1024);  // bufferSize 为第一次分配的最小容量
+    ~Buffer();
+    Buffer(const Buffer &) = delete;
+    Buffer &operator=(const Buffer &) = delete;
 
-    size_t readableBytes() const;     // 返回可写字节数
-    size_t writableBytes() const;     // 返回可读字节数
+    size_t readableBytes() const;     // 返回可读字节数
+    size_t writableBytes() const;     // 返回可写字节数
     size_t prependableBytes() const;  // 返回已读字节数
 
     const char *peek() const;  // 返回读取位置的指针
@@ -25,6 +33,7 @@ public:
     void retrieveUntil(const char *end);
     void retrieveAll();
     std::string retrieveAllToStr();
+    void release();  // 清空并把存储还给内存池
 
     void hasWritten(size_t len);
 
@@ -36,6 +45,7 @@ public:
 
     ssize_t writeFd(int fd, int *saveErrno);
     ssize_t readFd(int fd, int *saveErrno);
+    char *prepareRead(size_t *len);  // readFd 的前半: 留出空间, 返回可写区域; 由调用方(io_uring)读入后 hasWritten
 
 private:
     char *beginPtr_();
@@ -43,9 +53,14 @@ private:
     void makeSpace_(size_t len);
 
 private:
-    std::vector<char> buff_;
+    static const size_t MIN_READ = 512;       // 每次读之前至少留出的空间
+    static const size_t KEEP_CAP = 64 << 10;  // 清空时超过此容量的存储还给内存池
+
+    char *buff_;
+    size_t cap_;
+    size_t initSize_;
     std::atomic<size_t> readPos_;
     std::atomic<size_t> writePos_;
 };
 
-#endif  // BUFFER_H
\ No newline at end of file
+#endif  // BUFFER_H
@@ -0,0 +1,79 @@
+#include "chunkpool.h"
+
+namespace {
+/* 线程退出时池先于静态对象析构, 之后再释放的块直接还给系统 */
+thread_local bool poolDead = false;
+}  // namespace
+
+ChunkPool::ChunkPool() {
+    for (int i = 0; i < CLASS_NUM; i++) {
+        free_[i] = nullptr;
+        cached_[i] = 0;
+    }
+}
+
+ChunkPool::~ChunkPool() {
+    for (int i = 0; i < CLASS_NUM; i++) {
+        while (free_[i]) {
+            FreeNode *node = free_[i];
+            free_[i] = node->next;
+            free(node);
+        }
+    }
+    poolDead = true;
+}
+
+ChunkPool *ChunkPool::local_() {
+    if (poolDead) {
+        return nullptr;
+    }
+    thread_local ChunkPool pool;
+    return &pool;
+}
+
+int ChunkPool::classOf_(size_t size) {
+    int cls = 0;
+    while ((MIN_CHUNK << cls) < size) {
+        cls++;
+    }
+    return cls;
+}
+
+char *ChunkPool::acquire(size_t size, size_t *cap) {
+    assert(cap);
+    if (size > MAX_CHUNK) {
+        *cap = size;
+        return static_cast<char *>(malloc(size));
+    }
+    int cls = classOf_(size);
+    *cap = MIN_CHUNK << cls;
+    ChunkPool *pool = local_();
+    if (pool && pool->free_[cls]) {
+        FreeNode *node = pool->free_[cls];
+        pool->free_[cls] = node->next;
+        pool->cached_[cls] -= *cap;
+        return reinterpret_cast<char *>(node);
+    }
+    return static_cast<char *>(malloc(*cap));
+}
+
+void ChunkPool::release(char *chunk, size_t cap) {
+    if (!chunk) {
+        return;
+    }
+    ChunkPool *pool = cap <= MAX_CHUNK ? local_() : nullptr;
+    if (!pool) {
+        free(chunk);
+        return;
+    }
+    int cls = classOf_(cap);
+    assert((MIN_CHUNK << cls) == cap);
+    if (pool->cached_[cls] + cap > MAX_CACHED_BYTES) {
+        free(chunk);
+        return;
+    }
+    FreeNode *node = reinterpret_cast<FreeNode *>(chunk);
+    node->next = pool->free_[cls];
+    pool->free_[cls] = node;
+    pool->cached_[cls] += cap;
+}
@@ -0,0 +1,41 @@
+#ifndef CHUNKPOOL_H
+#define CHUNKPOOL_H
+
+#include <cassert>
+#include <cstddef>
+#include <cstdlib>
+
+/*
+ * Buffer 存储用的按线程分级内存池
+ * 块大小按 2 的幂分级, 从 MIN_CHUNK 到 MAX_CHUNK, 更大的直接 malloc/free
+ * 每个线程一组空闲链表, 取还都不加锁; 在别的线程释放的块归入释放线程的池
+ * 每级缓存的字节数有上限, 超出部分还给系统, 线程退出时全部还给系统
+ */
+class ChunkPool {
+public:
+    /* 返回至少 size 字节的块, 实际容量写入 cap */
+    static char *acquire(size_t size, size_t *cap);
+    static void release(char *chunk, size_t cap);
+
+    static const size_t MIN_CHUNK = 1024;
+    static const size_t MAX_CHUNK = 1 << 20;
+
+private:
+    ChunkPool();
+    ~ChunkPool();
+
+    static ChunkPool *local_();
+    static int classOf_(size_t size);
+
+    struct FreeNode {
+        FreeNode *next;
+    };
+
+    static const int CLASS_NUM = 11;                 // 1KB ~ 1MB
+    static const size_t MAX_CACHED_BYTES = 4 << 20;  // 每级缓存上限
+
+    FreeNode *free_[CLASS_NUM];
+    size_t cached_[CLASS_NUM];
+};
+
+#endif  // CHUNKPOOL_H
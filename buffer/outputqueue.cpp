@@ -0,0 +1,164 @@
+#include "outputqueue.h"
+
+#include <algorithm>
+
+OutputQueue::OutputQueue() : head_(0), bytes_(0), fileCnt_(0), tailUsed_(0) {
+}
+
+OutputQueue::~OutputQueue() {
+    clear();
+}
+
+void OutputQueue::append(const char *data, size_t len) {
+    if (len == 0) {
+        return;
+    }
+    assert(data);
+    while (len > 0) {
+        if (chunks_.empty() || tailUsed_ == chunks_.back().second) {
+            size_t cap = 0;
+            char *chunk = ChunkPool::acquire(std::max(len, CHUNK_SIZE), &cap);
+            assert(chunk);
+            chunks_.emplace_back(chunk, cap);
+            tailUsed_ = 0;
+        }
+        char *dst = chunks_.back().first + tailUsed_;
+        size_t n = std::min(len, chunks_.back().second - tailUsed_);
+        memcpy(dst, data, n);
+        tailUsed_ += n;
+        bytes_ += n;
+
+        Segment *last = segs_.size() > head_ ? &segs_.back() : nullptr;
+        if (last && last->owned && last->data + last->len == dst) {
+            last->len += n;  // 紧接着上一次追加, 合并成一段
+        } else {
+            segs_.push_back({dst, -1, 0, n, true, nullptr});
+        }
+        data += n;
+        len -= n;
+    }
+}
+
+void OutputQueue::append(const std::string &str) {
+    append(str.data(), str.size());
+}
+
+void OutputQueue::appendShared(std::shared_ptr<const void> owner, const char *data, size_t len) {
+    if (len == 0) {
+        return;
+    }
+    assert(data);
+    push_({data, -1, 0, len, false, std::move(owner)});
+}
+
+void OutputQueue::appendFile(std::shared_ptr<const void> owner, int fd, off_t off, size_t len) {
+    if (len == 0) {
+        return;
+    }
+    assert(fd >= 0);
+    fileCnt_++;
+    push_({nullptr, fd, off, len, false, std::move(owner)});
+}
+
+void OutputQueue::push_(Segment seg) {
+    bytes_ += seg.len;
+    segs_.push_back(std::move(seg));
+}
+
+ssize_t OutputQueue::writeTo(int fd, int *saveErrno) {
+    assert(!empty());
+    ssize_t len;
+    Segment &seg = segs_[head_];
+    if (seg.fd >= 0) {
+        /* sendfile 会推进 seg.off, EAGAIN 之后从这里接着发 */
+        off_t off = seg.off;
+        len = sendfile(fd, seg.fd, &off, seg.len);
+        if (len == 0) {
+            errno = EIO;  // 文件被截短了
+            len = -1;
+        }
+    } else {
+        const struct iovec *iov = nullptr;
+        int cnt = gather(&iov);
+        len = writev(fd, iov, cnt);
+    }
+    if (len < 0) {
+        *saveErrno = errno;
+        return len;
+    }
+    consume_(len);
+    return len;
+}
+
+int OutputQueue::gather(const struct iovec **iov) {
+    /* 队首连续的内存段合成一次 writev, 遇到文件段为止 */
+    int cnt = 0;
+    for (size_t i = head_; i < segs_.size() && segs_[i].fd < 0 && cnt < IOV_MAX; i++, cnt++) {
+        if (iov_.size() <= static_cast<size_t>(cnt)) {
+            iov_.resize(cnt + 1);
+        }
+        iov_[cnt].iov_base = const_cast<char *>(segs_[i].data);
+        iov_[cnt].iov_len = segs_[i].len;
+    }
+    *iov = iov_.data();
+    return cnt;
+}
+
+void OutputQueue::advance(size_t n) {
+    consume_(n);
+}
+
+void OutputQueue::consume_(size_t n) {
+    assert(n <= bytes_);
+    bytes_ -= n;
+    /* 跳过已经写完的段, 调整写了一半的那个 */
+    while (n > 0) {
+        Segment &seg = segs_[head_];
+        if (n < seg.len) {
+            if (seg.fd >= 0) {
+                seg.off += n;
+            } else {
+                seg.data += n;
+            }
+            seg.len -= n;
+            break;
+        }
+        n -= seg.len;
+        if (seg.fd >= 0) {
+            fileCnt_--;
+        }
+        seg.owner.reset();  // 写完即释放引用, 不必等整批结束
+        head_++;
+    }
+    if (bytes_ == 0) {
+        clear();
+    }
+}
+
+size_t OutputQueue::size() const {
+    return bytes_;
+}
+
+bool OutputQueue::empty() const {
+    return bytes_ == 0;
+}
+
+size_t OutputQueue::segmentCount() const {
+    return segs_.size() - head_;
+}
+
+bool OutputQueue::hasFile() const {
+    return fileCnt_ > 0;
+}
+
+void OutputQueue::clear() {
+    segs_.clear();
+    head_ = 0;
+    bytes_ = 0;
+    fileCnt_ = 0;
+    for (auto &chunk : chunks_) {
+        ChunkPool::release(chunk.first, chunk.second);
+    }
+    chunks_.clear();
+    tailUsed_ = 0;
+}
@@ -0,0 +1,75 @@
+#ifndef OUTPUTQUEUE_H
+#define OUTPUTQUEUE_H
+
+#include <limits.h>  // IOV_MAX
+#include <sys/sendfile.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "chunkpool.h"
+
+/*
+ * 待发送数据的队列, 按顺序由三种段组成:
+ * 自有段: append() 拷贝进队列自己从 ChunkPool 取的块, 块不搬动, 相邻追加合并成一段
+ * 共享段: appendShared() 引用别处的只读内存(如缓存文件的映射), 由 owner 保证在发送完之前有效
+ * 文件段: appendFile() 用 sendfile 发送 fd 的 [off, off + len), 同样由 owner 保活
+ * writeTo() 每次一个系统调用: 队首连续的内存段合成一次 writev(最多 IOV_MAX 段), 或一个文件段 sendfile
+ * 由别人代发 writev 时(io_uring)用 gather() 取 iovec, 发出后 advance(); 部分写的记账只在 consume_() 一处
+ */
+class OutputQueue {
+public:
+    OutputQueue();
+    ~OutputQueue();
+    OutputQueue(const OutputQueue &) = delete;
+    OutputQueue &operator=(const OutputQueue &) = delete;
+
+    void append(const char *data, size_t len);
+    void append(const std::string &str);
+    void appendShared(std::shared_ptr<const void> owner, const char *data, size_t len);
+    void appendFile(std::shared_ptr<const void> owner, int fd, off_t off, size_t len);
+
+    ssize_t writeTo(int fd, int *saveErrno);
+    int gather(const struct iovec **iov);  // 队首连续的内存段, 到下次 gather 之前有效; 队首是文件段时返回 0
+    void advance(size_t n);                // 已发出 n 字节
+
+    size_t size() const;     // 剩余字节数
+    bool empty() const;
+    size_t segmentCount() const;
+    bool hasFile() const;    // 是否含文件段
+    void clear();            // 丢弃剩余数据, 释放所有引用和自有块
+
+private:
+    struct Segment {
+        const char *data;  // 内存段的起始地址, 文件段为 nullptr
+        int fd;            // 文件段的 fd, 内存段为 -1
+        off_t off;         // 文件段的当前偏移, sendfile 会推进它
+        size_t len;
+        bool owned;        // 指向自有块, 可以与后续追加合并
+        std::shared_ptr<const void> owner;
+    };
+
+    void push_(Segment seg);
+    void consume_(size_t n);
+
+    static const size_t CHUNK_SIZE = 4096;  // 自有块的最小容量
+
+    std::vector<Segment> segs_;
+    size_t head_;   // 第一个未写完的段
+    size_t bytes_;
+    int fileCnt_;
+
+    /* 自有块, clear() 时还给内存池; 只有最后一块可能还有空间 */
+    std::vector<std::pair<char *, size_t>> chunks_;
+    size_t tailUsed_;
+
+    std::vector<struct iovec> iov_;
+};
+
+#endif  // OUTPUTQUEUE_H
@@ -0,0 +1,119 @@
+#ifndef CO_TASK_H
+#define CO_TASK_H
+
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+/*
+ * 协程的返回类型, 惰性启动: 创建后挂起, 被 co_await 时才开始执行, 结束后恢复等待它的协程
+ * 最外层的协程用 spawn() 启动, 结束时自行销毁协程帧
+ * 恢复都是对称转移, 连续的 co_await 链不会加深调用栈
+ * 项目不使用异常, 协程内抛出的异常直接 terminate
+ */
+template <typename T = void>
+class Task;
+
+namespace co_detail {
+
+struct PromiseBase {
+    std::coroutine_handle<> continuation;  // co_await 本协程的调用方
+    bool detached = false;                 // spawn 启动的, 没有调用方
+
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    void unhandled_exception() noexcept { std::terminate(); }
+
+    struct FinalAwaiter {
+        bool await_ready() const noexcept { return false; }
+        template <typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> h) noexcept {
+            PromiseBase &p = h.promise();
+            if (p.continuation) {
+                return p.continuation;
+            }
+            if (p.detached) {
+                h.destroy();
+            }
+            return std::noop_coroutine();
+        }
+        void await_resume() const noexcept {}
+    };
+    FinalAwaiter final_suspend() noexcept { return {}; }
+};
+
+template <typename T>
+struct Promise : PromiseBase {
+    std::optional<T> value;
+
+    Task<T> get_return_object() noexcept;
+    template <typename U>
+    void return_value(U &&v) { value.emplace(std::forward<U>(v)); }
+};
+
+template <>
+struct Promise<void> : PromiseBase {
+    Task<void> get_return_object() noexcept;
+    void return_void() noexcept {}
+};
+
+}  // namespace co_detail
+
+template <typename T>
+class Task {
+public:
+    using promise_type = co_detail::Promise<T>;
+    using Handle = std::coroutine_handle<promise_type>;
+
+    explicit Task(Handle h) noexcept : handle_(h) {}
+    Task(Task &&other) noexcept : handle_(std::exchange(other.handle_, nullptr)) {}
+    Task(const Task &) = delete;
+    Task &operator=(const Task &) = delete;
+    ~Task() {
+        if (handle_) {
+            handle_.destroy();
+        }
+    }
+
+    bool await_ready() const noexcept { return false; }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> caller) noexcept {
+        handle_.promise().continuation = caller;
+        return handle_;
+    }
+    T await_resume() {
+        if constexpr (!std::is_void_v<T>) {
+            return std::move(*handle_.promise().value);
+        }
+    }
+
+    /* 交出协程帧并开始执行, 之后由协程结束时自行销毁 */
+    void detach() {
+        Handle h = std::exchange(handle_, nullptr);
+        h.promise().detached = true;
+        h.resume();
+    }
+
+private:
+    Handle handle_;
+};
+
+namespace co_detail {
+
+template <typename T>
+Task<T> Promise<T>::get_return_object() noexcept {
+    return Task<T>(std::coroutine_handle<Promise<T>>::from_promise(*this));
+}
+
+inline Task<void> Promise<void>::get_return_object() noexcept {
+    return Task<void>(std::coroutine_handle<Promise<void>>::from_promise(*this));
+}
+
+}  // namespace co_detail
+
+/* 启动一个最外层的协程, 运行到第一个挂起点后返回 */
+inline void spawn(Task<void> task) {
+    task.detach();
+}
+
+#endif  // CO_TASK_H
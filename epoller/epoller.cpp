@@ -8,22 +8,22 @@ Epoller::~Epoller() {
     close(epollFd_);
 }
 
-bool Epoller::addFd(int fd, uint32_t events) {
+bool Epoller::addFd(int fd, uint32_t events, void* ptr) {
     if (fd < 0) {
         return false;
     }
     epoll_event ev = {0};
-    ev.data.fd = fd;
+    ev.data.ptr = ptr;
     ev.events = events;
     return epoll_ctl(epollFd_, EPOLL_CTL_ADD, fd, &ev) == 0;
 }
 
-bool Epoller::modFd(int fd, uint32_t events) {
+bool Epoller::modFd(int fd, uint32_t events, void* ptr) {
     if (fd < 0) {
         return false;
     }
     epoll_event ev = {0};
-    ev.data.fd = fd;
+    ev.data.ptr = ptr;
     ev.events = events;
     return epoll_ctl(epollFd_, EPOLL_CTL_MOD, fd, &ev) == 0;
 }
@@ -40,9 +40,9 @@ int Epoller::wait(int timeout) {
     return epoll_wait(epollFd_, &events_[0], static_cast<int>(events_.size()), timeout);
 }
 
-int Epoller::getEventFd(size_t i) const {
+void* Epoller::getEventPtr(size_t i) const {
     assert(i < events_.size() && i >= 0);
-    return events_[i].data.fd;
+    return events_[i].data.ptr;
 }
 
 uint32_t Epoller::getEvents(size_t i) const {
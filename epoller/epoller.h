@@ -7,23 +7,28 @@
 #include <cassert>
 #include <vector>
 
-class Epoller {
+#include "poller.h"
+
+class Epoller : public Poller {
 public:
     explicit Epoller(int maxEvent = 1024);
-    ~Epoller();
+    ~Epoller() override;
+
+    /* ptr 存入 epoll_event.data.ptr, 事件返回时原样取回 */
+    bool addFd(int fd, uint32_t events, void* ptr) override;
+    bool modFd(int fd, uint32_t events, void* ptr) override;
+    bool delFd(int fd) override;
 
-    bool addFd(int fd, uint32_t events);
-    bool modFd(int fd, uint32_t events);
-    bool delFd(int fd);
+    int wait(int timeout = -1) override;
 
-    int wait(int timeout = -1);
+    void* getEventPtr(size_t i) const override;
+    uint32_t getEvents(size_t i) const override;
 
-    int getEventFd(size_t i) const;
-    uint32_t getEvents(size_t i) const;
+    const char* name() const override { return "epoll"; }
 
 private:
     int epollFd_;
     std::vector<struct epoll_event> events_;
 };
 
-#endif  // EPOLLER_H
\ No newline at end of file
+#endif  // EPOLLER_H
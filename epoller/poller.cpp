@@ -0,0 +1,15 @@
+#include "poller.h"
+
+#include "epoller.h"
+#include "uringpoller.h"
+
+std::unique_ptr<Poller> Poller::create(bool useUring, int maxEvent) {
+    if (useUring) {
+        std::unique_ptr<UringPoller> uring(new UringPoller(maxEvent));
+        if (uring->isValid()) {
+            return uring;
+        }
+        // 内核过旧或 io_uring 被禁用(seccomp / io_uring_disabled), 回退到 epoll
+    }
+    return std::unique_ptr<Poller>(new Epoller(maxEvent));
+}
@@ -0,0 +1,46 @@
+#ifndef POLLER_H
+#define POLLER_H
+
+#include <sys/epoll.h>
+#include <sys/uio.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+/*
+ * I/O 多路复用后端接口, 事件统一使用 EPOLL* 位表示
+ * ptr 在注册时传入, 事件返回时原样取回
+ */
+class Poller {
+public:
+    virtual ~Poller() = default;
+
+    virtual bool addFd(int fd, uint32_t events, void* ptr) = 0;
+    virtual bool modFd(int fd, uint32_t events, void* ptr) = 0;
+    virtual bool delFd(int fd) = 0;
+
+    virtual int wait(int timeout = -1) = 0;
+
+    virtual void* getEventPtr(size_t i) const = 0;
+    virtual uint32_t getEvents(size_t i) const = 0;
+
+    virtual const char* name() const = 0;
+
+    /*
+     * 完成式读写, asyncIo() 为 true 时可用(io_uring): 由 Poller 代为 recv/writev, 不再先等就绪再自己发系统调用
+     * 完成时 wait() 返回一个事件, events 为 IO_DONE | EPOLLIN(recv) 或 IO_DONE | EPOLLOUT(writev),
+     * getResult() 为返回值(字节数或 -errno). 同一个 fd 同时只能有一个在途的操作
+     * buf/iov 指向的内存要保持有效, 直到完成事件返回或 delFd(fd) 返回(它会撤销在途的操作并等其结束)
+     */
+    static const uint32_t IO_DONE = 1u << 27;  // epoll 没有用到的位
+    virtual bool asyncIo() const { return false; }
+    virtual bool submitRecv(int fd, void* buf, size_t len, void* ptr) { return false; }
+    virtual bool submitWritev(int fd, const struct iovec* iov, int iovcnt, void* ptr) { return false; }
+    virtual int getResult(size_t i) const { return 0; }
+
+    /* useUring 为 true 时优先使用 io_uring, 内核不支持则自动回退到 epoll */
+    static std::unique_ptr<Poller> create(bool useUring, int maxEvent = 1024);
+};
+
+#endif  // POLLER_H
@@ -0,0 +1,460 @@
+#include "uringpoller.h"
+
+static int ioUringSetup(unsigned entries, struct io_uring_params* p) {
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, p));
+}
+
+static int ioUringRegister(int fd, unsigned opcode, void* arg, unsigned nrArgs) {
+    return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, arg, nrArgs));
+}
+
+static int ioUringEnter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags, void* arg, size_t argSize) {
+    return static_cast<int>(syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, arg, argSize));
+}
+
+UringPoller::UringPoller(int maxEvent)
+    : ringFd_(-1), multishot_(false), asyncIo_(false), sqRing_(MAP_FAILED), sqRingSize_(0), cqRing_(MAP_FAILED), cqRingSize_(0),
+      sqes_(static_cast<struct io_uring_sqe*>(MAP_FAILED)), sqesSize_(0), sqLocalTail_(0), sqPending_(0),
+      events_(maxEvent), regs_(1024) {
+    assert(events_.size() > 0);
+    if (!setup_(1024)) {
+        release_();
+    }
+}
+
+UringPoller::~UringPoller() {
+    release_();
+}
+
+void UringPoller::release_() {
+    if (sqes_ != MAP_FAILED) {
+        munmap(sqes_, sqesSize_);
+        sqes_ = static_cast<struct io_uring_sqe*>(MAP_FAILED);
+    }
+    if (cqRing_ != MAP_FAILED && cqRing_ != sqRing_) {
+        munmap(cqRing_, cqRingSize_);
+    }
+    cqRing_ = MAP_FAILED;
+    if (sqRing_ != MAP_FAILED) {
+        munmap(sqRing_, sqRingSize_);
+        sqRing_ = MAP_FAILED;
+    }
+    if (ringFd_ >= 0) {
+        close(ringFd_);
+        ringFd_ = -1;
+    }
+}
+
+bool UringPoller::isValid() const {
+    return ringFd_ >= 0;
+}
+
+bool UringPoller::setup_(unsigned entries) {
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    // 每个连接最多挂一个 poll, CQ 放大一些; 超出时依赖 NODROP 由内核暂存
+    p.flags = IORING_SETUP_CQSIZE;
+    p.cq_entries = entries * 16;
+    ringFd_ = ioUringSetup(entries, &p);
+    if (ringFd_ < 0) {
+        return false;
+    }
+    // wait() 的超时依赖 EXT_ARG (5.11)
+    if (!(p.features & IORING_FEAT_EXT_ARG) || !(p.features & IORING_FEAT_NODROP)) {
+        return false;
+    }
+    sqRingSize_ = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    cqRingSize_ = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        sqRingSize_ = cqRingSize_ = std::max(sqRingSize_, cqRingSize_);
+    }
+    sqRing_ = mmap(nullptr, sqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd_, IORING_OFF_SQ_RING);
+    if (sqRing_ == MAP_FAILED) {
+        return false;
+    }
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        cqRing_ = sqRing_;
+    } else {
+        cqRing_ = mmap(nullptr, cqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd_, IORING_OFF_CQ_RING);
+        if (cqRing_ == MAP_FAILED) {
+            return false;
+        }
+    }
+    sqesSize_ = p.sq_entries * sizeof(struct io_uring_sqe);
+    void* sqes = mmap(nullptr, sqesSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd_, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+        return false;
+    }
+    sqes_ = static_cast<struct io_uring_sqe*>(sqes);
+
+    char* sq = static_cast<char*>(sqRing_);
+    sqHead_ = reinterpret_cast<unsigned*>(sq + p.sq_off.head);
+    sqTail_ = reinterpret_cast<unsigned*>(sq + p.sq_off.tail);
+    sqMask_ = reinterpret_cast<unsigned*>(sq + p.sq_off.ring_mask);
+    sqArray_ = reinterpret_cast<unsigned*>(sq + p.sq_off.array);
+    sqEntries_ = p.sq_entries;
+    sqLocalTail_ = *sqTail_;
+
+    char* cq = static_cast<char*>(cqRing_);
+    cqHead_ = reinterpret_cast<unsigned*>(cq + p.cq_off.head);
+    cqTail_ = reinterpret_cast<unsigned*>(cq + p.cq_off.tail);
+    cqMask_ = reinterpret_cast<unsigned*>(cq + p.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<struct io_uring_cqe*>(cq + p.cq_off.cqes);
+    return probe_();
+}
+
+bool UringPoller::probe_() {
+    // 用 IORING_REGISTER_PROBE 确认用到的操作码都支持, 不按 features 位推测内核版本
+    std::vector<char> buf(sizeof(struct io_uring_probe) + PROBE_OPS * sizeof(struct io_uring_probe_op), 0);
+    struct io_uring_probe* probe = reinterpret_cast<struct io_uring_probe*>(buf.data());
+    if (ioUringRegister(ringFd_, IORING_REGISTER_PROBE, probe, PROBE_OPS) < 0) {
+        return false;
+    }
+    auto supported = [probe](int op) { return op <= probe->last_op && (probe->ops[op].flags & IO_URING_OP_SUPPORTED); };
+    if (!supported(IORING_OP_POLL_ADD) || !supported(IORING_OP_POLL_REMOVE)) {
+        return false;
+    }
+    // 不支持时(5.6 之前)连接的读写退回就绪通知 + 调用方自己读写
+    asyncIo_ = supported(IORING_OP_RECV) && supported(IORING_OP_WRITEV) && supported(IORING_OP_ASYNC_CANCEL);
+
+    /*
+     * PROBE 只列出操作码, 不反映 POLL_ADD 是否接受 IORING_POLL_ADD_MULTI(5.13)
+     * 在一个空闲的 eventfd 上试挂一次 multishot poll 再撤销: 不支持的内核在 prep 阶段就以 -EINVAL 完成
+     */
+    int efd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (efd < 0) {
+        return false;
+    }
+    struct io_uring_sqe* sqe = getSqe_();
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = efd;
+    sqe->poll32_events = EPOLLIN;
+    sqe->len = IORING_POLL_ADD_MULTI;
+    sqe->user_data = PROBE_DATA;
+    commit_();
+    sqe = getSqe_();
+    sqe->opcode = IORING_OP_POLL_REMOVE;
+    sqe->fd = -1;
+    sqe->addr = PROBE_DATA;
+    sqe->user_data = INTERNAL_DATA;
+    commit_();
+
+    int ret = enter_(sqPending_, 2, IORING_ENTER_GETEVENTS, nullptr, 0);
+    close(efd);
+    if (ret < 0) {
+        return false;
+    }
+    sqPending_ = 0;
+    int addRes = 0;
+    unsigned head = *cqHead_;
+    unsigned tail = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+    for (; head != tail; head++) {
+        const struct io_uring_cqe* cqe = &cqes_[head & *cqMask_];
+        if (cqe->user_data == PROBE_DATA) {
+            addRes = cqe->res;
+        }
+    }
+    __atomic_store_n(cqHead_, head, __ATOMIC_RELEASE);
+    multishot_ = addRes != -EINVAL;
+    return true;
+}
+
+bool UringPoller::addFd(int fd, uint32_t events, void* ptr) {
+    if (fd < 0) {
+        return false;
+    }
+    std::lock_guard<std::mutex> locker(mtx_);
+    if (static_cast<size_t>(fd) >= regs_.size()) {
+        regs_.resize(fd * 2);
+    }
+    Registration& reg = regs_[fd];
+    reg.ptr = ptr;
+    reg.events = events;
+    reg.active = true;
+    if (!pollAdd_(fd)) {
+        return false;
+    }
+    flushIfForeign_();
+    return true;
+}
+
+bool UringPoller::modFd(int fd, uint32_t events, void* ptr) {
+    if (fd < 0) {
+        return false;
+    }
+    std::lock_guard<std::mutex> locker(mtx_);
+    if (static_cast<size_t>(fd) >= regs_.size() || !regs_[fd].active) {
+        return false;
+    }
+    Registration& reg = regs_[fd];
+    reg.ptr = ptr;
+    reg.events = events;
+    if (!pollAdd_(fd)) {
+        return false;
+    }
+    flushIfForeign_();
+    return true;
+}
+
+bool UringPoller::delFd(int fd) {
+    if (fd < 0) {
+        return false;
+    }
+    std::lock_guard<std::mutex> locker(mtx_);
+    if (static_cast<size_t>(fd) >= regs_.size() || !regs_[fd].active) {
+        return false;
+    }
+    Registration& reg = regs_[fd];
+    uint64_t target = (static_cast<uint64_t>(fd) << 32) | reg.seq;
+    reg.active = false;
+    reg.seq++;
+    if (reg.ioPending) {
+        // 在途的 recv/writev 还引用着调用方的缓冲区, 等它结束才能返回; 完成事件按 seq 丢弃
+        reg.ioPending = false;
+        if (!cancelIo_(target | IO_FLAG)) {
+            return false;
+        }
+    }
+    // 必须撤销仍挂着的 poll, 否则它持有的文件引用会让 close(fd) 迟迟不生效
+    struct io_uring_sqe* sqe = getSqe_();
+    if (!sqe) {
+        return false;
+    }
+    sqe->opcode = IORING_OP_POLL_REMOVE;
+    sqe->fd = -1;
+    sqe->addr = target;
+    sqe->user_data = INTERNAL_DATA;
+    commit_();
+    flushIfForeign_();
+    return true;
+}
+
+int UringPoller::wait(int timeout) {
+    loopThread_ = std::this_thread::get_id();
+    unsigned toSubmit;
+    {
+        std::lock_guard<std::mutex> locker(mtx_);
+        toSubmit = sqPending_;
+        sqPending_ = 0;
+    }
+
+    struct __kernel_timespec ts;
+    struct io_uring_getevents_arg arg;
+    memset(&arg, 0, sizeof(arg));
+    arg.sigmask_sz = _NSIG / 8;
+    unsigned flags = IORING_ENTER_EXT_ARG;
+    unsigned minComplete = 0;
+    bool hasReady = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE) != *cqHead_;
+    if (timeout != 0 && !hasReady) {
+        flags |= IORING_ENTER_GETEVENTS;
+        minComplete = 1;
+        if (timeout > 0) {
+            ts.tv_sec = timeout / 1000;
+            ts.tv_nsec = (timeout % 1000) * 1000000LL;
+            arg.ts = reinterpret_cast<uint64_t>(&ts);
+        }
+    }
+
+    // 提交和等待合并成一次系统调用
+    int ret = 0;
+    if (toSubmit > 0 || minComplete > 0) {
+        ret = ioUringEnter(ringFd_, toSubmit, minComplete, flags, &arg, sizeof(arg));
+    }
+    if (ret < 0) {
+        int err = errno;
+        {
+            std::lock_guard<std::mutex> locker(mtx_);
+            sqPending_ += toSubmit;
+        }
+        if (err != ETIME && err != EINTR) {
+            errno = err;
+            return -1;
+        }
+    } else if (static_cast<unsigned>(ret) < toSubmit) {
+        std::lock_guard<std::mutex> locker(mtx_);
+        sqPending_ += toSubmit - ret;
+    }
+    return reap_();
+}
+
+void* UringPoller::getEventPtr(size_t i) const {
+    assert(i < events_.size() && i >= 0);
+    return events_[i].ptr;
+}
+
+uint32_t UringPoller::getEvents(size_t i) const {
+    assert(i < events_.size() && i >= 0);
+    return events_[i].events;
+}
+
+int UringPoller::getResult(size_t i) const {
+    assert(i < events_.size() && i >= 0);
+    return events_[i].res;
+}
+
+bool UringPoller::submitRecv(int fd, void* buf, size_t len, void* ptr) {
+    return submitIo_(fd, IORING_OP_RECV, buf, static_cast<uint32_t>(std::min<size_t>(len, UINT32_MAX)), EPOLLIN, ptr);
+}
+
+bool UringPoller::submitWritev(int fd, const struct iovec* iov, int iovcnt, void* ptr) {
+    return submitIo_(fd, IORING_OP_WRITEV, iov, static_cast<uint32_t>(iovcnt), EPOLLOUT, ptr);
+}
+
+bool UringPoller::submitIo_(int fd, uint8_t opcode, const void* addr, uint32_t len, uint32_t event, void* ptr) {
+    if (fd < 0 || !asyncIo_) {
+        return false;
+    }
+    std::lock_guard<std::mutex> locker(mtx_);
+    if (static_cast<size_t>(fd) >= regs_.size()) {
+        regs_.resize(fd * 2);
+    }
+    Registration& reg = regs_[fd];
+    assert(!reg.ioPending);
+    struct io_uring_sqe* sqe = getSqe_();
+    if (!sqe) {
+        return false;
+    }
+    // 只通过读写使用的 fd 也算注册过, 之后可以 modFd 挂一次性的 poll, 关闭前要 delFd
+    reg.ptr = ptr;
+    reg.active = true;
+    reg.ioPending = true;
+    reg.ioEvent = event;
+    sqe->opcode = opcode;
+    sqe->fd = fd;
+    sqe->addr = reinterpret_cast<uint64_t>(addr);
+    sqe->len = len;
+    sqe->user_data = IO_FLAG | (static_cast<uint64_t>(fd) << 32) | reg.seq;
+    commit_();
+    flushIfForeign_();
+    return true;
+}
+
+/* 撤销 user_data 为 target 的操作, 提交后一直等到它的 CQE 出现在 CQ 里(不收割, 留给 reap_ 按 seq 丢弃) */
+bool UringPoller::cancelIo_(uint64_t target) {
+    struct io_uring_sqe* sqe = getSqe_();
+    if (!sqe) {
+        return false;
+    }
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = target;
+    sqe->user_data = INTERNAL_DATA;
+    commit_();
+    while (true) {
+        unsigned head = *cqHead_;
+        unsigned tail = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+        for (unsigned i = head; i != tail; i++) {
+            if (cqes_[i & *cqMask_].user_data == target) {
+                return true;
+            }
+        }
+        // 等 CQ 里比现在多出一个
+        int ret = enter_(sqPending_, tail - head + 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+        if (ret < 0) {
+            return false;
+        }
+        sqPending_ -= std::min<unsigned>(ret, sqPending_);
+    }
+}
+
+struct io_uring_sqe* UringPoller::getSqe_() {
+    unsigned head = __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+    if (sqLocalTail_ - head >= sqEntries_) {
+        // SQ 已满, 先把积压的提交掉
+        int ret = enter_(sqPending_, 0, 0, nullptr, 0);
+        if (ret > 0) {
+            sqPending_ -= std::min<unsigned>(ret, sqPending_);
+        }
+        head = __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+        if (sqLocalTail_ - head >= sqEntries_) {
+            return nullptr;
+        }
+    }
+    unsigned idx = sqLocalTail_ & *sqMask_;
+    struct io_uring_sqe* sqe = &sqes_[idx];
+    memset(sqe, 0, sizeof(*sqe));
+    sqArray_[idx] = idx;
+    return sqe;
+}
+
+void UringPoller::commit_() {
+    // SQE 填好之后再发布 tail
+    sqLocalTail_++;
+    __atomic_store_n(sqTail_, sqLocalTail_, __ATOMIC_RELEASE);
+    sqPending_++;
+}
+
+bool UringPoller::pollAdd_(int fd) {
+    Registration& reg = regs_[fd];
+    struct io_uring_sqe* sqe = getSqe_();
+    if (!sqe) {
+        return false;
+    }
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = fd;
+    // 单次 poll 本身就是 ONESHOT 语义, 水平触发; ET 只对 multishot 有意义
+    sqe->poll32_events = reg.events & ~(EPOLLONESHOT | EPOLLET);
+    if (multishot_ && !(reg.events & EPOLLONESHOT) && (reg.events & EPOLLET)) {
+        sqe->len = IORING_POLL_ADD_MULTI;
+    }
+    sqe->user_data = (static_cast<uint64_t>(fd) << 32) | reg.seq;
+    commit_();
+    return true;
+}
+
+void UringPoller::flushIfForeign_() {
+    if (loopThread_.load() != std::this_thread::get_id() && sqPending_ > 0) {
+        int ret = enter_(sqPending_, 0, 0, nullptr, 0);
+        if (ret > 0) {
+            sqPending_ -= std::min<unsigned>(ret, sqPending_);
+        }
+    }
+}
+
+int UringPoller::enter_(unsigned toSubmit, unsigned minComplete, unsigned flags, void* arg, size_t argSize) {
+    int ret;
+    do {
+        ret = ioUringEnter(ringFd_, toSubmit, minComplete, flags, arg, argSize);
+    } while (ret < 0 && errno == EINTR);
+    return ret;
+}
+
+int UringPoller::reap_() {
+    int n = 0;
+    unsigned head = *cqHead_;
+    unsigned tail = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+    std::lock_guard<std::mutex> locker(mtx_);
+    while (head != tail && n < static_cast<int>(events_.size())) {
+        const struct io_uring_cqe* cqe = &cqes_[head & *cqMask_];
+        head++;
+        if (cqe->user_data == INTERNAL_DATA || cqe->user_data == PROBE_DATA) {
+            continue;
+        }
+        int fd = static_cast<int>((cqe->user_data & ~IO_FLAG) >> 32);
+        uint32_t seq = static_cast<uint32_t>(cqe->user_data);
+        if (static_cast<size_t>(fd) >= regs_.size()) {
+            continue;
+        }
+        Registration& reg = regs_[fd];
+        if (!reg.active || reg.seq != seq) {
+            continue;  // fd 已被 delFd, 丢弃残留的完成事件
+        }
+        if (cqe->user_data & IO_FLAG) {
+            reg.ioPending = false;
+            events_[n++] = {reg.ptr, reg.ioEvent | IO_DONE, cqe->res};
+            continue;
+        }
+        bool more = cqe->flags & IORING_CQE_F_MORE;
+        if (cqe->res >= 0) {
+            events_[n++] = {reg.ptr, static_cast<uint32_t>(cqe->res), 0};
+        } else {
+            // poll 本身失败(如 -ENOMEM), 按 epoll 的习惯报 EPOLLERR; 不报的话 ONESHOT 的连接不会再有事件, 只能等超时
+            events_[n++] = {reg.ptr, EPOLLERR, 0};
+        }
+        if (!more && !(reg.events & EPOLLONESHOT) && cqe->res != -EBADF) {
+            pollAdd_(fd);  // 持久注册(监听 fd)触发后重新挂上, 随下一次 wait() 提交
+        }
+    }
+    __atomic_store_n(cqHead_, head, __ATOMIC_RELEASE);
+    return n;
+}
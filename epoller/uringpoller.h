@@ -0,0 +1,120 @@
+#ifndef URINGPOLLER_H
+#define URINGPOLLER_H
+
+#include <linux/io_uring.h>
+#include <linux/time_types.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <csignal>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "poller.h"
+
+/*
+ * 基于 io_uring 的 Poller, 直接使用系统调用, 不依赖 liburing
+ * 就绪通知用 IORING_OP_POLL_ADD(监听 fd、eventfd、数据库连接等); 连接的读写用 IORING_OP_RECV/WRITEV 提交给内核完成,
+ * 一次 wait() 提交上一轮攒下的 recv/writev 并收割完成的, 每个请求的读、写、重新挂事件都合并进同一次 io_uring_enter
+ * 事件循环线程上的提交只写入 SQ, 在下一次 wait() 时与收割事件合并为一次 io_uring_enter
+ * 其他线程(线程池)调用时立即提交, 避免 Reactor 阻塞在 wait() 里时注册迟迟不生效
+ * modFd 只用于重新挂上已经触发过的 EPOLLONESHOT; 不带 EPOLLONESHOT 的注册在触发后自动重新挂上
+ * 不使用注册缓冲区和 provided buffer, recv 直接读进连接自己的读缓冲区; accept 和 sendfile 仍由调用方自己发系统调用
+ * 打开 ET 且内核支持时(启动时试探)持久注册用 multishot poll, 触发后不必重新提交
+ */
+class UringPoller : public Poller {
+public:
+    explicit UringPoller(int maxEvent = 1024);
+    ~UringPoller() override;
+
+    bool isValid() const;
+
+    bool addFd(int fd, uint32_t events, void* ptr) override;
+    bool modFd(int fd, uint32_t events, void* ptr) override;
+    bool delFd(int fd) override;
+
+    int wait(int timeout = -1) override;
+
+    void* getEventPtr(size_t i) const override;
+    uint32_t getEvents(size_t i) const override;
+
+    const char* name() const override { return "io_uring"; }
+
+    bool asyncIo() const override { return asyncIo_; }
+    bool submitRecv(int fd, void* buf, size_t len, void* ptr) override;
+    bool submitWritev(int fd, const struct iovec* iov, int iovcnt, void* ptr) override;
+    int getResult(size_t i) const override;
+
+private:
+    bool setup_(unsigned entries);
+    bool probe_();
+    void release_();
+    struct io_uring_sqe* getSqe_();
+    void commit_();
+    bool pollAdd_(int fd);
+    bool submitIo_(int fd, uint8_t opcode, const void* addr, uint32_t len, uint32_t event, void* ptr);
+    bool cancelIo_(uint64_t target);
+    void flushIfForeign_();
+    int enter_(unsigned toSubmit, unsigned minComplete, unsigned flags, void* arg, size_t argSize);
+    int reap_();
+
+private:
+    static const uint64_t INTERNAL_DATA = ~0ULL;     // POLL_REMOVE 的 user_data
+    static const uint64_t PROBE_DATA = ~0ULL - 1;    // 启动时试探 multishot 的 POLL_ADD
+    static const unsigned PROBE_OPS = 256;
+    static const uint64_t IO_FLAG = 1ULL << 63;      // recv/writev 的 user_data 带上这一位, 与 poll 区分
+
+    /* user_data = fd << 32 | seq, delFd 时 seq 递增, 已关闭 fd 残留的完成事件据此丢弃 */
+    struct Registration {
+        void* ptr;
+        uint32_t events;
+        uint32_t seq;
+        bool active;
+        bool ioPending;   // 有在途的 recv/writev
+        uint32_t ioEvent; // 其完成时报告的 EPOLLIN/EPOLLOUT
+    };
+
+    int ringFd_;
+    bool multishot_;
+    bool asyncIo_;  // 内核支持 RECV/WRITEV/ASYNC_CANCEL
+
+    void* sqRing_;
+    size_t sqRingSize_;
+    void* cqRing_;
+    size_t cqRingSize_;
+    struct io_uring_sqe* sqes_;
+    size_t sqesSize_;
+
+    unsigned* sqHead_;
+    unsigned* sqTail_;
+    unsigned* sqMask_;
+    unsigned* sqArray_;
+    unsigned sqEntries_;
+    unsigned sqLocalTail_;
+    unsigned sqPending_;  // 已写入 SQ 但尚未提交的数量
+
+    unsigned* cqHead_;
+    unsigned* cqTail_;
+    unsigned* cqMask_;
+    struct io_uring_cqe* cqes_;
+
+    struct Event {
+        void* ptr;
+        uint32_t events;
+        int res;  // recv/writev 的返回值
+    };
+    std::vector<Event> events_;
+    std::vector<Registration> regs_;  // 以 fd 为下标
+
+    std::mutex mtx_;
+    std::atomic<std::thread::id> loopThread_;
+};
+
+#endif  // URINGPOLLER_H
@@ -0,0 +1,476 @@
+#include "filecache.h"
+
+#include <dirent.h>
+
+#include <cerrno>
+
+OpenFile::OpenFile() : fd(-1), addr(nullptr), compressible(false) {
+    memset(&st, 0, sizeof(st));
+}
+
+OpenFile::~OpenFile() {
+    if (addr) {
+        munmap(addr, st.st_size);
+    }
+    if (fd >= 0) {
+        ::close(fd);
+    }
+}
+
+FileCache::FileCache() : resolveMeta_(nullptr), maxEntries_(0), maxBytes_(0), maxFileBytes_(0), sendfileThreshold_(0),
+                         noVariant_(std::make_shared<OpenFile>()), inotifyFd_(-1), stopFd_(-1) {
+}
+
+FileCache::~FileCache() {
+    close();
+}
+
+FileCache *FileCache::instance() {
+    static FileCache inst;
+    return &inst;
+}
+
+void FileCache::init(const std::string &root, MetaResolver resolveMeta, size_t sendfileThreshold,
+                     size_t maxEntries, size_t maxBytes) {
+    assert(resolveMeta);
+    char resolved[PATH_MAX];
+    if (!realpath(root.c_str(), resolved)) {
+        LOG_ERROR("FileCache root %s not found!", root.c_str());
+        return;
+    }
+    root_ = resolved;
+    resolveMeta_ = resolveMeta;
+    maxEntries_ = maxEntries / SHARD_NUM;
+    maxBytes_ = maxBytes / SHARD_NUM;
+    maxFileBytes_ = maxBytes_ / 4;
+    sendfileThreshold_ = sendfileThreshold;
+
+    inotifyFd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    stopFd_ = eventfd(0, EFD_CLOEXEC);
+    if (inotifyFd_ < 0 || stopFd_ < 0) {
+        // 没有失效通知就不能缓存, 退化为每次都重新打开
+        LOG_WARN("FileCache inotify init error, cache disabled!");
+        maxEntries_ = 0;
+        return;
+    }
+    addWatch_("");
+    watchThread_.reset(new std::thread(&FileCache::watchLoop_, this));
+}
+
+void FileCache::close() {
+    if (watchThread_ && watchThread_->joinable()) {
+        uint64_t one = 1;
+        ssize_t ret = ::write(stopFd_, &one, sizeof(one));
+        (void)ret;
+        watchThread_->join();
+    }
+    watchThread_.reset();
+    if (inotifyFd_ >= 0) {
+        ::close(inotifyFd_);
+        inotifyFd_ = -1;
+    }
+    if (stopFd_ >= 0) {
+        ::close(stopFd_);
+        stopFd_ = -1;
+    }
+    clear();
+}
+
+std::shared_ptr<const OpenFile> FileCache::get(const std::string &path) {
+    if (path.find('\0') != std::string::npos) {
+        return nullptr;  // '\0' 只用在压缩版本的键里
+    }
+    Shard &shard = shard_(path);
+    uint64_t version;
+    {
+        std::lock_guard<std::mutex> locker(shard.mtx);
+        auto it = shard.map.find(path);
+        if (it != shard.map.end()) {
+            shard.lru.splice(shard.lru.begin(), shard.lru, it->second.second);
+            return it->second.first;
+        }
+        auto miss = shard.misses.find(path);
+        if (miss != shard.misses.end()) {
+            shard.missLru.splice(shard.missLru.begin(), shard.missLru, miss->second);
+            return nullptr;
+        }
+        version = shard.version;
+    }
+
+    /* 未命中, 不持锁加载 */
+    bool missing = false;
+    std::shared_ptr<const OpenFile> file = load_(path, &missing);
+    if (!file && missing && maxEntries_ > 0) {
+        std::lock_guard<std::mutex> locker(shard.mtx);
+        if (shard.version == version) {
+            addMiss_(shard, path);
+        }
+        return nullptr;
+    }
+    if (!file || cost_(*file) > maxFileBytes_ || maxEntries_ == 0) {
+        return file;
+    }
+
+    std::lock_guard<std::mutex> locker(shard.mtx);
+    if (shard.version != version) {
+        return file;  // 加载期间有失效通知, 这份结果可能已经过期, 不放进缓存
+    }
+    auto it = shard.map.find(path);
+    if (it != shard.map.end()) {
+        return it->second.first;  // 其他线程已经加载过
+    }
+    shard.lru.push_front(path);
+    shard.map.emplace(path, std::make_pair(file, shard.lru.begin()));
+    shard.bytes += cost_(*file);
+    evict_(shard);
+    return file;
+}
+
+std::shared_ptr<const OpenFile> FileCache::getEncoded(const std::string &path, ENCODING enc) {
+    std::string key = variantKey_(path, enc);
+    Shard &shard = shard_(key);
+    uint64_t version;
+    {
+        std::lock_guard<std::mutex> locker(shard.mtx);
+        auto it = shard.map.find(key);
+        if (it != shard.map.end()) {
+            shard.lru.splice(shard.lru.begin(), shard.lru, it->second.second);
+            return it->second.first == noVariant_ ? nullptr : it->second.first;
+        }
+        version = shard.version;
+    }
+
+    /* 原文件变化时 invalidate() 同时使本键失效, 所以版本号要在取原文件之前记下 */
+    std::shared_ptr<const OpenFile> raw = get(path);
+    if (!raw || raw->fd < 0) {
+        return nullptr;
+    }
+    std::shared_ptr<const OpenFile> file;
+    if (raw->compressible) {
+        file = get(path + (enc == BR ? ".br" : ".gz"));
+        if (file && (file->fd < 0 || file->st.st_mtime < raw->st.st_mtime)) {
+            file = nullptr;  // 比原文件旧的预压缩文件不用
+        }
+        if (!file && enc == GZIP) {
+            file = compress_(*raw);
+        }
+    }
+    if (!file) {
+        file = noVariant_;
+    }
+
+    if (maxEntries_ > 0 && cost_(*file) <= maxFileBytes_) {
+        std::lock_guard<std::mutex> locker(shard.mtx);
+        if (shard.version == version && shard.map.find(key) == shard.map.end()) {
+            shard.lru.push_front(key);
+            shard.map.emplace(key, std::make_pair(file, shard.lru.begin()));
+            shard.bytes += cost_(*file);
+            evict_(shard);
+        }
+    }
+    return file == noVariant_ ? nullptr : file;
+}
+
+void FileCache::invalidate(const std::string &path) {
+    invalidateKey_(path);
+    invalidateKey_(variantKey_(path, GZIP));
+    invalidateKey_(variantKey_(path, BR));
+    /* 预压缩文件 x.gz / x.br 变化时, x 对应的压缩版本也要失效 */
+    if (path.size() > 3) {
+        std::string suffix = path.substr(path.size() - 3);
+        if (suffix == ".gz") {
+            invalidateKey_(variantKey_(path.substr(0, path.size() - 3), GZIP));
+        } else if (suffix == ".br") {
+            invalidateKey_(variantKey_(path.substr(0, path.size() - 3), BR));
+        }
+    }
+}
+
+void FileCache::invalidateKey_(const std::string &key) {
+    Shard &shard = shard_(key);
+    std::lock_guard<std::mutex> locker(shard.mtx);
+    shard.version++;
+    auto it = shard.map.find(key);
+    if (it != shard.map.end()) {
+        shard.bytes -= cost_(*it->second.first);
+        shard.lru.erase(it->second.second);
+        shard.map.erase(it);
+    }
+    auto miss = shard.misses.find(key);
+    if (miss != shard.misses.end()) {
+        shard.missLru.erase(miss->second);
+        shard.misses.erase(miss);
+    }
+}
+
+void FileCache::clear() {
+    for (Shard &shard : shards_) {
+        std::lock_guard<std::mutex> locker(shard.mtx);
+        shard.version++;
+        shard.map.clear();
+        shard.lru.clear();
+        shard.bytes = 0;
+        shard.misses.clear();
+        shard.missLru.clear();
+    }
+}
+
+bool FileCache::cached(const std::string &path, bool acceptGzip, bool acceptBr) {
+    std::shared_ptr<const OpenFile> raw = peek_(path);
+    if (!raw) {
+        return false;
+    }
+    if (raw == noVariant_ || !raw->compressible || raw->fd < 0) {
+        return true;  // noVariant_ 为已知不存在的路径, 回 404 也不碰文件系统
+    }
+    // 与 HttpResponse::negotiate_ 的顺序一致: 先看 br, 没有 br 版本再看 gzip
+    if (acceptBr) {
+        std::shared_ptr<const OpenFile> br = peek_(variantKey_(path, BR));
+        if (!br) {
+            return false;
+        }
+        if (br != noVariant_) {
+            return true;
+        }
+    }
+    return !acceptGzip || peek_(variantKey_(path, GZIP)) != nullptr;
+}
+
+std::shared_ptr<const OpenFile> FileCache::peek_(const std::string &key) {
+    Shard &shard = shard_(key);
+    std::lock_guard<std::mutex> locker(shard.mtx);
+    auto it = shard.map.find(key);
+    if (it != shard.map.end()) {
+        return it->second.first;
+    }
+    return shard.misses.count(key) ? noVariant_ : nullptr;
+}
+
+FileCache::Shard &FileCache::shard_(const std::string &path) {
+    return shards_[std::hash<std::string>()(path) % SHARD_NUM];
+}
+
+std::shared_ptr<const OpenFile> FileCache::load_(const std::string &path, bool *missing) {
+    *missing = false;
+    if (root_.empty()) {
+        return nullptr;
+    }
+    if (path.empty() || path[0] != '/') {
+        *missing = true;
+        return nullptr;
+    }
+    std::string full = root_ + path;
+    char resolved[PATH_MAX];
+    if (!realpath(full.c_str(), resolved)) {
+        *missing = errno == ENOENT || errno == ENOTDIR || errno == ENAMETOOLONG;
+        return nullptr;
+    }
+    // 解析符号链接和 ".." 之后必须仍在根目录下
+    if (strncmp(resolved, root_.c_str(), root_.size()) != 0 || resolved[root_.size()] != '/') {
+        LOG_WARN("Reject path %s outside srcDir", path.c_str());
+        *missing = true;
+        return nullptr;
+    }
+
+    std::shared_ptr<OpenFile> file = std::make_shared<OpenFile>();
+    if (stat(resolved, &file->st) < 0 || !S_ISREG(file->st.st_mode)) {
+        *missing = true;
+        return nullptr;
+    }
+    resolveMeta_(path, file.get());
+
+    /* 校验器随条目缓存, 文件被改动时 inotify 使条目失效, 下次加载重新生成 */
+    char buf[64];
+    snprintf(buf, sizeof(buf), "\"%lx-%lx-%lx\"", (unsigned long)file->st.st_mtim.tv_sec,
+             (unsigned long)file->st.st_mtim.tv_nsec, (unsigned long)file->st.st_size);
+    file->etag = buf;
+    struct tm tm;
+    gmtime_r(&file->st.st_mtime, &tm);
+    strftime(buf, sizeof(buf), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+    file->lastModified = buf;
+
+    if (!(file->st.st_mode & S_IROTH)) {
+        return file;  // 由调用方返回 403
+    }
+    file->fd = open(resolved, O_RDONLY | O_CLOEXEC);
+    if (file->fd < 0) {
+        return nullptr;
+    }
+    if (file->st.st_size > 0 && (sendfileThreshold_ == 0 || static_cast<size_t>(file->st.st_size) < sendfileThreshold_)) {
+        void *addr = mmap(nullptr, file->st.st_size, PROT_READ, MAP_PRIVATE, file->fd, 0);
+        if (addr == MAP_FAILED) {
+            return nullptr;
+        }
+        file->addr = static_cast<char *>(addr);
+    }
+    LOG_DEBUG("FileCache load %s", resolved);
+    return file;
+}
+
+/* 负缓存的条目数与文件条目的上限相同, 另行淘汰; 扫描式的大量 404 只会挤掉别的负缓存 */
+void FileCache::addMiss_(Shard &shard, const std::string &path) {
+    if (shard.misses.count(path)) {
+        return;
+    }
+    shard.missLru.push_front(path);
+    shard.misses.emplace(path, shard.missLru.begin());
+    while (shard.misses.size() > maxEntries_) {
+        shard.misses.erase(shard.missLru.back());
+        shard.missLru.pop_back();
+    }
+}
+
+void FileCache::evict_(Shard &shard) {
+    while ((shard.map.size() > maxEntries_ || shard.bytes > maxBytes_) && !shard.lru.empty()) {
+        auto it = shard.map.find(shard.lru.back());
+        shard.bytes -= cost_(*it->second.first);
+        shard.map.erase(it);
+        shard.lru.pop_back();
+    }
+}
+
+std::shared_ptr<const OpenFile> FileCache::compress_(const OpenFile &raw) {
+    /* 只压缩已映射的文件, 超过 sendfile 阈值的大文件原样发送 */
+    if (!raw.addr || raw.st.st_size < MIN_COMPRESS_BYTES) {
+        return nullptr;
+    }
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    // windowBits 加 16 输出 gzip 格式
+    if (deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return nullptr;
+    }
+    std::vector<char> out(deflateBound(&zs, raw.st.st_size));
+    zs.next_in = reinterpret_cast<Bytef *>(raw.addr);
+    zs.avail_in = raw.st.st_size;
+    zs.next_out = reinterpret_cast<Bytef *>(out.data());
+    zs.avail_out = out.size();
+    int ret = deflate(&zs, Z_FINISH);
+    size_t len = zs.total_out;
+    deflateEnd(&zs);
+    if (ret != Z_STREAM_END || len >= static_cast<size_t>(raw.st.st_size)) {
+        return nullptr;  // 压不小就不用
+    }
+
+    std::shared_ptr<OpenFile> file = std::make_shared<OpenFile>();
+    file->fd = memfd_create("filecache-gzip", MFD_CLOEXEC);
+    if (file->fd < 0) {
+        LOG_WARN("memfd_create error: %d", errno);
+        return nullptr;
+    }
+    for (size_t done = 0; done < len;) {
+        ssize_t n = ::write(file->fd, out.data() + done, len - done);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return nullptr;
+        }
+        done += n;
+    }
+    void *addr = mmap(nullptr, len, PROT_READ, MAP_PRIVATE, file->fd, 0);
+    if (addr == MAP_FAILED) {
+        return nullptr;
+    }
+    file->addr = static_cast<char *>(addr);
+    file->st = raw.st;
+    file->st.st_size = len;
+    file->type = raw.type;
+    file->cacheControl = raw.cacheControl;
+    // 不同编码是不同的表示, 实体标签不能相同
+    file->etag = raw.etag.substr(0, raw.etag.size() - 1) + "-gzip\"";
+    file->lastModified = raw.lastModified;
+    LOG_DEBUG("FileCache gzip %ld -> %zu", (long)raw.st.st_size, len);
+    return file;
+}
+
+std::string FileCache::variantKey_(const std::string &path, ENCODING enc) {
+    std::string key = path;
+    key += '\0';
+    key += enc == BR ? "br" : "gzip";
+    return key;
+}
+
+size_t FileCache::cost_(const OpenFile &file) {
+    return file.addr ? file.st.st_size : 0;
+}
+
+void FileCache::addWatch_(const std::string &relDir) {
+    const uint32_t mask = IN_MODIFY | IN_ATTRIB | IN_CLOSE_WRITE | IN_CREATE | IN_DELETE |
+                          IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF;
+    std::string dir = root_ + relDir;
+    int wd = inotify_add_watch(inotifyFd_, dir.c_str(), mask);
+    if (wd < 0) {
+        LOG_WARN("inotify watch %s error!", dir.c_str());
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> locker(watchMtx_);
+        watches_[wd] = relDir;
+    }
+
+    DIR *dp = opendir(dir.c_str());
+    if (!dp) {
+        return;
+    }
+    while (struct dirent *ent = readdir(dp)) {
+        if (ent->d_type == DT_DIR && strcmp(ent->d_name, ".") != 0 && strcmp(ent->d_name, "..") != 0) {
+            addWatch_(relDir + "/" + ent->d_name);
+        }
+    }
+    closedir(dp);
+}
+
+void FileCache::watchLoop_() {
+    alignas(struct inotify_event) char buf[4096];
+    struct pollfd fds[2] = {{inotifyFd_, POLLIN, 0}, {stopFd_, POLLIN, 0}};
+    while (true) {
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        if (fds[1].revents & POLLIN) {
+            break;
+        }
+        ssize_t len = read(inotifyFd_, buf, sizeof(buf));
+        if (len <= 0) {
+            continue;
+        }
+        for (char *p = buf; p < buf + len;) {
+            struct inotify_event *ev = reinterpret_cast<struct inotify_event *>(p);
+            p += sizeof(struct inotify_event) + ev->len;
+
+            if (ev->mask & IN_Q_OVERFLOW) {
+                clear();  // 丢了事件, 无法确定哪些条目过期
+                continue;
+            }
+            std::string relDir;
+            {
+                std::lock_guard<std::mutex> locker(watchMtx_);
+                auto it = watches_.find(ev->wd);
+                if (it == watches_.end()) {
+                    continue;
+                }
+                relDir = it->second;
+                if (ev->mask & IN_IGNORED) {
+                    watches_.erase(it);
+                    continue;
+                }
+            }
+            if (ev->mask & (IN_DELETE_SELF | IN_MOVE_SELF)) {
+                clear();
+            } else if (ev->mask & IN_ISDIR) {
+                if (ev->mask & (IN_CREATE | IN_MOVED_TO)) {
+                    addWatch_(relDir + "/" + ev->name);
+                }
+                if (ev->mask & (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO)) {
+                    clear();  // 整个子目录变化, 直接清空; 新建的目录下的路径可能已被负缓存
+                }
+            } else if (ev->len > 0) {
+                invalidate(relDir + "/" + ev->name);
+            }
+        }
+    }
+}
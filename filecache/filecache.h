@@ -0,0 +1,133 @@
+#ifndef FILECACHE_H
+#define FILECACHE_H
+
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/mman.h>  // mmap memfd_create
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <cassert>
+#include <cstring>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <zlib.h>
+
+#include "../log/log.h"
+
+/* 缓存中的一个静态文件: fd、stat、长期映射和各种响应头字段, 只读共享 */
+struct OpenFile {
+    OpenFile();
+    ~OpenFile();
+    OpenFile(const OpenFile &) = delete;
+    OpenFile &operator=(const OpenFile &) = delete;
+
+    int fd;              // 无读权限时为 -1
+    struct stat st;
+    char *addr;          // 整个文件的映射, 空文件、无读权限或达到 sendfile 阈值时为 nullptr
+    std::string type;          // Content-Type
+    std::string cacheControl;  // 按后缀配置, 为空时不发 Cache-Control
+    bool compressible;         // 文本类内容, 可以协商压缩
+    std::string etag;          // 由 mtime 和大小生成, 文件一变就跟着变
+    std::string lastModified;  // mtime 的 HTTP-date 形式
+};
+
+/*
+ * 静态资源的打开文件缓存, 以请求路径(相对于资源根目录)为键
+ * 分片加锁, 每个分片各自按 LRU 淘汰, 条目数和映射字节数都有上限
+ * 不小于 sendfile 阈值的文件只保留 fd 不做映射, 由调用方用 sendfile 发送, 不计入映射字节数
+ * 后台线程通过 inotify 监听资源目录, 文件被修改、删除或移动时使对应条目失效
+ * 命中时不产生任何文件系统调用; 已被取走的条目在引用释放前一直有效
+ * 不存在的路径也记下(负缓存, 单独按 LRU 淘汰, 不挤占文件条目), 重复的 404 同样不碰文件系统; 文件出现时由 inotify 失效
+ * 压缩版本以 "路径\0编码" 为键放在同一个缓存里: 优先用同目录下预压缩的 .br/.gz,
+ * 没有时 gzip 在第一次请求时压缩到 memfd 中, 之后和普通文件一样映射或 sendfile
+ */
+class FileCache {
+public:
+    /* 按路径填充 type、cacheControl 等与内容无关的字段, 每个文件版本只调用一次 */
+    using MetaResolver = void (*)(const std::string &path, OpenFile *file);
+
+    enum ENCODING {
+        GZIP = 0,
+        BR,
+    };
+
+    static FileCache *instance();
+    /* sendfileThreshold 为 0 时所有文件都映射 */
+    void init(const std::string &root, MetaResolver resolveMeta, size_t sendfileThreshold = 256 << 10,
+              size_t maxEntries = 1024, size_t maxBytes = 64 << 20);
+    void close();
+
+    /* path 以 '/' 开头; 文件不存在、是目录或越出根目录时返回 nullptr */
+    std::shared_ptr<const OpenFile> get(const std::string &path);
+    /* path 的压缩版本, 没有可用版本(不可压缩、压不小、br 无预压缩文件)时返回 nullptr */
+    std::shared_ptr<const OpenFile> getEncoded(const std::string &path, ENCODING enc);
+    void invalidate(const std::string &path);
+    void clear();
+    /*
+     * 请求 path 时能否不碰文件系统: 原文件已在缓存中, 可压缩时客户端可接受的压缩版本也已确定(有或没有)
+     * 只查表, 不加载也不改变 LRU 顺序, 供分派请求前判断代价
+     */
+    bool cached(const std::string &path, bool acceptGzip, bool acceptBr);
+
+private:
+    FileCache();
+    ~FileCache();
+
+    struct Shard {
+        std::mutex mtx;
+        std::list<std::string> lru;  // 表头最近使用
+        std::unordered_map<std::string, std::pair<std::shared_ptr<const OpenFile>, std::list<std::string>::iterator>> map;
+        size_t bytes = 0;
+        uint64_t version = 0;  // 每次失效递增, 用来丢弃加载期间过期的结果
+        std::list<std::string> missLru;  // 不存在的路径, 表头最近使用
+        std::unordered_map<std::string, std::list<std::string>::iterator> misses;
+    };
+
+    Shard &shard_(const std::string &path);
+    std::shared_ptr<const OpenFile> peek_(const std::string &key);
+    /* 加载失败时 *missing 表示路径确实不存在(或不是普通文件、越出根目录), 可以负缓存; 打开、映射失败等临时错误不算 */
+    std::shared_ptr<const OpenFile> load_(const std::string &path, bool *missing);
+    void addMiss_(Shard &shard, const std::string &path);
+    void evict_(Shard &shard);
+    void invalidateKey_(const std::string &key);
+    std::shared_ptr<const OpenFile> compress_(const OpenFile &raw);
+    static size_t cost_(const OpenFile &file);
+    static std::string variantKey_(const std::string &path, ENCODING enc);
+
+    void addWatch_(const std::string &relDir);
+    void watchLoop_();
+
+private:
+    static const int SHARD_NUM = 16;
+    static const off_t MIN_COMPRESS_BYTES = 256;  // 再小的文件压缩收益抵不过头部开销
+
+    std::string root_;      // 绝对路径, 不带末尾 '/'
+    MetaResolver resolveMeta_;
+    size_t maxEntries_;     // 每个分片
+    size_t maxBytes_;       // 每个分片
+    size_t maxFileBytes_;   // 映射超过此大小的文件不进缓存, 用完即关
+    size_t sendfileThreshold_;
+
+    Shard shards_[SHARD_NUM];
+    std::shared_ptr<const OpenFile> noVariant_;  // 缓存 "没有压缩版本" 的结果, 避免每次都去找; peek_ 对负缓存的路径也返回它
+
+    int inotifyFd_;
+    int stopFd_;
+    std::mutex watchMtx_;
+    std::unordered_map<int, std::string> watches_;  // wd -> 相对目录, 如 "" 或 "/css"
+    std::unique_ptr<std::thread> watchThread_;
+};
+
+#endif  // FILECACHE_H
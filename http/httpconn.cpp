@@ -1,13 +1,21 @@
 #include "httpconn.h"
 
+#include <chrono>
+
 const char *HttpConn::srcDir;
 std::atomic<int> HttpConn::userCount;
 bool HttpConn::isET;
+int HttpConn::maxRequests;
+int HttpConn::keepAliveTimeout;
 
 HttpConn::HttpConn() {
     fd_ = -1;
     addr_ = {0};
     isClose_ = true;
+    keepAlive_ = false;
+    requestCnt_ = 0;
+    writtenBytes_ = 0;
+    corked_ = false;
 }
 
 HttpConn::~HttpConn() {
@@ -20,7 +28,11 @@ void HttpConn::init(int sockFd, const sockaddr_in &addr) {
     addr_ = addr;
     fd_ = sockFd;
     readBuff_.retrieveAll();
-    writeBuff_.retrieveAll();
+    finishBatch_();
+    request_.init();
+    keepAlive_ = false;
+    requestCnt_ = 0;
+    writtenBytes_ = 0;
     isClose_ = false;
     LOG_INFO("Client[%d](%s:%d) in,userCount:%d", fd_, getIP(), getPort(), (int)userCount);
 }
@@ -38,34 +50,57 @@ ssize_t HttpConn::read(int *saveErrno) {
 
 ssize_t HttpConn::write(int *saveErrno) {
     ssize_t len = -1;
+    if (output_.hasFile() && !corked_) {
+        setCork_(true);
+    }
     do {
-        len = writev(fd_, iov_, iovCnt_);
-        if (len <= 0) {
-            *saveErrno = errno;
+        len = output_.writeTo(fd_, saveErrno);
+        if (len <= 0 || onWritten_(len)) {
             break;
         }
-
-        if (iov_[0].iov_len + iov_[1].iov_len == 0) {
-            break;
-        } else if (static_cast<size_t>(len) > iov_[0].iov_len) {
-            iov_[1].iov_base = (uint8_t *)iov_[1].iov_base + (len - iov_[0].iov_len);
-            iov_[1].iov_len -= (len - iov_[0].iov_len);
-            if (iov_[0].iov_len) {
-                writeBuff_.retrieveAll();
-                iov_[0].iov_len = 0;
-            }
-        } else {
-            iov_[0].iov_base = (uint8_t *)iov_[0].iov_base + len;
-            iov_[0].iov_len -= len;
-            writeBuff_.retrieve(len);
-        }
-
     } while (isET || toWriteBytes() > 10240);
     return len;
 }
 
+char *HttpConn::recvBuffer(size_t *len) {
+    return readBuff_.prepareRead(len);
+}
+
+void HttpConn::recvDone(size_t n) {
+    readBuff_.hasWritten(n);
+}
+
+int HttpConn::sendIov(const struct iovec **iov) {
+    if (output_.hasFile()) {
+        return 0;
+    }
+    return output_.gather(iov);
+}
+
+void HttpConn::sendDone(size_t n) {
+    output_.advance(n);
+    onWritten_(n);
+}
+
+/* 记账已发出的字节, 整批发完时收尾并返回 true */
+bool HttpConn::onWritten_(size_t len) {
+    writtenBytes_ += len;
+    if (!output_.empty()) {
+        return false;
+    }
+    if (corked_) {
+        setCork_(false);  // 取消 CORK 时内核立即发出剩余数据
+    }
+    finishBatch_();
+    return true;
+}
+
 void HttpConn::close() {
     response_.unmapFile();
+    finishBatch_();
+    // 连接槽会一直留着, 缓冲区的存储还给内存池
+    readBuff_.release();
+    writeBuff_.release();
     if (isClose_ == false) {
         isClose_ = true;
         userCount--;
@@ -74,6 +109,10 @@ void HttpConn::close() {
     }
 }
 
+bool HttpConn::isClosed() const {
+    return isClose_;
+}
+
 int HttpConn::getFd() const {
     return fd_;
 }
@@ -90,37 +129,181 @@ sockaddr_in HttpConn::getAddr() const {
     return addr_;
 }
 
-bool HttpConn::process() {
-    request_.init();
-    if (readBuff_.readableBytes() <= 0) {
+bool HttpConn::process(RouteStats::LANE lane, bool cold) {
+    return process_(lane, true, cold);
+}
+
+bool HttpConn::process_(RouteStats::LANE lane, bool routed, bool cold) {
+    /*
+     * 解析状态跨读保留, 不完整的请求等下次读到数据后接着解析
+     * readBuff_ 中所有完整的请求(流水线)都在这里处理掉, 响应合并成一批, 由 write() 一次 writev 发出
+     * 处理耗时按路由抽样记入 RouteStats(见 RouteStats::sample), 文件不在缓存中的冷请求除外
+     * routed 时第一个请求的通道由调用方算好; 其余请求的通道既不是 lane 也不是 LANE_INLINE 时停下, 留给 Reactor 重新分派
+     * (CPU 通道上不查数据库, IO 通道的协程在 Reactor 线程上, 也不处理该交给 CPU 通道的请求)
+     * 要查库的请求在 IO 通道上停在校验之前, 由调用方异步校验后 finishAuth 接着处理; 在其他通道上就地校验
+     */
+    int responseCnt = 0;
+    bool isLogin = false;
+    while (!request_.needsAuth(&isLogin) && readBuff_.readableBytes() > 0 && responseCnt < MAX_PIPELINE) {
+        bool hasRoute = nextRoute(&route_);
+        bool first = routed && responseCnt == 0;
+        bool routeCold = first && cold;
+        if (!first && hasRoute) {
+            RouteStats::LANE next = laneOf(route_, &routeCold);
+            if (next != lane && next != RouteStats::LANE_INLINE) {
+                break;
+            }
+        }
+        bool timed = hasRoute && !routeCold && RouteStats::sample();
+        std::chrono::steady_clock::time_point start;
+        if (timed) {
+            start = std::chrono::steady_clock::now();
+        }
+        HttpRequest::HTTP_CODE ret = request_.parse(readBuff_);
+        if (ret == HttpRequest::NO_REQUEST) {
+            break;
+        }
+        requestCnt_++;
+        if (ret == HttpRequest::GET_REQUSET && request_.needsAuth(&isLogin)) {
+            if (lane == RouteStats::LANE_IO) {
+                break;
+            }
+            request_.finishAuth(HttpRequest::userVerify(request_.getPost("username"), request_.getPost("password"), isLogin));
+        }
+        respond_(ret);
+        if (timed) {
+            auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+            RouteStats::instance()->record(route_, ns);
+        }
+        responseCnt++;
+        if (!keepAlive_) {
+            break;  // 之后的请求不再处理, 写完即关闭
+        }
+    }
+    if (output_.empty()) {
+        return false;
+    }
+    LOG_DEBUG("responses:%d, segCnt:%zu, to write:%zu", responseCnt, output_.segmentCount(), toWriteBytes());
+    return true;
+}
+
+bool HttpConn::pendingAuth(std::string *name, std::string *pwd, bool *isLogin) const {
+    if (!request_.needsAuth(isLogin)) {
         return false;
-    } else if (request_.parse(readBuff_)) {
+    }
+    *name = request_.getPost("username");
+    *pwd = request_.getPost("password");
+    return true;
+}
+
+bool HttpConn::finishAuth(HttpRequest::AUTH_RESULT result) {
+    request_.finishAuth(result);
+    respond_(HttpRequest::GET_REQUSET);
+    if (keepAlive_) {
+        process_(RouteStats::LANE_IO, false, false);  // 后面流水线的请求没有分派过
+    }
+    return !output_.empty();
+}
+
+void HttpConn::respond_(HttpRequest::HTTP_CODE ret) {
+    if (ret == HttpRequest::GET_REQUSET) {
         LOG_DEBUG("%s", request_.path().c_str());
-        response_.init(srcDir, request_.path(), request_.isKeepAlive(), 200);
+        /* 达到请求数上限的这个响应带 Connection: close, 写完即关闭 */
+        keepAlive_ = request_.isKeepAlive() && (maxRequests <= 0 || requestCnt_ < maxRequests);
+        response_.init(srcDir, request_.path(), keepAlive_, request_.status());
+        if (keepAlive_) {
+            response_.setKeepAlive(keepAliveTimeout, maxRequests > 0 ? maxRequests - requestCnt_ : 0);
+        }
+        if (request_.method() == "GET") {
+            response_.setConditional(request_.header("If-None-Match"), request_.header("If-Modified-Since"));
+            response_.setRange(request_.header("Range"), request_.header("If-Range"));
+            response_.setAcceptEncoding(request_.header("Accept-Encoding"));
+        }
     } else {
+        keepAlive_ = false;
+        readBuff_.retrieveAll();
         response_.init(srcDir, request_.path(), false, 400);
     }
+    request_.init();
+    appendResponse_();
+}
+
+bool HttpConn::nextRoute(std::string *key) const {
+    return RouteStats::routeKey(readBuff_.peek(), readBuff_.readableBytes(), key);
+}
+
+RouteStats::LANE HttpConn::laneOf(const std::string &key, bool *cold) const {
+    return RouteStats::instance()->lane(key, std::string_view(readBuff_.peek(), readBuff_.readableBytes()), cold);
+}
+
+size_t HttpConn::toWriteBytes() const {
+    return output_.size();
+}
+
+bool HttpConn::isKeepAlive() const {
+    return keepAlive_;
+}
+
+int HttpConn::requestCount() const {
+    return requestCnt_;
+}
+
+bool HttpConn::hasPartialRequest() const {
+    return readBuff_.readableBytes() > 0;
+}
 
+bool HttpConn::isReadingBody() const {
+    return request_.state() == HttpRequest::BODY;
+}
+
+uint64_t HttpConn::writtenBytes() const {
+    return writtenBytes_;
+}
+
+void HttpConn::appendResponse_() {
+    /* 响应头在 writeBuff_ 中生成后拷进队列, 和前一个响应的头部合并成一段 */
     response_.makeResponse(writeBuff_);
-    /* 响应头 */
-    iov_[0].iov_base = const_cast<char *>(writeBuff_.peek());
-    iov_[0].iov_len = writeBuff_.readableBytes();
-    iovCnt_ = 1;
-
-    /* 文件 */
-    if (response_.fileLen() > 0 && response_.file()) {
-        iov_[1].iov_base = response_.file();
-        iov_[1].iov_len = response_.fileLen();
-        iovCnt_ = 2;
+    output_.append(writeBuff_.peek(), writeBuff_.readableBytes());
+    writeBuff_.retrieveAll();
+
+    /* 文件: 整个文件或 206 的各个区间, multipart 时每段前后插入分隔行 */
+    if (response_.hasFileBody()) {
+        const std::shared_ptr<const OpenFile> &file = response_.fileHandle();
+        const auto &ranges = response_.ranges();
+        if (ranges.empty()) {
+            appendFile_(file, 0, file->st.st_size);
+            return;
+        }
+        for (size_t i = 0; i < ranges.size(); i++) {
+            appendPartHeader_(i);
+            appendFile_(file, ranges[i].first, ranges[i].second);
+        }
+        appendPartHeader_(ranges.size());
+    }
+}
+
+void HttpConn::appendFile_(const std::shared_ptr<const OpenFile> &file, off_t off, size_t len) {
+    /* 已映射的共享映射区走 writev, 超过 sendfile 阈值未映射的走 sendfile; 段持有缓存条目的引用 */
+    if (file->addr) {
+        output_.appendShared(file, file->addr + off, len);
+    } else {
+        output_.appendFile(file, file->fd, off, len);
     }
-    LOG_DEBUG("filesize:%d, %d  to %d", response_.fileLen(), iovCnt_, toWriteBytes());
-    return true;
 }
 
-int HttpConn::toWriteBytes() {
-    return iov_[0].iov_len + iov_[1].iov_len;
+void HttpConn::appendPartHeader_(size_t i) {
+    output_.append(response_.partHeader(i));  // 单段 206 没有分隔行, 为空串
 }
 
-bool HttpConn::isKeepAlive() const {
-    return request_.isKeepAlive();
-}
\ No newline at end of file
+void HttpConn::finishBatch_() {
+    writeBuff_.retrieveAll();
+    output_.clear();
+    corked_ = false;
+}
+
+void HttpConn::setCork_(bool on) {
+    int val = on ? 1 : 0;
+    if (setsockopt(fd_, IPPROTO_TCP, TCP_CORK, &val, sizeof(val)) == 0) {
+        corked_ = on;
+    }
+}
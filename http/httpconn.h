@@ -2,14 +2,18 @@
 #define HTTP_CONN_H
 
 #include <arpa/inet.h>
+#include <netinet/tcp.h>
 
 #include <atomic>
+#include <memory>
+#include <vector>
 
 #include "../buffer/buffer.h"
+#include "../buffer/outputqueue.h"
 #include "../log/log.h"
-#include "../sqlconnpool/sqlconnRAII.h"
 #include "httprequest.h"
 #include "httpresponse.h"
+#include "routestats.h"
 
 class HttpConn {
 public:
@@ -21,36 +25,75 @@ public:
     ssize_t read(int *saveErrno);
     ssize_t write(int *saveErrno);
 
+    /* 由 Poller 代为读写时(io_uring): 读缓冲区留出的空间 / 收到 n 字节; 待发的内存段 / 发出 n 字节 */
+    char *recvBuffer(size_t *len);
+    void recvDone(size_t n);
+    int sendIov(const struct iovec **iov);  // 本批含文件段时返回 0, 整批走 write() 的 sendfile + CORK
+    void sendDone(size_t n);
+
     void close();
+    bool isClosed() const;
 
     int getFd() const;
     int getPort() const;
     const char *getIP() const;
     sockaddr_in getAddr() const;
 
-    bool process();
-
-    int toWriteBytes();
+    /*
+     * 在 lane 通道上处理读缓冲区中的请求, 有响应要写时返回 true
+     * lane 和 cold 是调用方分派时为第一个请求算好的(见 laneOf), 这里不再重复计算
+     */
+    bool process(RouteStats::LANE lane, bool cold = false);
+    /* IO 通道上停在查库前的请求: 取出校验参数, 校验完用结果继续处理 */
+    bool pendingAuth(std::string *name, std::string *pwd, bool *isLogin) const;
+    bool finishAuth(HttpRequest::AUTH_RESULT result);
+    bool nextRoute(std::string *key) const;  // 读缓冲区中下一个请求的路由键
+    RouteStats::LANE laneOf(const std::string &key, bool *cold = nullptr) const;  // 该请求的执行通道, 会看请求头和 FileCache
+
+    size_t toWriteBytes() const;
     bool isKeepAlive() const;
 
+    /* 供 Reactor 判断连接所处的阶段, 以选用对应的超时 */
+    int requestCount() const;
+    bool hasPartialRequest() const;  // 读缓冲区里有还没凑齐的请求
+    bool isReadingBody() const;      // 请求头已收齐, 正在收请求体
+    uint64_t writtenBytes() const;   // 连接建立以来写出的总字节数
+
     static bool isET;
     static const char *srcDir;
     static std::atomic<int> userCount;
+    static int maxRequests;       // 每个连接最多处理的请求数, <= 0 不限
+    static int keepAliveTimeout;  // 空闲超时(秒), 只用于 Keep-Alive 响应头
 
 private:
+    bool process_(RouteStats::LANE lane, bool routed, bool cold);
+    void respond_(HttpRequest::HTTP_CODE ret);
+    void appendResponse_();
+    void appendFile_(const std::shared_ptr<const OpenFile> &file, off_t off, size_t len);
+    void appendPartHeader_(size_t i);
+    bool onWritten_(size_t len);
+    void finishBatch_();
+    void setCork_(bool on);
+
+    static const int MAX_PIPELINE = 32;  // 一批最多合并的响应数
+
     int fd_;
     struct sockaddr_in addr_;
 
     bool isClose_;
+    bool keepAlive_;  // 本批最后一个响应是否保持连接
+    int requestCnt_;
+    uint64_t writtenBytes_;
 
-    int iovCnt_;
-    struct iovec iov_[2];
+    OutputQueue output_;  // 本批所有响应: 响应头拷进队列, 文件内容按引用排队
+    bool corked_;         // 本批含文件段时写的过程中 TCP_CORK, 免得响应头单独成包
 
     Buffer readBuff_;   // 读缓存区
-    Buffer writeBuff_;  // 写缓存区
+    Buffer writeBuff_;  // 生成响应头用的暂存区
 
     HttpRequest request_;
     HttpResponse response_;
+    std::string route_;  // 正在处理的请求的路由键, 用于统计耗时
 };
 
 #endif  // HTTP_CONN_H
\ No newline at end of file
@@ -1,5 +1,11 @@
 #include "httprequest.h"
 
+#include "../userstore/userstore.h"
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
 const std::unordered_set<std::string> HttpRequest::DEFAULT_HTML{
     "/index",
     "/register",
@@ -14,48 +20,129 @@ const std::unordered_map<std::string, int> HttpRequest::DEFAULT_HTML_TAG{
     {"/login.html", 1},
 };
 
+/*
+ * 在 [begin, end) 中查找 "\r\n", 返回指向 '\r' 的指针, 找不到返回 nullptr
+ * 一次比较 32/16 个字节, 只在命中 '\r' 的位置检查下一个字节
+ */
+static const char *findCRLF(const char *begin, const char *end) {
+    const char *p = begin;
+#if defined(__AVX2__)
+    const __m256i cr32 = _mm256_set1_epi8('\r');
+    for (; p + 32 <= end; p += 32) {
+        unsigned mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(p)), cr32));
+        for (; mask; mask &= mask - 1) {
+            const char *cr = p + __builtin_ctz(mask);
+            if (cr + 1 < end && cr[1] == '\n') {
+                return cr;
+            }
+        }
+    }
+#endif
+#if defined(__SSE2__)
+    const __m128i cr16 = _mm_set1_epi8('\r');
+    for (; p + 16 <= end; p += 16) {
+        unsigned mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p)), cr16));
+        for (; mask; mask &= mask - 1) {
+            const char *cr = p + __builtin_ctz(mask);
+            if (cr + 1 < end && cr[1] == '\n') {
+                return cr;
+            }
+        }
+    }
+#endif
+    for (; p + 1 < end; p++) {
+        if (p[0] == '\r' && p[1] == '\n') {
+            return p;
+        }
+    }
+    return nullptr;
+}
+
+static bool equalsNoCase(std::string_view a, std::string_view b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); i++) {
+        if (std::tolower(static_cast<unsigned char>(a[i])) != std::tolower(static_cast<unsigned char>(b[i]))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static std::string_view trim(std::string_view s) {
+    while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) {
+        s.remove_prefix(1);
+    }
+    while (!s.empty() && (s.back() == ' ' || s.back() == '\t')) {
+        s.remove_suffix(1);
+    }
+    return s;
+}
+
 void HttpRequest::init() {
-    method_ = path_ = version_ = body_ = "";
+    method_.clear();
+    path_.clear();
+    version_.clear();
+    body_.clear();
     state_ = REQUEST_LINE;
-    header_.clear();
+    parsed_ = 0;
+    contentLen_ = 0;
+    headerCnt_ = 0;
     post_.clear();
+    authTag_ = -1;
+    status_ = 200;
 }
 
-bool HttpRequest::parse(Buffer &buff) {
-    const char CRLF[] = "\r\n";
-    if (buff.readableBytes() <= 0) {
-        return false;
-    }
-    while (buff.readableBytes() && state_ != FINISH) {
-        const char *lineEnd = std::search(buff.peek(), buff.peek() + buff.readableBytes(), CRLF, CRLF + 2);  // 从缓存区中找到行结束位置
-        std::string line(buff.peek(), lineEnd);                                                              // 从buff中取出一行
+HttpRequest::HTTP_CODE HttpRequest::parse(Buffer &buff) {
+    const char *begin = buff.peek();
+    const char *end = begin + buff.readableBytes();
+    while (state_ != FINISH) {
+        const char *cur = begin + parsed_;
+        if (state_ == BODY) {
+            if (static_cast<size_t>(end - cur) < contentLen_) {
+                return NO_REQUEST;
+            }
+            body_.assign(cur, contentLen_);
+            parsed_ += contentLen_;
+            state_ = FINISH;
+            parsePost_();
+            LOG_DEBUG("Body:%s, len:%d", body_.c_str(), body_.size());
+            break;
+        }
+
+        const char *lineEnd = findCRLF(cur, end);
+        if (!lineEnd) {
+            return static_cast<size_t>(end - begin) > MAX_HEADER_SIZE ? BAD_REQUEST : NO_REQUEST;
+        }
+        std::string_view line(cur, lineEnd - cur);
+        parsed_ = lineEnd + 2 - begin;
 
         switch (state_) {
             case REQUEST_LINE:
                 if (!parseRequestLine_(line)) {
-                    return false;
+                    return BAD_REQUEST;
                 }
                 parsePath_();
                 break;
             case HEADERS:
-                parseHeader_(line);
-                if (buff.readableBytes() <= 2) {
-                    state_ = FINISH;
+                if (line.empty()) {  // 空行, 头部结束
+                    state_ = contentLen_ > 0 ? BODY : FINISH;
+                } else if (!parseHeader_(line)) {
+                    return BAD_REQUEST;
                 }
                 break;
-            case BODY:
-                parseBody_(line);
-                break;
             default:
                 break;
         }
-        if (lineEnd == buff.beginWrite()) {
-            break;
+        if (parsed_ > MAX_HEADER_SIZE && state_ != BODY && state_ != FINISH) {
+            return BAD_REQUEST;
         }
-        buff.retrieveUntil(lineEnd + 2);
     }
+    buff.retrieve(parsed_);
+    parsed_ = 0;
     LOG_DEBUG("[%s], [%s], [%s]", method_.c_str(), path_.c_str(), version_.c_str());
-    return true;
+    return GET_REQUSET;
 }
 
 std::string HttpRequest::path() const {
@@ -90,69 +177,100 @@ std::string HttpRequest::getPost(const std::string &key) const {
     return "";
 }
 
-bool HttpRequest::isKeepAlive() const {
-    if (header_.count("Connection") == 1) {
-        return header_.find("Connection")->second == "keep-alive" && version_ == "1.1";
+std::string_view HttpRequest::header(std::string_view key) const {
+    for (size_t i = 0; i < headerCnt_; i++) {
+        if (equalsNoCase(header_[i].first, key)) {
+            return header_[i].second;
+        }
     }
-    return false;
+    return {};
 }
 
-bool HttpRequest::parseRequestLine_(const std::string &line) {
-    std::regex patten("^([^ ]*) ([^ ]*) HTTP/([^ ]*)$");  // 匹配类似于 "GET /index.html HTTP/1.1"
-    std::smatch subMatch;                                 // 用于存放正则匹配结果
-    if (std::regex_match(line, subMatch, patten)) {
-        method_ = subMatch[1];
-        path_ = subMatch[2];
-        version_ = subMatch[3];
-        state_ = HEADERS;
-        return true;
-    }
-    return false;
+HttpRequest::PARSE_STATE HttpRequest::state() const {
+    return state_;
 }
 
-void HttpRequest::parseHeader_(const std::string &line) {
-    std::regex patten("^([^:]*): ?(.*)$");  // 匹配类似于 "key: value"
-    std::smatch subMatch;
-    if (std::regex_match(line, subMatch, patten)) {
-        header_[subMatch[1]] = subMatch[2];
-    } else {
-        state_ = BODY;
+bool HttpRequest::isKeepAlive() const {
+    // HTTP/1.1 默认长连接, HTTP/1.0 需要显式声明
+    if (version_ == "1.1") {
+        return !equalsNoCase(header("Connection"), "close");
     }
+    return equalsNoCase(header("Connection"), "keep-alive");
 }
 
-void HttpRequest::parseBody_(const std::string &line) {
-    body_ = line;
-    parsePost_();
-    state_ = FINISH;
-    LOG_DEBUG("Body:%s, len:%d", line.c_str(), line.size());
+bool HttpRequest::parseRequestLine_(std::string_view line) {
+    // 形如 "GET /index.html HTTP/1.1"
+    size_t sp1 = line.find(' ');
+    if (sp1 == std::string_view::npos || sp1 == 0) {
+        return false;
+    }
+    size_t sp2 = line.find(' ', sp1 + 1);
+    if (sp2 == std::string_view::npos || sp2 == sp1 + 1) {
+        return false;
+    }
+    std::string_view version = line.substr(sp2 + 1);
+    if (version.substr(0, 5) != "HTTP/" || version.size() == 5 || version.find(' ') != std::string_view::npos) {
+        return false;
+    }
+    method_.assign(line.data(), sp1);
+    path_.assign(line.data() + sp1 + 1, sp2 - sp1 - 1);
+    version_.assign(version.data() + 5, version.size() - 5);
+    state_ = HEADERS;
+    return true;
 }
 
-void HttpRequest::parsePath_() {
-    if (path_ == "/") {
-        path_ = "/index.html";
-    } else {
-        for (auto &item : DEFAULT_HTML) {
-            if (item == path_) {
-                path_ += ".html";
-                break;
+bool HttpRequest::parseHeader_(std::string_view line) {
+    // 形如 "key: value"
+    const char *colon = static_cast<const char *>(memchr(line.data(), ':', line.size()));
+    if (!colon || colon == line.data() || headerCnt_ >= MAX_HEADER_NUM) {
+        return false;
+    }
+    std::string_view key(line.data(), colon - line.data());
+    std::string_view value = trim(line.substr(key.size() + 1));
+    if (equalsNoCase(key, "Content-Length")) {
+        size_t len = 0;
+        for (char ch : value) {
+            if (ch < '0' || ch > '9' || len > MAX_BODY_SIZE) {
+                return false;
             }
+            len = len * 10 + (ch - '0');
+        }
+        if (value.empty() || len > MAX_BODY_SIZE) {
+            return false;
         }
+        contentLen_ = len;
+    }
+    if (headerCnt_ == header_.size()) {
+        header_.emplace_back();
+    }
+    header_[headerCnt_].first.assign(key.data(), key.size());
+    header_[headerCnt_].second.assign(value.data(), value.size());
+    headerCnt_++;
+    return true;
+}
+
+void HttpRequest::parsePath_() {
+    path_ = filePath(path_);
+}
+
+std::string HttpRequest::filePath(std::string_view path) {
+    std::string file(path);
+    if (file == "/") {
+        file = "/index.html";
+    } else if (DEFAULT_HTML.count(file)) {
+        file += ".html";
     }
+    return file;
 }
 
 void HttpRequest::parsePost_() {
-    if (method_ == "POST" && header_["Content-Type"] == "application/x-www-form-urlencoded") {
+    if (method_ == "POST" && header("Content-Type") == "application/x-www-form-urlencoded") {
         parseFromUrlencoded_();
         if (DEFAULT_HTML_TAG.count(path_)) {
             int tag = DEFAULT_HTML_TAG.find(path_)->second;
             LOG_DEBUG("TAG:%d", tag);
             if (tag == 0 || tag == 1) {
-                bool isLogin = (tag == 1);
-                if (userVerify(post_["username"], post_["password"], isLogin)) {
-                    path_ = "/welcome.html";
-                } else {
-                    path_ = "/error.html";
-                }
+                authTag_ = tag;  // 查库可能阻塞, 留给调用方
             }
         }
     }
@@ -199,67 +317,46 @@ void HttpRequest::parseFromUrlencoded_() {
     }
 }
 
-bool HttpRequest::userVerify(const std::string &name, const std::string &pwd, bool isLogin) {
-    if (name == "" || pwd == "") {
+bool HttpRequest::isBlockingRoute(std::string_view method, std::string_view path) {
+    if (method != "POST") {
         return false;
     }
-    LOG_INFO("Verify name: %s ,password: %s ", name.c_str(), pwd.c_str());
-
-    MYSQL *conn;
-    SqlConnRAII(&conn, SqlConnPool::instance());
-    assert(conn);
-
-    bool flag;
-    char sql[256] = {0};
-    MYSQL_RES *res = nullptr;
-
-    if (!isLogin) {
-        flag = true;
+    // 与 parsePath_ 一致, /login 这类默认页面补上 .html 再查
+    std::string html(path);
+    if (DEFAULT_HTML.count(html)) {
+        html += ".html";
     }
+    return DEFAULT_HTML_TAG.count(html) > 0;
+}
 
-    snprintf(sql, 256, "SELECT username, password FROM user WHERE username = '%s' LIMIT 1", name.c_str());
-    LOG_DEBUG("%s", sql);
-
-    if (mysql_query(conn, sql) && isLogin) {
-        mysql_free_result(res);
+bool HttpRequest::needsAuth(bool *isLogin) const {
+    if (authTag_ < 0) {
         return false;
     }
-    res = mysql_store_result(conn);
-
-    while (MYSQL_ROW row = mysql_fetch_row(res)) {
-        LOG_DEBUG("MYSQL ROW: %s %s", row[0], row[1]);
-        std::string password(row[1]);
-
-        if (isLogin) {
-            if (pwd == password) {
-                LOG_INFO("%s LOGIN SUCCESS", row[0]);
-                return true;
-            } else {
-                flag = false;
-                LOG_INFO("%s PASSWORD ERROR", row[0]);
-            }
-        } else {
-            flag = false;
-            LOG_INFO("%s USERNAME USED", row[0]);
-        }
-    }
-    mysql_free_result(res);
-
-    if (!isLogin && flag) {
-        LOG_DEBUG("register");
-        bzero(sql, 256);
-        snprintf(sql, 256, "INSERT INTO user(username,password) VALUEs('%s','%s')", name.c_str(), pwd.c_str());
-        LOG_DEBUG("%s", sql);
-        if (mysql_query(conn, sql)) {
-            LOG_DEBUG("INSERT ERROE");
-            flag = false;
-        }
-        flag = true;
-    }
-    LOG_DEBUG("verify success");
+    *isLogin = (authTag_ == 1);
     return true;
 }
 
+void HttpRequest::finishAuth(AUTH_RESULT result) {
+    if (result == AUTH_UNAVAILABLE) {
+        path_ = "/503.html";
+        status_ = 503;
+    } else {
+        path_ = result == AUTH_OK ? "/welcome.html" : "/error.html";
+    }
+    authTag_ = -1;
+}
+
+int HttpRequest::status() const {
+    return status_;
+}
+
+HttpRequest::AUTH_RESULT HttpRequest::userVerify(const std::string &name, const std::string &pwd, bool isLogin) {
+    AUTH_RESULT result = UserStore::instance()->verify(name, pwd, isLogin);
+    LOG_DEBUG("verify %s", result == AUTH_OK ? "success" : "fail");
+    return result;
+}
+
 int HttpRequest::converHex(char ch) {
     if (ch >= 'A' && ch <= 'F')
         return ch - 'A' + 10;
@@ -2,16 +2,16 @@
 #define HTTP_REQUEST_H
 
 #include <errno.h>
-#include <mysql/mysql.h>
 
-#include <regex>
+#include <cctype>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 #include "../buffer/buffer.h"
 #include "../log/log.h"
-#include "../sqlconnpool/sqlconnRAII.h"
 
 class HttpRequest {
 public:
@@ -35,7 +35,11 @@ public:
     ~HttpRequest() = default;
 
     void init();
-    bool parse(Buffer &buff);
+    /*
+     * 增量解析: 返回 NO_REQUEST 表示请求还不完整, 需要继续读
+     * 返回 GET_REQUSET 时完整的请求已从 buff 中取走
+     */
+    HTTP_CODE parse(Buffer &buff);
 
     std::string path() const;
     std::string &path();
@@ -43,24 +47,52 @@ public:
     std::string version() const;
     std::string getPost(const char *key) const;
     std::string getPost(const std::string &key) const;
+    std::string_view header(std::string_view key) const;  // 不区分大小写, 不存在时返回空
 
     bool isKeepAlive() const;
+    PARSE_STATE state() const;
+
+    /* 请求路径对应的资源文件路径, 如 "/" 对应 "/index.html" */
+    static std::string filePath(std::string_view path);
+    /* 处理时要查用户存储(登录、注册)的请求 */
+    static bool isBlockingRoute(std::string_view method, std::string_view path);
+
+    /*
+     * 登录、注册请求解析完后不在 parse 中校验, 由调用方决定在哪里执行 userVerify (经由 UserStore):
+     * needsAuth 为 true 时取 getPost("username")/getPost("password") 校验, 再用 finishAuth 交回结果
+     */
+    enum AUTH_RESULT {
+        AUTH_FAIL = 0,
+        AUTH_OK,
+        AUTH_UNAVAILABLE,  // 用户存储不可用(取连接超时、连接断开), 回 503
+    };
+    bool needsAuth(bool *isLogin) const;
+    void finishAuth(AUTH_RESULT result);
+    static AUTH_RESULT userVerify(const std::string &name, const std::string &pwd, bool isLogin);
+    int status() const;  // 处理结果要求的状态码, 默认 200
 
 private:
-    bool parseRequestLine_(const std::string &line);
-    void parseHeader_(const std::string &line);
-    void parseBody_(const std::string &line);
+    bool parseRequestLine_(std::string_view line);
+    bool parseHeader_(std::string_view line);
 
     void parsePath_();
     void parsePost_();
     void parseFromUrlencoded_();
 
-    static bool userVerify(const std::string &name, const std::string &pwd, bool isLogin);
+    static const size_t MAX_HEADER_SIZE = 8192;  // 请求行加头部的上限
+    static const size_t MAX_HEADER_NUM = 64;
+    static const size_t MAX_BODY_SIZE = 1 << 20;
 
     PARSE_STATE state_;
+    size_t parsed_;      // 已解析的字节数, 相对于 buff.peek()
+    size_t contentLen_;  // Content-Length
     std::string method_, path_, version_, body_;
-    std::unordered_map<std::string, std::string> header_;
+    /* 头部按顺序存放, init() 时只清零计数, 字符串的容量留给下一个请求复用 */
+    std::vector<std::pair<std::string, std::string>> header_;
+    size_t headerCnt_;
     std::unordered_map<std::string, std::string> post_;
+    int authTag_;  // 待校验的 DEFAULT_HTML_TAG, 没有为 -1
+    int status_;
 
     static const std::unordered_set<std::string> DEFAULT_HTML;
     static const std::unordered_map<std::string, int> DEFAULT_HTML_TAG;
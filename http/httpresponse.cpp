@@ -1,5 +1,7 @@
 #include "httpresponse.h"
 
+#include <random>
+
 const std::unordered_map<std::string, std::string> HttpResponse::SUFFIX_TYPE = {
     {".html", "text/html"},
     {".xml", "text/xml"},
@@ -15,6 +17,7 @@ const std::unordered_map<std::string, std::string> HttpResponse::SUFFIX_TYPE = {
     {".au", "audio/basic"},
     {".mpeg", "video/mpeg"},
     {".mpg", "video/mpeg"},
+    {".mp4", "video/mp4"},
     {".avi", "video/x-msvideo"},
     {".gz", "application/x-gzip"},
     {".tar", "application/x-tar"},
@@ -24,23 +27,48 @@ const std::unordered_map<std::string, std::string> HttpResponse::SUFFIX_TYPE = {
 
 const std::unordered_map<int, std::string> HttpResponse::CODE_STATUS = {
     {200, "OK"},
+    {206, "Partial Content"},
+    {304, "Not Modified"},
     {400, "Bad Request"},
     {403, "Forbidden"},
     {404, "Not Found"},
+    {416, "Range Not Satisfiable"},
+    {503, "Service Unavailable"},
 };
 
 const std::unordered_map<int, std::string> HttpResponse::CODE_PATH = {
     {400, "/400.html"},
     {403, "/403.html"},
     {403, "/404.html"},
+    {503, "/503.html"},
+};
+
+/* 页面每次都要验证, 静态资源可以直接用本地副本 */
+std::unordered_map<std::string, std::string> HttpResponse::CACHE_CONTROL = {
+    {".html", "no-cache"},
+    {".xhtml", "no-cache"},
+    {".css", "public, max-age=86400"},
+    {".js", "public, max-age=86400"},
+    {".png", "public, max-age=604800"},
+    {".gif", "public, max-age=604800"},
+    {".jpg", "public, max-age=604800"},
+    {".jpeg", "public, max-age=604800"},
+    {".ico", "public, max-age=604800"},
+    {".otf", "public, max-age=2592000"},
+    {".eot", "public, max-age=2592000"},
+    {".svg", "public, max-age=2592000"},
+    {".ttf", "public, max-age=2592000"},
+    {".woff", "public, max-age=2592000"},
+    {".woff2", "public, max-age=2592000"},
 };
 
 HttpResponse::HttpResponse() {
     code_ = -1;
     path_ = srcDir_ = "";
     isKeepAlive_ = false;
-    mmFile_ = nullptr;
-    mmFileStat_ = {0};
+    keepAliveTimeout_ = keepAliveMax_ = 0;
+    encoding_ = nullptr;
+    acceptGzip_ = acceptBr_ = false;
 }
 
 HttpResponse::~HttpResponse() {
@@ -49,24 +77,109 @@ HttpResponse::~HttpResponse() {
 
 void HttpResponse::init(const std::string &srcDir, std::string &path, bool isKeepAlive, int code) {
     assert(srcDir != "");
-    if (mmFile_) {
-        unmapFile();
-    }
+    unmapFile();
     code_ = code;
     isKeepAlive_ = isKeepAlive;
+    keepAliveTimeout_ = keepAliveMax_ = 0;
     path_ = path;
     srcDir_ = srcDir;
-    mmFile_ = nullptr;
-    mmFileStat_ = {0};
+    ifNoneMatch_.clear();
+    ifModifiedSince_.clear();
+    range_.clear();
+    ifRange_.clear();
+    ranges_.clear();
+    partHeaders_.clear();
+    raw_.reset();
+    encoding_ = nullptr;
+    acceptGzip_ = acceptBr_ = false;
+}
+
+void HttpResponse::setConditional(std::string_view ifNoneMatch, std::string_view ifModifiedSince) {
+    ifNoneMatch_.assign(ifNoneMatch.data(), ifNoneMatch.size());
+    ifModifiedSince_.assign(ifModifiedSince.data(), ifModifiedSince.size());
+}
+
+void HttpResponse::setKeepAlive(int timeout, int max) {
+    keepAliveTimeout_ = timeout;
+    keepAliveMax_ = max;
+}
+
+void HttpResponse::setRange(std::string_view range, std::string_view ifRange) {
+    range_.assign(range.data(), range.size());
+    ifRange_.assign(ifRange.data(), ifRange.size());
+}
+
+void HttpResponse::setAcceptEncoding(std::string_view acceptEncoding) {
+    parseAcceptEncoding(acceptEncoding, &acceptGzip_, &acceptBr_);
+}
+
+void HttpResponse::parseAcceptEncoding(std::string_view acceptEncoding, bool *gzip, bool *br) {
+    /* Accept-Encoding: gzip, deflate, br;q=0.9, *;q=0  只关心 gzip 和 br 是否可接受(q 不为 0) */
+    bool acceptGzip = false, acceptBr = false;
+    std::string_view list = acceptEncoding;
+    while (!list.empty()) {
+        size_t comma = list.find(',');
+        std::string_view item = list.substr(0, comma);
+        list = comma == std::string_view::npos ? std::string_view() : list.substr(comma + 1);
+
+        size_t semi = item.find(';');
+        std::string_view coding = item.substr(0, semi);
+        while (!coding.empty() && (coding.front() == ' ' || coding.front() == '\t')) {
+            coding.remove_prefix(1);
+        }
+        while (!coding.empty() && (coding.back() == ' ' || coding.back() == '\t')) {
+            coding.remove_suffix(1);
+        }
+        bool accept = true;
+        if (semi != std::string_view::npos) {
+            std::string_view params = item.substr(semi + 1);
+            size_t q = params.find("q=");
+            if (q != std::string_view::npos) {
+                // q=0、q=0.0、q=0.000 都表示拒绝
+                std::string_view val = params.substr(q + 2);
+                accept = false;
+                for (char ch : val) {
+                    if (ch >= '1' && ch <= '9') {
+                        accept = true;
+                        break;
+                    }
+                    if (ch != '0' && ch != '.') {
+                        break;
+                    }
+                }
+            }
+        }
+        auto is = [&coding](const char *name) {
+            size_t len = strlen(name);
+            return coding.size() == len && strncasecmp(coding.data(), name, len) == 0;
+        };
+        if (is("gzip") || is("x-gzip")) {
+            acceptGzip = accept;
+        } else if (is("br")) {
+            acceptBr = accept;
+        } else if (is("*")) {
+            acceptGzip = acceptBr = accept;
+        }
+    }
+    *gzip = acceptGzip;
+    *br = acceptBr;
 }
 
 void HttpResponse::makeResponse(Buffer &buff) {
-    if (stat((srcDir_ + path_).c_str(), &mmFileStat_) < 0 || S_ISDIR(mmFileStat_.st_mode)) {
+    file_ = FileCache::instance()->get(path_);
+    if (!file_) {
         code_ = 404;
-    } else if (!(mmFileStat_.st_mode & S_IROTH)) {
+    } else if (!(file_->st.st_mode & S_IROTH)) {
         code_ = 403;
-    } else if (code_ == -1) {
-        code_ = 200;
+    } else if (code_ == -1 || code_ == 200) {
+        raw_ = file_;
+        if (range_.empty()) {
+            negotiate_();  // 区间按原文件计算, 带 Range 的请求不压缩
+        }
+        code_ = notModified_() ? 304 : 200;
+        if (code_ == 200 && !range_.empty() && ifRangeMatch_()) {
+            code_ = parseRange_();
+        }
     }
     errorHtml_();
     addStatus_(buff);
@@ -75,18 +188,19 @@ void HttpResponse::makeResponse(Buffer &buff) {
 }
 
 void HttpResponse::unmapFile() {
-    if (mmFile_) {
-        munmap(mmFile_, mmFileStat_.st_size);
-        mmFile_ = nullptr;
-    }
+    file_.reset();
 }
 
 char *HttpResponse::file() {
-    return mmFile_;
+    return file_ ? file_->addr : nullptr;
 }
 
 size_t HttpResponse::fileLen() const {
-    return mmFileStat_.st_size;
+    return file_ && file_->addr ? file_->st.st_size : 0;
+}
+
+const std::shared_ptr<const OpenFile> &HttpResponse::fileHandle() const {
+    return file_;
 }
 
 void HttpResponse::errorContent(Buffer &buff, std::string message) {
@@ -111,6 +225,52 @@ int HttpResponse::code() const {
     return code_;
 }
 
+bool HttpResponse::hasFileBody() const {
+    return file_ && file_->fd >= 0 && file_->st.st_size > 0 && code_ != 304 && code_ != 416;
+}
+
+const std::vector<std::pair<off_t, size_t>> &HttpResponse::ranges() const {
+    return ranges_;
+}
+
+const std::string &HttpResponse::partHeader(size_t i) const {
+    static const std::string empty;
+    return i < partHeaders_.size() ? partHeaders_[i] : empty;
+}
+
+void HttpResponse::fileMeta(const std::string &path, OpenFile *file) {
+    file->type = fileType(path);
+    file->compressible = file->type.compare(0, 5, "text/") == 0 || file->type.find("xml") != std::string::npos ||
+                         file->type.find("javascript") != std::string::npos;
+    std::string::size_type idx = path.find_last_of('.');
+    if (idx != std::string::npos) {
+        auto it = CACHE_CONTROL.find(path.substr(idx));
+        if (it != CACHE_CONTROL.end()) {
+            file->cacheControl = it->second;
+        }
+    }
+}
+
+void HttpResponse::setCacheControl(const std::string &suffix, const std::string &value) {
+    if (value.empty()) {
+        CACHE_CONTROL.erase(suffix);
+    } else {
+        CACHE_CONTROL[suffix] = value;
+    }
+}
+
+std::string HttpResponse::fileType(const std::string &path) {
+    std::string::size_type idx = path.find_last_of('.');
+    if (idx == std::string::npos) {
+        return "text/plain";
+    }
+    std::string suffix = path.substr(idx);
+    if (SUFFIX_TYPE.count(suffix) == 1) {
+        return SUFFIX_TYPE.find(suffix)->second;
+    }
+    return "text/plain";
+}
+
 void HttpResponse::addStatus_(Buffer &buff) {
     std::string status;
     if (CODE_STATUS.count(code_) == 1) {
@@ -126,47 +286,261 @@ void HttpResponse::addHeader_(Buffer &buff) {
     buff.append("Connection: ");
     if (isKeepAlive_) {
         buff.append("keep-alive\r\n");
-        buff.append("keep-alive: max=6, timeout=120\r\n");
+        /* 只宣告服务端实际执行的限制 */
+        std::string hint;
+        if (keepAliveTimeout_ > 0) {
+            hint = "timeout=" + std::to_string(keepAliveTimeout_);
+        }
+        if (keepAliveMax_ > 0) {
+            hint += (hint.empty() ? "max=" : ", max=") + std::to_string(keepAliveMax_);
+        }
+        if (!hint.empty()) {
+            buff.append("Keep-Alive: " + hint + "\r\n");
+        }
     } else {
         buff.append("close\r\n");
     }
-    buff.append("Content-type: " + GetFileType_() + "\r\n");
+    /* Content-Type 和校验器在文件进缓存时已经算好 */
+    if (code_ == 416) {
+        buff.append("Content-type: text/html\r\n");
+        buff.append("Content-Range: bytes */" + std::to_string(file_->st.st_size) + "\r\n");
+    } else if (code_ == 206 && !partHeaders_.empty()) {
+        buff.append("Content-type: multipart/byteranges; boundary=" + boundary_ + "\r\n");
+    } else {
+        buff.append("Content-type: " + (raw_ ? raw_->type : file_ ? file_->type : fileType(path_)) + "\r\n");
+    }
+    if (encoding_ && code_ != 304) {
+        buff.append(std::string("Content-Encoding: ") + encoding_ + "\r\n");
+    }
+    if (raw_ && raw_->compressible && (code_ == 200 || code_ == 206 || code_ == 304)) {
+        buff.append("Vary: Accept-Encoding\r\n");
+    }
+    if (code_ == 206 && partHeaders_.empty()) {
+        off_t start = ranges_[0].first;
+        buff.append("Content-Range: bytes " + std::to_string(start) + "-" +
+                    std::to_string(start + ranges_[0].second - 1) + "/" + std::to_string(file_->st.st_size) + "\r\n");
+    }
+    if (file_ && (code_ == 200 || code_ == 206)) {
+        buff.append("Accept-Ranges: bytes\r\n");
+    }
+    if (file_ && (code_ == 200 || code_ == 206 || code_ == 304)) {
+        buff.append("ETag: " + file_->etag + "\r\n");
+        buff.append("Last-Modified: " + file_->lastModified + "\r\n");
+        if (!file_->cacheControl.empty()) {
+            buff.append("Cache-Control: " + file_->cacheControl + "\r\n");
+        }
+    }
 }
 
 void HttpResponse::addContent_(Buffer &buff) {
-    int srcFd = open((srcDir_ + path_).c_str(), O_RDONLY);
-    if (srcFd < 0) {
-        errorContent(buff, "File Not Found!");
+    if (code_ == 304) {
+        buff.append("\r\n");  // 304 没有消息体
         return;
     }
-
-    LOG_DEBUG("file path %s", (srcDir_ + path_).c_str());
-    int *mmRet = (int *)mmap(0, mmFileStat_.st_size, PROT_READ, MAP_PRIVATE, srcFd, 0);
-    if (mmRet == MAP_FAILED) {
+    if (code_ == 416) {
+        errorContent(buff, "Requested Range Not Satisfiable!");
+        return;
+    }
+    if (!file_ || file_->fd < 0) {
         errorContent(buff, "File Not Found!");
-        close(srcFd);
         return;
     }
-    mmFile_ = (char *)mmRet;
-    close(srcFd);
-    buff.append("Content-length: " + std::to_string(mmFileStat_.st_size) + "\r\n\r\n");
+    LOG_DEBUG("file path %s", path_.c_str());
+    size_t len = file_->st.st_size;
+    if (code_ == 206) {
+        len = 0;
+        for (const auto &r : ranges_) {
+            len += r.second;
+        }
+        for (const std::string &part : partHeaders_) {
+            len += part.size();
+        }
+    }
+    buff.append("Content-length: " + std::to_string(len) + "\r\n\r\n");
 }
 
 void HttpResponse::errorHtml_() {
     if (CODE_PATH.count(code_) == 1) {
         path_ = CODE_PATH.find(code_)->second;
-        stat((srcDir_ + path_).c_str(), &mmFileStat_);
+        file_ = FileCache::instance()->get(path_);
     }
 }
 
-std::string HttpResponse::GetFileType_() {
-    std::string::size_type idx = path_.find_last_of('.');
-    if (idx == std::string::npos) {
-        return "text/plain";
+bool HttpResponse::notModified_() const {
+    /* If-None-Match 优先, 存在时忽略 If-Modified-Since */
+    if (!ifNoneMatch_.empty()) {
+        return etagMatch_(ifNoneMatch_, file_->etag);
     }
-    std::string suffix = path_.substr(idx);
-    if (SUFFIX_TYPE.count(suffix) == 1) {
-        return SUFFIX_TYPE.find(suffix)->second;
+    if (ifModifiedSince_.empty()) {
+        return false;
     }
-    return "text/plain";
-}
\ No newline at end of file
+    struct tm tm = {};
+    const char *end = strptime(ifModifiedSince_.c_str(), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+    if (!end || *end != '\0') {
+        return false;  // 无法解析的日期按无条件请求处理
+    }
+    return file_->st.st_mtime <= timegm(&tm);
+}
+
+bool HttpResponse::etagMatch_(std::string_view list, const std::string &etag) {
+    /* 弱比较: 忽略 W/ 前缀, 列表以逗号分隔 */
+    size_t pos = 0;
+    while (pos < list.size()) {
+        size_t comma = list.find(',', pos);
+        if (comma == std::string_view::npos) {
+            comma = list.size();
+        }
+        std::string_view tag = list.substr(pos, comma - pos);
+        while (!tag.empty() && (tag.front() == ' ' || tag.front() == '\t')) {
+            tag.remove_prefix(1);
+        }
+        while (!tag.empty() && (tag.back() == ' ' || tag.back() == '\t')) {
+            tag.remove_suffix(1);
+        }
+        if (tag == "*") {
+            return true;
+        }
+        if (tag.size() > 2 && tag[0] == 'W' && tag[1] == '/') {
+            tag.remove_prefix(2);
+        }
+        if (tag == etag) {
+            return true;
+        }
+        pos = comma + 1;
+    }
+    return false;
+}
+
+bool HttpResponse::ifRangeMatch_() const {
+    /* If-Range 是实体标签时做强比较, 是日期时必须与 Last-Modified 完全一致; 不匹配则忽略 Range */
+    if (ifRange_.empty()) {
+        return true;
+    }
+    if (ifRange_[0] == '"' || ifRange_.compare(0, 2, "W/") == 0) {
+        return ifRange_ == file_->etag;
+    }
+    return ifRange_ == file_->lastModified;
+}
+
+int HttpResponse::parseRange_() {
+    /*
+     * Range: bytes=0-99, 200-, -50
+     * 语法错误或区间过多时忽略 Range 返回 200; 语法正确但没有一个区间落在文件内时返回 416
+     */
+    const off_t size = file_->st.st_size;
+    std::string_view spec(range_);
+    if (spec.compare(0, 6, "bytes=") != 0) {
+        return 200;
+    }
+    spec.remove_prefix(6);
+
+    auto parseNum = [](std::string_view str, off_t &num) {
+        if (str.empty() || str.size() > 18) {
+            return false;
+        }
+        num = 0;
+        for (char ch : str) {
+            if (ch < '0' || ch > '9') {
+                return false;
+            }
+            num = num * 10 + (ch - '0');
+        }
+        return true;
+    };
+
+    size_t cnt = 0;
+    while (!spec.empty()) {
+        size_t comma = spec.find(',');
+        std::string_view item = spec.substr(0, comma);
+        spec = comma == std::string_view::npos ? std::string_view() : spec.substr(comma + 1);
+        while (!item.empty() && (item.front() == ' ' || item.front() == '\t')) {
+            item.remove_prefix(1);
+        }
+        while (!item.empty() && (item.back() == ' ' || item.back() == '\t')) {
+            item.remove_suffix(1);
+        }
+        if (item.empty()) {
+            continue;  // 允许 "0-1, , 5-6" 这样的空元素
+        }
+        if (++cnt > MAX_RANGES) {
+            ranges_.clear();
+            return 200;
+        }
+        size_t dash = item.find('-');
+        if (dash == std::string_view::npos) {
+            ranges_.clear();
+            return 200;
+        }
+        off_t first, last;
+        if (dash == 0) {
+            /* 后缀区间: 最后 n 个字节 */
+            if (!parseNum(item.substr(1), last)) {
+                ranges_.clear();
+                return 200;
+            }
+            if (last > 0 && size > 0) {
+                off_t len = std::min(last, size);
+                ranges_.emplace_back(size - len, len);
+            }
+            continue;
+        }
+        if (!parseNum(item.substr(0, dash), first)) {
+            ranges_.clear();
+            return 200;
+        }
+        if (dash + 1 == item.size()) {
+            last = size - 1;
+        } else if (!parseNum(item.substr(dash + 1), last) || last < first) {
+            ranges_.clear();
+            return 200;
+        }
+        if (first < size) {
+            last = std::min(last, size - 1);
+            ranges_.emplace_back(first, last - first + 1);
+        }
+    }
+    if (cnt == 0) {
+        return 200;
+    }
+    if (ranges_.empty()) {
+        return 416;
+    }
+    if (ranges_.size() > 1) {
+        makeParts_();
+    }
+    return 206;
+}
+
+void HttpResponse::makeParts_() {
+    thread_local std::mt19937_64 rng(std::random_device{}());
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%016llx", (unsigned long long)rng());
+    boundary_ = buf;
+
+    const std::string total = std::to_string(file_->st.st_size);
+    for (const auto &r : ranges_) {
+        partHeaders_.push_back("\r\n--" + boundary_ + "\r\nContent-type: " + file_->type + "\r\nContent-Range: bytes " +
+                               std::to_string(r.first) + "-" + std::to_string(r.first + r.second - 1) + "/" + total +
+                               "\r\n\r\n");
+    }
+    partHeaders_.push_back("\r\n--" + boundary_ + "--\r\n");
+}
+
+void HttpResponse::negotiate_() {
+    if (!file_->compressible || file_->fd < 0) {
+        return;
+    }
+    /* br 只用预压缩文件, gzip 没有预压缩文件时在线压缩一次 */
+    std::shared_ptr<const OpenFile> encoded;
+    if (acceptBr_) {
+        encoded = FileCache::instance()->getEncoded(path_, FileCache::BR);
+        encoding_ = encoded ? "br" : nullptr;
+    }
+    if (!encoded && acceptGzip_) {
+        encoded = FileCache::instance()->getEncoded(path_, FileCache::GZIP);
+        encoding_ = encoded ? "gzip" : nullptr;
+    }
+    if (encoded) {
+        file_ = encoded;
+    }
+}
@@ -4,13 +4,21 @@
 #include <fcntl.h>
 #include <sys/mman.h>
 #include <sys/stat.h>  //stat
+#include <time.h>      // strptime timegm
 #include <unistd.h>
 
+#include <strings.h>  // strncasecmp
+
 #include <cassert>
+#include <memory>
 #include <string>
+#include <string_view>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include "../buffer/buffer.h"
+#include "../filecache/filecache.h"
 #include "../log/log.h"
 
 class HttpResponse {
@@ -19,34 +27,78 @@ public:
     ~HttpResponse();
 
     void init(const std::string &srcDir, std::string &path, bool isKeepAlive = false, int code = -1);
+    /* 条件请求头, 在 init() 之后、makeResponse() 之前设置, 只对 GET 有效 */
+    void setConditional(std::string_view ifNoneMatch, std::string_view ifModifiedSince);
+    void setRange(std::string_view range, std::string_view ifRange);
+    void setAcceptEncoding(std::string_view acceptEncoding);
+    /* 解析 Accept-Encoding 的值, 只关心 gzip 和 br 是否可接受 */
+    static void parseAcceptEncoding(std::string_view acceptEncoding, bool *gzip, bool *br);
+    /* Keep-Alive 响应头: 空闲超时(秒)和剩余可用的请求数, <= 0 的不宣告 */
+    void setKeepAlive(int timeout, int max);
     void makeResponse(Buffer &buff);
     void unmapFile();
     char *file();
     size_t fileLen() const;
+    /* 文件缓存条目的引用, 批量写出时由 HttpConn 持有, 保证映射在写完前有效 */
+    const std::shared_ptr<const OpenFile> &fileHandle() const;
     void errorContent(Buffer &buff, std::string message);
     int code() const;
 
+    /* 消息体是否来自文件(304、416 等没有或只有错误页内容) */
+    bool hasFileBody() const;
+    /* 206 时要发送的区间 (起点, 长度), 为空表示整个文件 */
+    const std::vector<std::pair<off_t, size_t>> &ranges() const;
+    /* multipart/byteranges 时第 i 段之前的分隔行和段头, i == ranges().size() 为结束分隔行; 单段时为空 */
+    const std::string &partHeader(size_t i) const;
+
+    static std::string fileType(const std::string &path);  // 按后缀取 Content-Type
+    static void fileMeta(const std::string &path, OpenFile *file);  // 供 FileCache 加载时调用
+    /* 按后缀配置 Cache-Control, value 为空表示不发; 需在服务启动前调用 */
+    static void setCacheControl(const std::string &suffix, const std::string &value);
+
 private:
     void addStatus_(Buffer &buff);
     void addHeader_(Buffer &buff);
     void addContent_(Buffer &buff);
 
     void errorHtml_();
-    std::string GetFileType_();
+    void negotiate_();
+    bool notModified_() const;
+    bool ifRangeMatch_() const;
+    int parseRange_();
+    void makeParts_();
+    static bool etagMatch_(std::string_view list, const std::string &etag);
 
 private:
     int code_;
     bool isKeepAlive_;
+    int keepAliveTimeout_;
+    int keepAliveMax_;
 
     std::string path_;
     std::string srcDir_;
 
-    char *mmFile_;
-    struct stat mmFileStat_;
+    std::shared_ptr<const OpenFile> file_;
+    std::shared_ptr<const OpenFile> raw_;  // 协商前的原文件, Content-Type 以它为准
+    const char *encoding_;                 // 选中的 Content-Encoding, 不压缩时为 nullptr
+    bool acceptGzip_;
+    bool acceptBr_;
+
+    std::string ifNoneMatch_;
+    std::string ifModifiedSince_;
+    std::string range_;
+    std::string ifRange_;
+
+    std::vector<std::pair<off_t, size_t>> ranges_;
+    std::vector<std::string> partHeaders_;
+    std::string boundary_;
+
+    static const size_t MAX_RANGES = 16;  // 超过则忽略 Range, 整个文件返回
 
     static const std::unordered_map<std::string, std::string> SUFFIX_TYPE;
     static const std::unordered_map<int, std::string> CODE_STATUS;
     static const std::unordered_map<int, std::string> CODE_PATH;
+    static std::unordered_map<std::string, std::string> CACHE_CONTROL;
 };
 
 #endif  // HTTPRESPONSE_H
\ No newline at end of file
@@ -0,0 +1,176 @@
+#include "routestats.h"
+
+#include <strings.h>
+
+#include <chrono>
+#include <cstring>
+
+#include "../filecache/filecache.h"
+#include "../log/log.h"
+#include "httprequest.h"
+#include "httpresponse.h"
+
+RouteStats *RouteStats::instance() {
+    static RouteStats inst;
+    return &inst;
+}
+
+bool RouteStats::routeKey(const char *data, size_t len, std::string *key) {
+    // 形如 "GET /index.html?a=1 HTTP/1.1", 取 "GET /index.html"
+    size_t n = len < MAX_KEY_LEN ? len : MAX_KEY_LEN;
+    const char *sp1 = static_cast<const char *>(memchr(data, ' ', n));
+    if (!sp1) {
+        return false;
+    }
+    const char *end = data + n;
+    const char *p = sp1 + 1;
+    while (p < end && *p != ' ' && *p != '?' && *p != '\r') {
+        p++;
+    }
+    if (p == end) {
+        return false;  // 过长的路径也按没收全处理, 用默认策略
+    }
+    key->assign(data, p - data);
+    return true;
+}
+
+bool RouteStats::shouldOffload(const std::string &key) {
+    // 本线程的视图, 只有本线程访问; 共享表是唯一的, 单例里放 thread_local 即可
+    thread_local std::unordered_map<std::string, LocalRoute> local;
+    auto it = local.find(key);
+    if (it != local.end() && it->second.uses++ < REFRESH_EVERY) {
+        return it->second.offload;
+    }
+    std::shared_ptr<Route> route = find_(key, false);
+    bool offload = route ? route->offload.load(std::memory_order_relaxed) : defaultOffload_(key);
+    if (it == local.end()) {
+        if (local.size() >= MAX_ROUTES) {
+            local.clear();  // 与共享表同一上限, 满了整个丢掉重新攒
+        }
+        it = local.emplace(key, LocalRoute()).first;
+    }
+    it->second.offload = offload;
+    it->second.uses = 0;
+    return offload;
+}
+
+RouteStats::LANE RouteStats::lane(const std::string &key, std::string_view request, bool *cold) {
+    if (cold) {
+        *cold = false;
+    }
+    size_t sp = key.find(' ');
+    if (sp == std::string::npos) {
+        return shouldOffload(key) ? LANE_CPU : LANE_INLINE;
+    }
+    std::string_view view(key);
+    std::string_view method = view.substr(0, sp);
+    if (HttpRequest::isBlockingRoute(method, view.substr(sp + 1))) {
+        return LANE_IO;
+    }
+    if ((method == "GET" || method == "HEAD") && !fileCached_(view.substr(sp + 1), request)) {
+        if (cold) {
+            *cold = true;
+        }
+        return LANE_CPU;
+    }
+    return shouldOffload(key) ? LANE_CPU : LANE_INLINE;
+}
+
+bool RouteStats::fileCached_(std::string_view path, std::string_view request) {
+    size_t end = request.find("\r\n\r\n");
+    if (end == std::string_view::npos) {
+        return true;  // 请求头没收全, 这次只是缓存数据
+    }
+    // 逐行找 Accept-Encoding, 决定要看哪些压缩版本
+    std::string_view head = request.substr(0, end + 2);
+    std::string_view acceptEncoding;
+    const char name[] = "accept-encoding:";
+    const size_t nameLen = sizeof(name) - 1;
+    for (size_t pos = head.find("\r\n"); pos != std::string_view::npos && pos + 2 < head.size();) {
+        size_t lineStart = pos + 2;
+        size_t lineEnd = head.find("\r\n", lineStart);
+        std::string_view line = head.substr(lineStart, lineEnd - lineStart);
+        if (line.size() >= nameLen && strncasecmp(line.data(), name, nameLen) == 0) {
+            acceptEncoding = line.substr(nameLen);
+            break;
+        }
+        pos = lineEnd;
+    }
+    bool gzip = false, br = false;
+    HttpResponse::parseAcceptEncoding(acceptEncoding, &gzip, &br);
+    return FileCache::instance()->cached(HttpRequest::filePath(path), gzip, br);
+}
+
+const char *RouteStats::laneName(LANE lane) {
+    switch (lane) {
+        case LANE_INLINE:
+            return "inline";
+        case LANE_CPU:
+            return "cpu";
+        case LANE_IO:
+            return "io";
+        default:
+            return "unknown";
+    }
+}
+
+bool RouteStats::sample() {
+    thread_local uint32_t cnt = 0;
+    return cnt++ % SAMPLE_EVERY == 0;
+}
+
+void RouteStats::record(const std::string &key, uint64_t ns) {
+    std::shared_ptr<Route> route = find_(key, true);
+    if (!route) {
+        return;
+    }
+    route->lastMs.store(nowMs_(), std::memory_order_relaxed);
+    /* 多个线程同时更新时可能丢一个样本, 对平均值影响不大, 不加锁 */
+    uint64_t cnt = route->count.fetch_add(1, std::memory_order_relaxed);
+    uint64_t avg = route->avgNs.load(std::memory_order_relaxed);
+    avg = cnt == 0 ? ns : avg - (avg >> EWMA_SHIFT) + (ns >> EWMA_SHIFT);
+    route->avgNs.store(avg, std::memory_order_relaxed);
+
+    bool offload = route->offload.load(std::memory_order_relaxed);
+    if (!offload && avg > OFFLOAD_NS) {
+        route->offload.store(true, std::memory_order_relaxed);
+        LOG_INFO("Route [%s] avg %lluus, offload to thread pool", key.c_str(), (unsigned long long)(avg / 1000));
+    } else if (offload && avg < INLINE_NS) {
+        route->offload.store(false, std::memory_order_relaxed);
+        LOG_INFO("Route [%s] avg %lluus, handle inline", key.c_str(), (unsigned long long)(avg / 1000));
+    }
+}
+
+std::shared_ptr<RouteStats::Route> RouteStats::find_(const std::string &key, bool create) {
+    Shard &shard = shards_[std::hash<std::string>()(key) % SHARD_NUM];
+    std::lock_guard<std::mutex> locker(shard.mtx);
+    auto it = shard.routes.find(key);
+    if (it != shard.routes.end()) {
+        return it->second;
+    }
+    if (!create) {
+        return nullptr;
+    }
+    if (shard.routes.size() >= MAX_ROUTES / SHARD_NUM) {
+        // 分片满时淘汰最久没有请求的路由, 分片不大, 直接扫一遍
+        auto oldest = shard.routes.begin();
+        for (auto i = shard.routes.begin(); i != shard.routes.end(); ++i) {
+            if (i->second->lastMs.load(std::memory_order_relaxed) < oldest->second->lastMs.load(std::memory_order_relaxed)) {
+                oldest = i;
+            }
+        }
+        shard.routes.erase(oldest);
+    }
+    std::shared_ptr<Route> route = std::make_shared<Route>();
+    route->offload.store(defaultOffload_(key), std::memory_order_relaxed);
+    shard.routes.emplace(key, route);
+    return route;
+}
+
+bool RouteStats::defaultOffload_(const std::string &key) {
+    return key.compare(0, 4, "GET ") != 0 && key.compare(0, 5, "HEAD ") != 0;
+}
+
+uint64_t RouteStats::nowMs_() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
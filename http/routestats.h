@@ -0,0 +1,86 @@
+#ifndef ROUTE_STATS_H
+#define ROUTE_STATS_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+/*
+ * 决定请求在 Reactor 线程上处理还是交给线程池:
+ *   - 会阻塞在数据库上的路由(见 HttpRequest::isBlockingRoute)固定走 IO 通道,
+ *     与静态文件等 CPU 型请求分开排队, 登录请求堆积时不拖慢静态请求
+ *   - GET/HEAD 先看 FileCache: 文件(及客户端可接受的压缩版本)不在缓存中时要打开、映射甚至在线压缩, 交给 CPU 通道;
+ *     缓存命中(含 304)和已知不存在的路径(404)才可能在本线程处理
+ *   - 再按路由("方法 路径", 不含查询串)统计的处理耗时: 取指数移动平均, 超过 OFFLOAD_NS 的交给 CPU 通道,
+ *     回落到 INLINE_NS 以下再回到本线程; 没有统计过的路由 GET/HEAD 在本线程, 其他方法交给 CPU 通道
+ * 统计表每个分片有上限, 满了淘汰最久没有请求的路由, 扫描式的大量 404 路径不会把表永久占满
+ * 每个请求都要查的开销压到最低: 各线程缓存自己读到的判定, 每个路由每 REFRESH_EVERY 次才回共享表取一次(不加锁);
+ * 耗时只在每 SAMPLE_EVERY 个请求中抽一个计时、写共享表, 判定的变化因此会晚几十个请求才生效
+ */
+class RouteStats {
+public:
+    /* 请求的执行通道, 按代价从低到高排列 */
+    enum LANE : uint8_t {
+        LANE_INLINE,  // Reactor 线程上直接处理
+        LANE_CPU,     // CPU 通道线程池
+        LANE_IO,      // 阻塞 IO 通道线程池
+        LANE_NUM,
+    };
+
+    static RouteStats *instance();
+
+    /* 从缓冲区开头的请求行取出路由键, 请求行还没收全时返回 false */
+    static bool routeKey(const char *data, size_t len, std::string *key);
+
+    bool shouldOffload(const std::string &key);
+    /*
+     * request 为从请求行开始的缓冲区, 用来看请求头; 请求头还没收全时解析不会有开销, 返回 LANE_INLINE
+     * cold 返回是否因为文件不在缓存中而交给 CPU 通道, 这样的请求耗时不代表路由平时的代价, 不应 record
+     */
+    LANE lane(const std::string &key, std::string_view request, bool *cold = nullptr);
+    static const char *laneName(LANE lane);
+    /* 这次处理是否计时并 record, 每个线程按请求计数抽样 */
+    static bool sample();
+    void record(const std::string &key, uint64_t ns);
+
+private:
+    RouteStats() = default;
+    ~RouteStats() = default;
+
+    struct Route {
+        std::atomic<uint64_t> count{0};
+        std::atomic<uint64_t> avgNs{0};
+        std::atomic<bool> offload{false};
+        std::atomic<uint64_t> lastMs{0};  // 最近一次记录的时间, 淘汰用
+    };
+    struct LocalRoute {
+        bool offload = false;
+        uint32_t uses = 0;  // 上次从共享表刷新以来的查询次数
+    };
+    struct Shard {
+        std::mutex mtx;
+        std::unordered_map<std::string, std::shared_ptr<Route>> routes;  // 淘汰时可能正被其他线程使用
+    };
+
+    std::shared_ptr<Route> find_(const std::string &key, bool create);
+    static bool defaultOffload_(const std::string &key);
+    static bool fileCached_(std::string_view path, std::string_view request);
+    static uint64_t nowMs_();
+
+    static const int SHARD_NUM = 8;
+    static const size_t MAX_ROUTES = 1024;  // 所有分片合计
+    static const size_t MAX_KEY_LEN = 256;
+    static const uint64_t OFFLOAD_NS = 200 * 1000;
+    static const uint64_t INLINE_NS = 50 * 1000;
+    static const int EWMA_SHIFT = 3;  // 新样本权重 1/8
+    static const uint32_t REFRESH_EVERY = 64;
+    static const uint32_t SAMPLE_EVERY = 8;
+
+    Shard shards_[SHARD_NUM];
+};
+
+#endif  // ROUTE_STATS_H
@@ -74,6 +74,13 @@ Log *Log::instance() {
     return &inst;
 }
 
+bool Log::setWriteThreadAffinity(const std::vector<int> &cpus) {
+    if (!writeThread_) {
+        return false;
+    }
+    return CpuAffinity::pinThread(writeThread_->native_handle(), cpus);
+}
+
 void Log::flushLogThread() {
     Log::instance()->asyncWrite();
 }
@@ -113,6 +120,7 @@ void Log::write(int level, const char *format, ...) {
     {  // 开始写入日志
         std::unique_lock<std::mutex> locker(mtx_);
         lineCount_++;
+        buff_.ensureWriteable(128);  // 缓冲区按需分配, 写入前先保证空间
         int n = snprintf(buff_.beginWrite(), 128, "%04d-%02d-%02d %02d:%02d:%02d.%06ld",
                          t.tm_year + 1900, t.tm_mon + 1, t.tm_mday, t.tm_hour, t.tm_min, t.tm_sec, now.tv_usec);  // 先写入时间
         buff_.hasWritten(n);
@@ -8,7 +8,9 @@
 #include <cstdarg>
 #include <mutex>
 #include <thread>
+#include <vector>
 
+#include "../affinity/cpuaffinity.h"
 #include "../buffer/buffer.h"
 #include "blockqueue.h"
 
@@ -23,6 +25,7 @@ public:
     int getLevel();
     void setLevel(int level);
     bool isClose();
+    bool setWriteThreadAffinity(const std::vector<int> &cpus);  // 绑定异步写线程, 同步写时无效
 
 private:
     Log();
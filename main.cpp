@@ -4,9 +4,18 @@ int main() {
     /* 守护进程 后台运行 */
     // daemon(1, 0);
 
+    /* 按后缀覆盖默认的 Cache-Control, 需在 WebServer 构造前设置 */
+    HttpResponse::setCacheControl(".mp4", "public, max-age=604800");
+
+    /* 连接时限(毫秒, <=0 不限): 收齐请求头 keep-alive空闲 发送停滞 最低发送速率(字节/秒) 每连接最多请求数 */
+    ConnLimits limits = {10000, 60000, 10000, 1024, 100};
+
     WebServer server(
-        1316, 3, 60000, false,                        /* 端口 ET模式 timeoutMs 优雅退出  */
+        1316, 3, limits, false,                       /* 端口 ET模式 连接时限 优雅退出  */
         "host", 3306, "dbuser", "dbpasswd", "dbname", /* Mysql配置 */
-        12, 6, true, 0, 1024);                        /* 连接池数量 线程池数量 日志开关 日志等级 日志异步队列容量 */
+        12, 6, 12, 1, true, 256 << 10,                /* 连接池上限(常驻其四分之一, 按需伸缩) CPU通道线程数 IO通道线程数(用户存储会阻塞时用且必须 >0, 如 SQLite 或不支持非阻塞的 MySQL 客户端库, 不超过连接池数量即可) Reactor数量(>1时每个Reactor独占一个线程, 没有CPU通道) 优先io_uring sendfile阈值(字节, 0为不用) */
+        true, 0, 1024,                                /* 日志开关 日志等级 日志异步队列容量 */
+        nullptr,                                      /* 线程绑核配置文件, 如 "./topology.example.conf", nullptr 为不绑定 */
+        "mysql");                                     /* 用户存储: "mysql" 用上面的配置, "memory[:用户文件]" 进程内(压测用), "sqlite:数据库文件"; mysql/sqlite 需编译进来(make MYSQL=1 SQLITE=1, 默认) */
     server.start();
 }
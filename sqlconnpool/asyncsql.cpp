@@ -0,0 +1,129 @@
+#include "asyncsql.h"
+
+#include <cstring>
+
+AsyncSql::AsyncSql(Reactor *reactor, SqlConnPool *pool) : reactor_(reactor), pool_(pool) {
+    assert(reactor_ && pool_);
+}
+
+bool AsyncSql::isNonBlocking() {
+#ifdef MYSQL_WAIT_READ
+    return true;
+#else
+    return false;
+#endif
+}
+
+Task<MYSQL *> AsyncSql::acquire() {
+    co_return co_await AcquireAwaiter{this, nullptr, nullptr};
+}
+
+bool AsyncSql::AcquireAwaiter::await_suspend(std::coroutine_handle<> h) {
+    handle = h;
+    // 只捕获 this, std::function 不用分配; 归还方可能在其他线程, 先存好连接再 post 回本线程
+    return !sql->pool_->getConnOrWait(&conn, [this](MYSQL *c) {
+        conn = c;
+        sql->reactor_->post(handle);
+    });
+}
+
+void AsyncSql::release(MYSQL *conn, bool broken) {
+    if (!conn) {
+        return;
+    }
+#ifdef MYSQL_WAIT_READ
+    // 连接下次可能被别的 Reactor 取走, 撤掉在本 Poller 上的注册
+    reactor_->forgetFd(mysql_get_socket(conn));
+#endif
+    pool_->freeConn(conn, broken);
+}
+
+#ifdef MYSQL_WAIT_READ
+/* 把客户端库要等待的 MYSQL_WAIT_* 换成 Poller 事件 */
+Reactor::FdAwaiter AsyncSql::waitFor_(MYSQL *conn, int status) {
+    uint32_t events = 0;
+    if (status & MYSQL_WAIT_READ) {
+        events |= EPOLLIN;
+    }
+    if (status & MYSQL_WAIT_WRITE) {
+        events |= EPOLLOUT;
+    }
+    if (status & MYSQL_WAIT_EXCEPT) {
+        events |= EPOLLPRI;
+    }
+    int timeout = (status & MYSQL_WAIT_TIMEOUT) ? static_cast<int>(mysql_get_timeout_value_ms(conn)) : -1;
+    return reactor_->waitFd(mysql_get_socket(conn), events, timeout);
+}
+
+/* 再把发生的事件换回 MYSQL_WAIT_*, 传给 _cont; 出错挂断也当作可读写, 由客户端库读出错误 */
+int AsyncSql::readyStatus_(uint32_t revents, int status) {
+    if (revents == 0) {
+        return MYSQL_WAIT_TIMEOUT;
+    }
+    int ready = 0;
+    if (revents & (EPOLLIN | EPOLLERR | EPOLLHUP)) {
+        ready |= MYSQL_WAIT_READ;
+    }
+    if (revents & (EPOLLOUT | EPOLLERR | EPOLLHUP)) {
+        ready |= MYSQL_WAIT_WRITE;
+    }
+    if (revents & EPOLLPRI) {
+        ready |= MYSQL_WAIT_EXCEPT;
+    }
+    return ready & status;
+}
+#endif
+
+Task<MYSQL_STMT *> AsyncSql::prepare(MYSQL *conn, SqlConnPool::STMT id) {
+    MYSQL_STMT *stmt = pool_->cachedStmt(conn, id);
+    if (stmt) {
+        co_return stmt;
+    }
+#ifdef MYSQL_WAIT_READ
+    stmt = mysql_stmt_init(conn);
+    if (!stmt) {
+        LOG_ERROR("MySql stmt init error: %s", mysql_error(conn));
+        co_return nullptr;
+    }
+    const char *sql = SqlConnPool::stmtSql(id);
+    int err = 0;
+    int status = mysql_stmt_prepare_start(&err, stmt, sql, strlen(sql));
+    while (status) {
+        uint32_t revents = co_await waitFor_(conn, status);
+        status = mysql_stmt_prepare_cont(&err, stmt, readyStatus_(revents, status));
+    }
+    if (err) {
+        LOG_ERROR("MySql prepare error: %s", mysql_stmt_error(stmt));
+        mysql_stmt_close(stmt);
+        co_return nullptr;
+    }
+    pool_->cacheStmt(conn, id, stmt);
+#else
+    LOG_ERROR("MySql client has no non-blocking API, prepare %d rejected", id);
+#endif
+    co_return stmt;
+}
+
+Task<bool> AsyncSql::execute(MYSQL *conn, MYSQL_STMT *stmt) {
+    int err = 0;
+#ifdef MYSQL_WAIT_READ
+    int status = mysql_stmt_execute_start(&err, stmt);
+    while (status) {
+        uint32_t revents = co_await waitFor_(conn, status);
+        status = mysql_stmt_execute_cont(&err, stmt, readyStatus_(revents, status));
+    }
+    if (!err && mysql_stmt_field_count(stmt) > 0) {
+        status = mysql_stmt_store_result_start(&err, stmt);
+        while (status) {
+            uint32_t revents = co_await waitFor_(conn, status);
+            status = mysql_stmt_store_result_cont(&err, stmt, readyStatus_(revents, status));
+        }
+    }
+#else
+    (void)conn;
+    (void)stmt;
+    LOG_ERROR("MySql client has no non-blocking API, execute rejected");
+    err = 1;
+#endif
+    co_return err == 0;
+}
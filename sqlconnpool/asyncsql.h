@@ -0,0 +1,54 @@
+#ifndef ASYNC_SQL_H
+#define ASYNC_SQL_H
+
+#include <mysql/mysql.h>
+
+#include <string>
+
+#include "../coroutine/task.h"
+#include "../webserver/reactor.h"
+#include "sqlconnpool.h"
+
+/*
+ * 在 Reactor 线程上用协程访问数据库
+ * 客户端库是 MariaDB Connector/C 时使用其非阻塞接口(mysql_*_start/_cont): MySQL 连接的 socket 注册到
+ * Reactor 的 Poller, 等结果期间协程挂起, 不占任何线程, 超时取自 mysql_get_timeout_value_ms
+ * 没有非阻塞接口的客户端库(如 Oracle libmysqlclient)上 isNonBlocking() 为 false, 不应使用本类:
+ * MysqlUserStore 此时把整个 find/add 交给 IO 通道, prepare/execute 在这种构建下直接按失败返回
+ * 取连接也不阻塞: 连接池空时协程挂起, 有连接归还时由归还方 post 回来
+ */
+class AsyncSql {
+public:
+    AsyncSql(Reactor *reactor, SqlConnPool *pool);
+
+    static bool isNonBlocking();
+
+    Task<MYSQL *> acquire();  // 等待超时或连接池已关闭时为 nullptr, 调用方检查
+    void release(MYSQL *conn, bool broken = false);
+
+    /* 取连接上缓存的预编译语句, 没有就 prepare 并存回连接池, 失败返回 nullptr */
+    Task<MYSQL_STMT *> prepare(MYSQL *conn, SqlConnPool::STMT id);
+    /* 执行已绑定参数的语句, 有结果集时一并取回(之后 mysql_stmt_fetch 不再有网络往返), 成功返回 true */
+    Task<bool> execute(MYSQL *conn, MYSQL_STMT *stmt);
+
+private:
+    struct AcquireAwaiter {
+        AsyncSql *sql;
+        MYSQL *conn;
+        std::coroutine_handle<> handle;
+
+        bool await_ready() const noexcept { return false; }
+        bool await_suspend(std::coroutine_handle<> h);
+        MYSQL *await_resume() const noexcept { return conn; }
+    };
+
+#ifdef MYSQL_WAIT_READ
+    Reactor::FdAwaiter waitFor_(MYSQL *conn, int status);
+    static int readyStatus_(uint32_t revents, int status);
+#endif
+
+    Reactor *reactor_;
+    SqlConnPool *pool_;
+};
+
+#endif  // ASYNC_SQL_H
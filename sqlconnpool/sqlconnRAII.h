@@ -3,24 +3,29 @@
 
 #include "sqlconnpool.h"
 
+/* 取不到连接(等待超时)时 *conn 为 nullptr, 调用方检查 */
 class SqlConnRAII {
 public:
-    SqlConnRAII(MYSQL **conn, SqlConnPool *connPool) {
+    SqlConnRAII(MYSQL **conn, SqlConnPool *connPool, int timeoutMs = -1) {
         assert(connPool);
-        *conn = connPool->getConn();
+        *conn = connPool->getConn(timeoutMs);
         conn_ = *conn;
         connPool_ = connPool;
+        broken_ = false;
     }
 
     ~SqlConnRAII() {
         if (conn_) {
-            connPool_->freeConn(conn_);
+            connPool_->freeConn(conn_, broken_);
         }
     }
 
+    void markBroken() { broken_ = true; }  // 连接已断, 归还时由连接池关掉重建
+
 private:
     MYSQL *conn_;
     SqlConnPool *connPool_;
+    bool broken_;
 };
 
-#endif  // SQLCONNRAII_H
\ No newline at end of file
+#endif  // SQLCONNRAII_H
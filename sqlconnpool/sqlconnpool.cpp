@@ -1,5 +1,14 @@
 #include "sqlconnpool.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <vector>
+
+SqlConnPool::SqlConnPool()
+    : port_(0), minConn_(0), maxConn_(0), waitTimeoutMs_(0), total_(0), retryAtMs_(0), closed_(true) {
+}
+
 SqlConnPool::~SqlConnPool() {
     close();
 }
@@ -9,57 +18,375 @@ SqlConnPool *SqlConnPool::instance() {
     return &inst;
 }
 
-void SqlConnPool::init(const char *host, int port, const char *user, const char *passwd, const char *db, int connSize) {
-    assert(connSize > 0);
-    MAX_CONN_ = connSize;
-    for (int i = 0; i < connSize; i++) {
-        MYSQL *conn = nullptr;
-        conn = mysql_init(conn);
-        if (!conn) {
-            LOG_ERROR("MySql Init Error!");
-            assert(conn);
-        }
-        conn = mysql_real_connect(conn, host, user, passwd, db, port, nullptr, 0);
+void SqlConnPool::init(const char *host, int port, const char *user, const char *pwd, const char *dbName,
+                       int maxConn, int minConn, int waitTimeoutMs) {
+    assert(maxConn > 0);
+    host_ = host;
+    port_ = port;
+    user_ = user;
+    pwd_ = pwd;
+    dbName_ = dbName;
+    maxConn_ = maxConn;
+    minConn_ = minConn < 0 ? std::max(1, maxConn / 4) : std::min(minConn, maxConn);
+    waitTimeoutMs_ = waitTimeoutMs;
+    retryAtMs_ = 0;
+    stats_ = Stats();  // close 之后可以再次 init, 统计从头算
+    closed_ = false;
+
+    uint64_t now = nowMs_();
+    for (int i = 0; i < minConn_; i++) {
+        MYSQL *conn = connect_();
         if (!conn) {
-            LOG_ERROR("MySql Connect Error!");
+            // 数据库暂时连不上也照常启动, 由后台线程退避重试, 期间查库的请求回 503
+            stats_.connectErrors++;
+            retryAtMs_ = now + timing_.retryInterval;
+            break;
         }
-        connQue_.push(conn);
-        sem_init(&semId_, 0, MAX_CONN_);
+        total_++;
+        idle_.push_back({conn, now, now});
     }
+    keeper_.reset(new std::thread(&SqlConnPool::keeperLoop_, this));
 }
 
-MYSQL *SqlConnPool::getConn() {
+MYSQL *SqlConnPool::getConn(int timeoutMs) {
+    // 在本线程上等 waiter 被调用, 后台线程保证超时时一定会调用
     MYSQL *conn = nullptr;
-    if (connQue_.empty()) {
-        LOG_WARN("SqlConnPool Is Busy!");
+    std::mutex mtx;
+    std::condition_variable cond;
+    bool done = false;
+    if (getConnOrWait(&conn, [&](MYSQL *c) {
+            std::lock_guard<std::mutex> locker(mtx);
+            conn = c;
+            done = true;
+            cond.notify_one();
+        }, timeoutMs)) {
+        return conn;
+    }
+    std::unique_lock<std::mutex> locker(mtx);
+    cond.wait(locker, [&done] { return done; });
+    return conn;
+}
+
+void SqlConnPool::freeConn(MYSQL *conn, bool broken) {
+    assert(conn);
+    if (!broken) {
+        put_(conn, nowMs_());
+        return;
     }
-    sem_wait(&semId_);
     {
         std::lock_guard<std::mutex> locker(mtx_);
-        conn = connQue_.front();
-        connQue_.pop();
+        stats_.broken++;
+        total_--;
+        keeperCv_.notify_one();  // 按需补建
     }
-    return conn;
+    LOG_WARN("MySql conn broken: %s", mysql_error(conn));
+    closeConn_(conn);
 }
 
-void SqlConnPool::freeConn(MYSQL *conn) {
-    assert(conn);
+bool SqlConnPool::getConnOrWait(MYSQL **conn, ConnWaiter waiter, int timeoutMs) {
     std::lock_guard<std::mutex> locker(mtx_);
-    connQue_.push(conn);
-    sem_post(&semId_);
+    if (!idle_.empty()) {
+        *conn = idle_.back().conn;
+        idle_.pop_back();
+        stats_.acquired++;
+        return true;
+    }
+    if (closed_) {
+        *conn = nullptr;
+        return true;
+    }
+    uint64_t now = nowMs_();
+    waiters_.push_back({std::move(waiter), now, now + (timeoutMs < 0 ? waitTimeoutMs_ : timeoutMs)});
+    keeperCv_.notify_one();  // 可能要扩容, 也要按这个等待者的期限醒来
+    return false;
 }
 
 int SqlConnPool::getFreeConnCount() {
     std::lock_guard<std::mutex> locker(mtx_);
-    return connQue_.size();
+    return idle_.size();
 }
 
 void SqlConnPool::close() {
+    std::deque<Waiter> waiters;
+    std::deque<IdleConn> idle;
+    {
+        std::lock_guard<std::mutex> locker(mtx_);
+        if (closed_) {
+            return;
+        }
+        closed_ = true;
+        waiters.swap(waiters_);
+        idle.swap(idle_);
+        total_ -= idle.size();
+        keeperCv_.notify_one();
+    }
+    if (keeper_ && keeper_->joinable()) {
+        keeper_->join();
+    }
+    keeper_.reset();
+    for (Waiter &w : waiters) {
+        w.callback(nullptr);
+    }
+    for (IdleConn &ic : idle) {
+        closeConn_(ic.conn);
+    }
+    // 借出的连接在归还时关闭
+    mysql_library_end();
+}
+
+SqlConnPool::Stats SqlConnPool::stats() {
     std::lock_guard<std::mutex> locker(mtx_);
-    while (!connQue_.empty()) {
-        auto conn = connQue_.front();
-        connQue_.pop();
+    Stats st = stats_;
+    st.minConn = minConn_;
+    st.maxConn = maxConn_;
+    st.total = total_;
+    st.idle = idle_.size();
+    st.inUse = total_ - st.idle;  // 含后台线程正在建立或检查的
+    st.waiting = waiters_.size();
+    return st;
+}
+
+MYSQL *SqlConnPool::connect_() {
+    MYSQL *conn = mysql_init(nullptr);
+    if (!conn) {
+        LOG_ERROR("MySql Init Error!");
+        return nullptr;
+    }
+#ifdef MYSQL_WAIT_READ
+    // 允许在这个连接上使用 mysql_*_start/_cont, 阻塞接口照常可用
+    mysql_options(conn, MYSQL_OPT_NONBLOCK, 0);
+#endif
+    unsigned int timeout = CONNECT_TIMEOUT;
+    mysql_options(conn, MYSQL_OPT_CONNECT_TIMEOUT, &timeout);
+    if (!mysql_real_connect(conn, host_.c_str(), user_.c_str(), pwd_.c_str(), dbName_.c_str(), port_, nullptr, 0)) {
+        LOG_ERROR("MySql Connect Error: %s", mysql_error(conn));
         mysql_close(conn);
+        return nullptr;
     }
-    mysql_library_end();
-}
\ No newline at end of file
+    return conn;
+}
+
+void SqlConnPool::closeConn_(MYSQL *conn) {
+    ConnStmts cs;
+    {
+        std::lock_guard<std::mutex> locker(mtx_);
+        auto it = stmts_.find(conn);
+        if (it != stmts_.end()) {
+            cs = it->second;
+            stmts_.erase(it);
+        }
+    }
+    closeStmts_(&cs);
+    mysql_close(conn);
+}
+
+void SqlConnPool::put_(MYSQL *conn, uint64_t freedMs) {
+    ConnWaiter waiter;
+    {
+        std::lock_guard<std::mutex> locker(mtx_);
+        uint64_t now = nowMs_();
+        if (closed_) {
+            total_--;
+        } else if (waiters_.empty()) {
+            idle_.push_back({conn, freedMs, now});
+            return;
+        } else {
+            Waiter &w = waiters_.front();
+            uint64_t waitMs = now - w.sinceMs;
+            stats_.acquired++;
+            stats_.waited++;
+            stats_.waitMsTotal += waitMs;
+            stats_.waitMsMax = std::max(stats_.waitMsMax, waitMs);
+            waiter = std::move(w.callback);
+            waiters_.pop_front();
+        }
+    }
+    if (!waiter) {
+        closeConn_(conn);
+        return;
+    }
+    waiter(conn);  // 不经过空闲队列, 连接直接转交
+}
+
+void SqlConnPool::keeperLoop_() {
+    std::vector<ConnWaiter> expired;
+    std::vector<IdleConn> toPing;
+    std::vector<MYSQL *> toClose;
+    std::unique_lock<std::mutex> locker(mtx_);
+    while (!closed_) {
+        /* 持锁只挑出要做的事, 建连、ping、关闭和回调都在锁外 */
+        uint64_t now = nowMs_();
+        for (auto it = waiters_.begin(); it != waiters_.end();) {
+            if (it->deadlineMs <= now) {
+                expired.push_back(std::move(it->callback));
+                it = waiters_.erase(it);
+                stats_.timeouts++;
+            } else {
+                ++it;
+            }
+        }
+        // 补足最小连接数, 有人等待时再扩容, 不超过上限; 先占住名额
+        int toOpen = 0;
+        if (now >= retryAtMs_) {
+            toOpen = std::max({0, minConn_ - total_, std::min(static_cast<int>(waiters_.size()), maxConn_ - total_)});
+            total_ += toOpen;
+        }
+        // 表头的空闲最久: 多于最小连接数时回收, 否则到期 ping 一次
+        for (auto it = idle_.begin(); it != idle_.end();) {
+            if (now - it->freedMs >= static_cast<uint64_t>(timing_.idleTimeout) && total_ > minConn_) {
+                toClose.push_back(it->conn);
+                total_--;
+                stats_.trimmed++;
+                it = idle_.erase(it);
+            } else if (now - it->checkedMs >= static_cast<uint64_t>(timing_.pingInterval)) {
+                toPing.push_back(*it);
+                it = idle_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        locker.unlock();
+
+        for (ConnWaiter &cb : expired) {
+            cb(nullptr);
+        }
+        expired.clear();
+        for (MYSQL *conn : toClose) {
+            closeConn_(conn);
+        }
+        toClose.clear();
+        for (IdleConn &ic : toPing) {
+            if (mysql_ping(ic.conn) == 0) {
+                put_(ic.conn, ic.freedMs);
+                continue;
+            }
+            LOG_WARN("MySql ping error: %s, reconnecting", mysql_error(ic.conn));
+            closeConn_(ic.conn);
+            MYSQL *conn = connect_();
+            {
+                std::lock_guard<std::mutex> guard(mtx_);
+                stats_.pingFailures++;
+                if (!conn) {
+                    stats_.connectErrors++;
+                    total_--;
+                    retryAtMs_ = nowMs_() + timing_.retryInterval;
+                }
+            }
+            if (conn) {
+                put_(conn, nowMs_());
+            }
+        }
+        toPing.clear();
+        for (int i = 0; i < toOpen; i++) {
+            MYSQL *conn = connect_();
+            if (!conn) {
+                std::lock_guard<std::mutex> guard(mtx_);
+                stats_.connectErrors++;
+                total_ -= toOpen - i;
+                retryAtMs_ = nowMs_() + timing_.retryInterval;
+                break;
+            }
+            put_(conn, nowMs_());
+        }
+
+        locker.lock();
+        if (closed_) {
+            break;
+        }
+        now = nowMs_();
+        if (!waiters_.empty() && total_ < maxConn_ && now >= retryAtMs_) {
+            continue;  // 建连期间又来了等待者
+        }
+        uint64_t wakeMs = now + timing_.keeperTick;
+        for (const Waiter &w : waiters_) {
+            wakeMs = std::min(wakeMs, w.deadlineMs);
+        }
+        keeperCv_.wait_until(locker, std::chrono::steady_clock::time_point(std::chrono::milliseconds(wakeMs)));
+    }
+}
+
+uint64_t SqlConnPool::nowMs_() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+const char *SqlConnPool::stmtSql(STMT id) {
+    static const char *SQLS[STMT_NUM] = {
+        "SELECT password FROM user WHERE username = ? LIMIT 1",
+        "INSERT INTO user(username, password) VALUES(?, ?)",
+    };
+    assert(id >= 0 && id < STMT_NUM);
+    return SQLS[id];
+}
+
+MYSQL_STMT *SqlConnPool::cachedStmt(MYSQL *conn, STMT id) {
+    assert(conn);
+    ConnStmts *cs = stmtsOf_(conn);
+    if (cs->threadId != mysql_thread_id(conn)) {
+        // 连接重连过, 旧句柄在服务端已失效
+        closeStmts_(cs);
+        cs->threadId = mysql_thread_id(conn);
+    }
+    return cs->stmts[id];
+}
+
+void SqlConnPool::cacheStmt(MYSQL *conn, STMT id, MYSQL_STMT *stmt) {
+    assert(conn && stmt);
+    ConnStmts *cs = stmtsOf_(conn);
+    if (cs->threadId != mysql_thread_id(conn)) {
+        closeStmts_(cs);
+        cs->threadId = mysql_thread_id(conn);
+    }
+    if (cs->stmts[id]) {
+        mysql_stmt_close(cs->stmts[id]);
+    }
+    cs->stmts[id] = stmt;
+}
+
+MYSQL_STMT *SqlConnPool::getStmt(MYSQL *conn, STMT id) {
+    MYSQL_STMT *stmt = cachedStmt(conn, id);
+    if (stmt) {
+        return stmt;
+    }
+    stmt = mysql_stmt_init(conn);
+    if (!stmt) {
+        LOG_ERROR("MySql stmt init error: %s", mysql_error(conn));
+        return nullptr;
+    }
+    const char *sql = stmtSql(id);
+    if (mysql_stmt_prepare(stmt, sql, strlen(sql))) {
+        LOG_ERROR("MySql prepare error: %s", mysql_stmt_error(stmt));
+        mysql_stmt_close(stmt);
+        return nullptr;
+    }
+    cacheStmt(conn, id, stmt);
+    return stmt;
+}
+
+void SqlConnPool::dropStmts(MYSQL *conn) {
+    assert(conn);
+    closeStmts_(stmtsOf_(conn));
+}
+
+bool SqlConnPool::onStmtError(MYSQL *conn, MYSQL_STMT *stmt) {
+    unsigned int err = stmt ? mysql_stmt_errno(stmt) : mysql_errno(conn);
+    LOG_WARN("MySql error %u: %s", err, stmt ? mysql_stmt_error(stmt) : mysql_error(conn));
+    if (isConnError(err)) {
+        return true;
+    }
+    dropStmts(conn);
+    return false;
+}
+
+SqlConnPool::ConnStmts *SqlConnPool::stmtsOf_(MYSQL *conn) {
+    std::lock_guard<std::mutex> locker(mtx_);
+    return &stmts_[conn];
+}
+
+void SqlConnPool::closeStmts_(ConnStmts *cs) {
+    for (MYSQL_STMT *&stmt : cs->stmts) {
+        if (stmt) {
+            mysql_stmt_close(stmt);
+            stmt = nullptr;
+        }
+    }
+}
@@ -1,36 +1,150 @@
 #ifndef SQLCONNPOOL_H
 #define SQLCONNPOOL_H
 
+#include <mysql/errmsg.h>
 #include <mysql/mysql.h>
-#include <semaphore.h>
 
 #include <cassert>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
 #include <mutex>
-#include <queue>
+#include <string>
 #include <thread>
+#include <unordered_map>
 
 #include "../log/log.h"
 
+/*
+ * MySQL 连接池, 连接数在 [minConn, maxConn] 之间伸缩
+ * 取连接有时限: 没有空闲连接时等待, 超时返回 nullptr, 调用方据此回 503 而不是一直占着线程
+ * 建连、保活和回收都在后台线程上做, 取连接的一方不会阻塞在建连上:
+ *   - 有人等待且未达上限时新建连接, 建好后直接交给等待者; 建连失败后退避一段时间再试
+ *   - 空闲超过 pingInterval 的连接 ping 一次, 不通就关掉重建, 借出的总是检查过的连接
+ *   - 空闲超过 idleTimeout 且多于 minConn 的连接关掉
+ * 使用中发现连接已断(客户端错误码 CR_*), 归还时带上 broken, 由池关掉并按需补建
+ */
 class SqlConnPool {
 public:
     static SqlConnPool *instance();
-    void init(const char *host, int port, const char *user, const char *pwd, const char *dbName, int connSize = 16);
 
-    MYSQL *getConn();
-    void freeConn(MYSQL *conn);
+    /* 后台线程的各项时间, 毫秒; 在 init 之前设置, 测试时调短 */
+    struct Timing {
+        int pingInterval = 30000;
+        int idleTimeout = 60000;
+        int retryInterval = 1000;  // 建连失败后的退避
+        int keeperTick = 1000;
+    };
+    void setTiming(const Timing &timing) { timing_ = timing; }
+
+    /* minConn 在 init 时同步建好; minConn < 0 时取 maxConn 的四分之一 */
+    void init(const char *host, int port, const char *user, const char *pwd, const char *dbName,
+              int maxConn = 16, int minConn = -1, int waitTimeoutMs = 1000);
+
+    /* timeoutMs < 0 时用 init 的 waitTimeoutMs; 超时或连接池已关闭返回 nullptr */
+    MYSQL *getConn(int timeoutMs = -1);
+    void freeConn(MYSQL *conn, bool broken = false);
+
+    /*
+     * 不阻塞地取连接: 有空闲连接时取出放入 *conn 并返回 true;
+     * 否则登记 waiter 返回 false, 之后在归还连接、新建好连接或超时的线程上调用 waiter, 超时时传入 nullptr
+     */
+    using ConnWaiter = std::function<void(MYSQL *)>;
+    bool getConnOrWait(MYSQL **conn, ConnWaiter waiter, int timeoutMs = -1);
     int getFreeConnCount();
     void close();
 
+    /* 客户端错误码(CR_*, 断开、超时等), 保守地当作连接已坏; 服务端返回的语句错误不算 */
+    static bool isConnError(unsigned int err) { return err >= CR_MIN_ERROR && err <= CR_MAX_ERROR; }
+
+    struct Stats {
+        int minConn = 0;
+        int maxConn = 0;
+        int total = 0;              // 已建立和正在建立的连接
+        int idle = 0;
+        int inUse = 0;
+        size_t waiting = 0;
+        uint64_t acquired = 0;      // 取到连接的次数
+        uint64_t waited = 0;        // 其中需要等待的次数
+        uint64_t waitMsTotal = 0;
+        uint64_t waitMsMax = 0;
+        uint64_t timeouts = 0;      // 等待超时, 请求以 503 结束
+        uint64_t connectErrors = 0;
+        uint64_t pingFailures = 0;  // 保活时发现断开
+        uint64_t broken = 0;        // 使用中发现断开
+        uint64_t trimmed = 0;       // 空闲太久被回收
+    };
+    Stats stats();
+
+    /*
+     * 每个连接上缓存的预编译语句, 第一次用到时才 prepare, 之后只走二进制协议的 execute
+     * 语句属于连接, 由持有连接的一方独占使用; 连接重连后(mysql_thread_id 变化)服务端已没有这些语句,
+     * cachedStmt 会丢掉旧句柄返回 nullptr, 调用方重新 prepare 后用 cacheStmt 存回
+     * 池里关掉的连接连同语句一起释放, 重建的连接从空缓存开始
+     */
+    enum STMT {
+        STMT_SELECT_USER = 0,
+        STMT_INSERT_USER,
+        STMT_NUM
+    };
+    static const char *stmtSql(STMT id);
+    MYSQL_STMT *cachedStmt(MYSQL *conn, STMT id);
+    void cacheStmt(MYSQL *conn, STMT id, MYSQL_STMT *stmt);
+    MYSQL_STMT *getStmt(MYSQL *conn, STMT id);  // 阻塞版本: 没有缓存就当场 prepare, 失败返回 nullptr
+    void dropStmts(MYSQL *conn);                // 执行出错后调用, 下次使用时重新 prepare
+    /* 语句出错后调用, 记下错误: 连接已断时返回 true, 调用方归还时带上 broken; 否则丢掉语句缓存 */
+    bool onStmtError(MYSQL *conn, MYSQL_STMT *stmt);
+
 private:
-    SqlConnPool() = default;
+    SqlConnPool();
     ~SqlConnPool();
 
+    struct ConnStmts {
+        unsigned long threadId = 0;  // prepare 时连接的 thread id
+        MYSQL_STMT *stmts[STMT_NUM] = {};
+    };
+    ConnStmts *stmtsOf_(MYSQL *conn);
+    static void closeStmts_(ConnStmts *cs);
+
+    struct IdleConn {
+        MYSQL *conn;
+        uint64_t freedMs;    // 归还的时间, 判断是否空闲太久
+        uint64_t checkedMs;  // 最近一次确认可用(归还或 ping 成功)的时间
+    };
+    struct Waiter {
+        ConnWaiter callback;
+        uint64_t sinceMs;
+        uint64_t deadlineMs;
+    };
+
+    MYSQL *connect_();
+    void closeConn_(MYSQL *conn);
+    void put_(MYSQL *conn, uint64_t now);  // 交给等待者或放回空闲队列
+    void keeperLoop_();
+    static uint64_t nowMs_();
+
 private:
-    int MAX_CONN_;
+    static const unsigned int CONNECT_TIMEOUT = 3;  // 秒, 后台线程建连最多卡这么久
+
+    std::string host_, user_, pwd_, dbName_;
+    int port_;
+    int minConn_;
+    int maxConn_;
+    int waitTimeoutMs_;
+    Timing timing_;
 
-    std::queue<MYSQL *> connQue_;
     std::mutex mtx_;
-    sem_t semId_;
+    std::deque<IdleConn> idle_;   // 表尾最近归还, 取连接从表尾取, 回收和保活从表头看
+    std::deque<Waiter> waiters_;  // 先到先得
+    int total_;
+    uint64_t retryAtMs_;          // 建连失败后, 到这个时间之前不再新建
+    bool closed_;
+    Stats stats_;
+    std::unordered_map<MYSQL *, ConnStmts> stmts_;  // 节点地址稳定, 查到后在锁外使用
+
+    std::condition_variable keeperCv_;
+    std::unique_ptr<std::thread> keeper_;
 };
 
-#endif  // SQLCONNPOOL_H
\ No newline at end of file
+#endif  // SQLCONNPOOL_H
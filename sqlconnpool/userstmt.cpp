@@ -0,0 +1,42 @@
+#include "userstmt.h"
+
+#include <cstring>
+
+UserStmt::UserStmt(std::string name, std::string pwd)
+    : name_(std::move(name)), pwd_(std::move(pwd)), storedLen_(0) {
+    memset(params_, 0, sizeof(params_));
+    memset(&result_, 0, sizeof(result_));
+}
+
+bool UserStmt::bindSelect(MYSQL_STMT *stmt) {
+    bindString_(&params_[0], name_);
+    result_.buffer_type = MYSQL_TYPE_STRING;
+    result_.buffer = stored_;
+    result_.buffer_length = sizeof(stored_);
+    result_.length = &storedLen_;
+    return !mysql_stmt_bind_param(stmt, params_) && !mysql_stmt_bind_result(stmt, &result_);
+}
+
+bool UserStmt::bindInsert(MYSQL_STMT *stmt) {
+    bindString_(&params_[0], name_);
+    bindString_(&params_[1], pwd_);
+    return !mysql_stmt_bind_param(stmt, params_);
+}
+
+bool UserStmt::fetch(MYSQL_STMT *stmt, std::string *pwd) {
+    int ret = mysql_stmt_fetch(stmt);
+    if (ret == 0) {
+        pwd->assign(stored_, storedLen_);
+    } else {
+        pwd->clear();
+    }
+    mysql_stmt_free_result(stmt);
+    return ret == 0 || ret == MYSQL_DATA_TRUNCATED;
+}
+
+void UserStmt::bindString_(MYSQL_BIND *bind, const std::string &str) {
+    // length 为空时以 buffer_length 作为参数长度
+    bind->buffer_type = MYSQL_TYPE_STRING;
+    bind->buffer = const_cast<char *>(str.data());
+    bind->buffer_length = str.size();
+}
@@ -0,0 +1,39 @@
+#ifndef USER_STMT_H
+#define USER_STMT_H
+
+#include <mysql/mysql.h>
+
+#include <string>
+
+/*
+ * user 表两条预编译语句(SqlConnPool::STMT_SELECT_USER / STMT_INSERT_USER)的参数与结果绑定
+ * 用户名和密码作为参数原样交给服务端, 不再拼进 SQL 文本
+ * 绑定里存的是成员的地址, 对象要活到 execute 和 fetch 结束, 不能拷贝或移动
+ */
+class UserStmt {
+public:
+    explicit UserStmt(std::string name, std::string pwd = "");
+    UserStmt(const UserStmt &) = delete;
+    UserStmt &operator=(const UserStmt &) = delete;
+
+    bool bindSelect(MYSQL_STMT *stmt);  // 参数 username, 结果 password
+    bool bindInsert(MYSQL_STMT *stmt);  // 参数 username, password
+
+    /*
+     * 取 SELECT 已执行并取回的结果, 之后释放结果集: 用户存在返回 true, 库里的密码放入 *pwd
+     * 密码超长被截断时 *pwd 置空, 不会与任何请求的密码一致
+     */
+    bool fetch(MYSQL_STMT *stmt, std::string *pwd);
+
+private:
+    static void bindString_(MYSQL_BIND *bind, const std::string &str);
+
+    std::string name_;
+    std::string pwd_;
+    MYSQL_BIND params_[2];
+    MYSQL_BIND result_;
+    char stored_[256];  // 库里的密码
+    unsigned long storedLen_;
+};
+
+#endif  // USER_STMT_H
@@ -0,0 +1,201 @@
+#include <string>
+
+#include "../sqlconnpool/asyncsql.h"
+#include "../sqlconnpool/userstmt.h"
+#include "../userstore/mysqluserstore.h"
+#include "fakemysql/fakemysql.h"
+#include "test.h"
+
+namespace {
+
+SqlConnPool *initPool(int maxConn, int waitTimeoutMs) {
+    SqlConnPool::Timing timing;
+    timing.keeperTick = 10;
+    SqlConnPool *pool = SqlConnPool::instance();
+    pool->setTiming(timing);
+    pool->init("localhost", 3306, "root", "root", "webserver", maxConn, maxConn, waitTimeoutMs);
+    return pool;
+}
+
+/* prepare 和 execute 各要经过几轮 _cont, 每轮协程都挂在 Reactor 上等 socket 可读 */
+void contRounds(test::ReactorThread *rt) {
+    fakemysql::reset();
+    fakemysql::addUser("alice", "secret");
+    fakemysql::setWaitRounds(3);
+    fakemysql::setDelayMs(5);
+    SqlConnPool *pool = initPool(1, 1000);
+
+    bool found = false;
+    std::string pwd;
+    bool ticked = false;
+    CHECK(rt->run([&]() -> Task<void> {
+        AsyncSql sql(rt->get(), pool);
+        MYSQL *conn = co_await sql.acquire();
+        CHECK(conn != nullptr);
+        UserStmt user("alice");
+        MYSQL_STMT *stmt = co_await sql.prepare(conn, SqlConnPool::STMT_SELECT_USER);
+        CHECK(stmt != nullptr);
+        CHECK(pool->cachedStmt(conn, SqlConnPool::STMT_SELECT_USER) == stmt);
+        CHECK(user.bindSelect(stmt));
+        CHECK(co_await sql.execute(conn, stmt));
+        found = user.fetch(stmt, &pwd);
+        sql.release(conn);
+    }));
+    CHECK(found);
+    CHECK(pwd == "secret");
+    fakemysql::Counters cnt = fakemysql::counters();
+    CHECK(cnt.conts == 6);
+    CHECK(cnt.prepares == 1);
+    CHECK(cnt.executes == 1);
+
+    // 等待期间 Reactor 没有被占住: 查询进行中另一个协程的 sleep 照常到期
+    CHECK(rt->run([&]() -> Task<void> {
+        struct Ticker {
+            static Task<void> run(Reactor *reactor, bool *ticked) {
+                co_await reactor->sleep(1);
+                *ticked = true;
+            }
+        };
+        spawn(Ticker::run(rt->get(), &ticked));
+        AsyncSql sql(rt->get(), pool);
+        MYSQL *conn = co_await sql.acquire();
+        UserStmt user("alice");
+        MYSQL_STMT *stmt = co_await sql.prepare(conn, SqlConnPool::STMT_SELECT_USER);  // 已缓存, 不再 prepare
+        fakemysql::setDelayMs(50);
+        CHECK(stmt && user.bindSelect(stmt) && co_await sql.execute(conn, stmt));
+        CHECK(ticked);
+        sql.release(conn);
+    }));
+    CHECK(fakemysql::counters().prepares == 1);
+
+    // 不需要等待时 _start 直接完成, 不调用 _cont
+    fakemysql::setWaitRounds(0);
+    int conts = fakemysql::counters().conts;
+    found = false;
+    CHECK(rt->run([&]() -> Task<void> {
+        MysqlUserStore store;
+        found = co_await store.findAsync(rt->get(), nullptr, "alice", &pwd) == UserStore::FOUND;
+    }));
+    CHECK(found);
+    CHECK(fakemysql::counters().conts == conts);
+    pool->close();
+}
+
+/* 客户端库要求带超时等待, 期限内 socket 没有就绪: 以 MYSQL_WAIT_TIMEOUT 调 _cont, 得到连接错误, 归还时关掉 */
+void waitTimeout(test::ReactorThread *rt) {
+    fakemysql::reset();
+    fakemysql::addUser("alice", "secret");
+    SqlConnPool *pool = initPool(1, 1000);
+
+    // 先查一次, 语句已缓存, 下面等待超时的是 execute
+    UserStore::FIND_RESULT found = UserStore::UNAVAILABLE;
+    CHECK(rt->run([&]() -> Task<void> {
+        MysqlUserStore store;
+        std::string pwd;
+        found = co_await store.findAsync(rt->get(), nullptr, "alice", &pwd);
+    }));
+    CHECK(found == UserStore::FOUND);
+
+    fakemysql::setHang(true);
+    fakemysql::setTimeoutMs(30);
+    uint64_t start = test::nowMs();
+    CHECK(rt->run([&]() -> Task<void> {
+        MysqlUserStore store;
+        std::string pwd;
+        found = co_await store.findAsync(rt->get(), nullptr, "alice", &pwd);
+    }));
+    CHECK(found == UserStore::UNAVAILABLE);
+    CHECK(test::nowMs() - start >= 30);
+    CHECK(fakemysql::counters().timeouts == 1);
+    CHECK(fakemysql::counters().prepares == 1);
+    CHECK(pool->stats().broken == 1);
+
+    // 补建的连接照常可用
+    fakemysql::setHang(false);
+    fakemysql::setTimeoutMs(0);
+    CHECK(rt->run([&]() -> Task<void> {
+        MysqlUserStore store;
+        std::string pwd;
+        found = co_await store.findAsync(rt->get(), nullptr, "alice", &pwd);
+    }));
+    CHECK(found == UserStore::FOUND);
+    pool->close();
+}
+
+/* 服务端拒绝的语句是普通失败: 连接不算坏, 丢掉语句缓存; 连接错误则按 broken 归还 */
+void stmtErrors(test::ReactorThread *rt) {
+    fakemysql::reset();
+    fakemysql::addUser("alice", "secret");
+    SqlConnPool *pool = initPool(1, 1000);
+
+    HttpRequest::AUTH_RESULT dup = HttpRequest::AUTH_OK;
+    HttpRequest::AUTH_RESULT added = HttpRequest::AUTH_FAIL;
+    CHECK(rt->run([&]() -> Task<void> {
+        MysqlUserStore store;
+        dup = co_await store.addAsync(rt->get(), nullptr, "alice", "other");
+        added = co_await store.addAsync(rt->get(), nullptr, "bob", "pwd");
+    }));
+    CHECK(dup == HttpRequest::AUTH_FAIL);
+    CHECK(added == HttpRequest::AUTH_OK);
+    CHECK(fakemysql::hasUser("bob"));
+    CHECK(fakemysql::counters().prepares == 2);  // 出错后语句缓存被丢掉, 第二次重新 prepare
+    CHECK(pool->stats().broken == 0);
+
+    fakemysql::setDown(true);
+    added = HttpRequest::AUTH_OK;
+    CHECK(rt->run([&]() -> Task<void> {
+        MysqlUserStore store;
+        added = co_await store.addAsync(rt->get(), nullptr, "carol", "pwd");
+    }));
+    CHECK(added == HttpRequest::AUTH_UNAVAILABLE);
+    CHECK(pool->stats().broken == 1);
+    fakemysql::setDown(false);
+    pool->close();
+}
+
+/* 连接池空时 acquire 挂起, 别的线程归还后 post 回 Reactor 线程; 超时得到 nullptr */
+void acquireWaits(test::ReactorThread *rt) {
+    fakemysql::reset();
+    SqlConnPool *pool = initPool(1, 50);
+    MYSQL *held = pool->getConn();
+    CHECK(held != nullptr);
+
+    MYSQL *got = held;
+    CHECK(rt->run([&]() -> Task<void> {
+        AsyncSql sql(rt->get(), pool);
+        got = co_await sql.acquire();
+    }));
+    CHECK(got == nullptr);
+    CHECK(pool->stats().timeouts == 1);
+
+    std::thread releaser([pool, held] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        pool->freeConn(held);
+    });
+    bool onLoop = false;
+    CHECK(rt->run([&]() -> Task<void> {
+        AsyncSql sql(rt->get(), pool);
+        SqlConnPool::Stats before = pool->stats();
+        got = co_await sql.acquire();
+        onLoop = std::this_thread::get_id() != releaser.get_id();
+        CHECK(pool->stats().waited == before.waited + 1);
+        sql.release(got);
+    }));
+    releaser.join();
+    CHECK(got == held);
+    CHECK(onLoop);
+    pool->close();
+}
+
+}  // namespace
+
+void testAsyncSql() {
+    if (!AsyncSql::isNonBlocking()) {
+        return;  // 假客户端库总是有非阻塞接口
+    }
+    test::ReactorThread rt;
+    contRounds(&rt);
+    waitTimeout(&rt);
+    stmtErrors(&rt);
+    acquireWaits(&rt);
+}
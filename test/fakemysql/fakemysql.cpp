@@ -0,0 +1,405 @@
+#include "fakemysql.h"
+
+#include <mysql/errmsg.h>
+#include <mysql/mysql.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+
+namespace {
+const unsigned int ER_DUP_ENTRY = 1062;
+const unsigned int ER_UNKNOWN_STMT_HANDLER = 1243;
+
+enum OP {
+    OP_PREPARE,
+    OP_EXECUTE,
+    OP_STORE,
+};
+
+std::atomic<bool> down{false};
+std::atomic<int> delayMs{0};
+std::atomic<int> waitRounds{1};
+std::atomic<bool> hang{false};
+std::atomic<int> timeoutMs{0};
+std::atomic<int> reconnectEvery{0};
+std::atomic<unsigned long> nextTid{1};
+
+std::mutex mtx;  // 保护用户表和计数
+std::unordered_map<std::string, std::string> users;
+fakemysql::Counters cnt;
+int openCnt = 0;
+
+void count(int fakemysql::Counters::*field) {
+    std::lock_guard<std::mutex> locker(mtx);
+    cnt.*field += 1;
+}
+
+/* 与真的客户端库一样, 连接层的错误(CR_*)同时记在连接上, 语句关掉后 mysql_errno 仍能读到 */
+int fail(MYSQL_STMT *stmt, unsigned int err) {
+    stmt->err = err;
+    if (err >= CR_MIN_ERROR && err <= CR_MAX_ERROR) {
+        stmt->mysql->err = err;
+    }
+    return 1;
+}
+
+std::string param(const MYSQL_BIND &bind) {
+    unsigned long len = bind.length ? *bind.length : bind.buffer_length;
+    return std::string(static_cast<const char *>(bind.buffer), len);
+}
+
+/* 一次执行的结果, 阻塞和非阻塞接口共用 */
+int doExecute(MYSQL_STMT *stmt) {
+    MYSQL *conn = stmt->mysql;
+    count(&fakemysql::Counters::executes);
+    stmt->hasRow = 0;
+    conn->err = 0;
+    if (down) {
+        return fail(stmt, CR_SERVER_LOST);
+    }
+    if (stmt->tid != conn->tid) {
+        return fail(stmt, ER_UNKNOWN_STMT_HANDLER);  // 语句是重连前 prepare 的
+    }
+    int every = reconnectEvery;
+    if (every > 0 && ++conn->execs % every == 0) {
+        conn->tid = nextTid++;
+        return fail(stmt, CR_SERVER_LOST);
+    }
+    stmt->err = 0;
+    std::lock_guard<std::mutex> locker(mtx);
+    std::string name = param(stmt->param[0]);
+    if (stmt->kind == 0) {
+        auto it = users.find(name);
+        if (it != users.end()) {
+            stmt->hasRow = 1;
+            stmt->rowLen = std::min(it->second.size(), sizeof(stmt->row));
+            memcpy(stmt->row, it->second.data(), stmt->rowLen);
+        }
+        return 0;
+    }
+    if (!users.emplace(name, param(stmt->param[1])).second) {
+        return fail(stmt, ER_DUP_ENTRY);
+    }
+    return 0;
+}
+
+int doPrepare(MYSQL_STMT *stmt) {
+    count(&fakemysql::Counters::prepares);
+    stmt->mysql->err = 0;
+    if (down) {
+        return fail(stmt, CR_SERVER_LOST);
+    }
+    stmt->tid = stmt->mysql->tid;
+    stmt->err = 0;
+    return 0;
+}
+
+int complete(MYSQL_STMT *stmt, OP op) {
+    switch (op) {
+        case OP_PREPARE:
+            return doPrepare(stmt);
+        case OP_EXECUTE:
+            return doExecute(stmt);
+        default:
+            return 0;
+    }
+}
+
+void arm(MYSQL *conn) {
+    int ms = std::max(1, delayMs.load());
+    struct itimerspec ts = {{0, 0}, {ms / 1000, (ms % 1000) * 1000000L}};
+    timerfd_settime(conn->fd, 0, &ts, nullptr);
+}
+
+int waitStatus() {
+    return MYSQL_WAIT_READ | (timeoutMs > 0 ? MYSQL_WAIT_TIMEOUT : 0);
+}
+
+/* 非阻塞接口: _start 要么直接完成(返回 0), 要么要求等待 socket 可读 */
+int start(int *ret, MYSQL_STMT *stmt, OP op) {
+    stmt->pending = hang ? 1 : waitRounds.load();
+    if (stmt->pending <= 0) {
+        *ret = complete(stmt, op);
+        return 0;
+    }
+    if (!hang) {
+        arm(stmt->mysql);
+    }
+    return waitStatus();
+}
+
+int cont(int *ret, MYSQL_STMT *stmt, OP op, int status) {
+    count(&fakemysql::Counters::conts);
+    uint64_t expirations;
+    if ((status & MYSQL_WAIT_READ) && read(stmt->mysql->fd, &expirations, sizeof(expirations)) == sizeof(expirations)) {
+        if (--stmt->pending > 0) {
+            arm(stmt->mysql);
+            return waitStatus();
+        }
+        *ret = complete(stmt, op);
+        return 0;
+    }
+    if (status & MYSQL_WAIT_TIMEOUT) {
+        count(&fakemysql::Counters::timeouts);
+        *ret = fail(stmt, CR_SERVER_LOST);
+        return 0;
+    }
+    return waitStatus();  // 没有就绪, 继续等
+}
+}  // namespace
+
+namespace fakemysql {
+
+void reset() {
+    down = false;
+    delayMs = 0;
+    waitRounds = 1;
+    hang = false;
+    timeoutMs = 0;
+    reconnectEvery = 0;
+    std::lock_guard<std::mutex> locker(mtx);
+    users.clear();
+    cnt = Counters();
+}
+
+void setDown(bool value) {
+    down = value;
+}
+
+void setDelayMs(int ms) {
+    delayMs = ms;
+}
+
+void setWaitRounds(int rounds) {
+    waitRounds = rounds;
+}
+
+void setHang(bool value) {
+    hang = value;
+}
+
+void setTimeoutMs(int ms) {
+    timeoutMs = ms;
+}
+
+void setReconnectEvery(int n) {
+    reconnectEvery = n;
+}
+
+void reconnect(MYSQL *conn) {
+    conn->tid = nextTid++;
+}
+
+void addUser(const std::string &name, const std::string &pwd) {
+    std::lock_guard<std::mutex> locker(mtx);
+    users[name] = pwd;
+}
+
+bool hasUser(const std::string &name) {
+    std::lock_guard<std::mutex> locker(mtx);
+    return users.count(name) > 0;
+}
+
+Counters counters() {
+    std::lock_guard<std::mutex> locker(mtx);
+    return cnt;
+}
+
+int openConns() {
+    std::lock_guard<std::mutex> locker(mtx);
+    return openCnt;
+}
+
+}  // namespace fakemysql
+
+extern "C" {
+
+MYSQL *mysql_init(MYSQL *mysql) {
+    if (!mysql) {
+        mysql = static_cast<MYSQL *>(calloc(1, sizeof(MYSQL)));
+    }
+    mysql->fd = -1;
+    return mysql;
+}
+
+int mysql_options(MYSQL *, enum mysql_option, const void *) {
+    return 0;
+}
+
+MYSQL *mysql_real_connect(MYSQL *mysql, const char *, const char *, const char *, const char *, unsigned int, const char *, unsigned long) {
+    if (down) {
+        mysql->err = CR_CONN_HOST_ERROR;
+        count(&fakemysql::Counters::connectErrors);
+        return nullptr;
+    }
+    mysql->fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    mysql->tid = nextTid++;
+    mysql->err = 0;
+    std::lock_guard<std::mutex> locker(mtx);
+    cnt.connects++;
+    openCnt++;
+    return mysql;
+}
+
+void mysql_close(MYSQL *mysql) {
+    if (!mysql) {
+        return;
+    }
+    if (mysql->fd >= 0) {
+        close(mysql->fd);
+        std::lock_guard<std::mutex> locker(mtx);
+        cnt.closes++;
+        openCnt--;
+    }
+    free(mysql);
+}
+
+int mysql_ping(MYSQL *mysql) {
+    count(&fakemysql::Counters::pings);
+    if (down) {
+        mysql->err = CR_SERVER_LOST;
+        count(&fakemysql::Counters::pingErrors);
+        return 1;
+    }
+    mysql->err = 0;
+    return 0;
+}
+
+unsigned int mysql_errno(MYSQL *mysql) {
+    return mysql->err;
+}
+
+const char *mysql_error(MYSQL *mysql) {
+    return mysql->err ? "fake mysql error" : "";
+}
+
+unsigned long mysql_thread_id(MYSQL *mysql) {
+    return mysql->tid;
+}
+
+void mysql_library_end(void) {
+}
+
+int mysql_get_socket(const MYSQL *mysql) {
+    return mysql->fd;
+}
+
+unsigned int mysql_get_timeout_value_ms(const MYSQL *) {
+    return timeoutMs;
+}
+
+MYSQL_STMT *mysql_stmt_init(MYSQL *mysql) {
+    MYSQL_STMT *stmt = static_cast<MYSQL_STMT *>(calloc(1, sizeof(MYSQL_STMT)));
+    stmt->mysql = mysql;
+    return stmt;
+}
+
+int mysql_stmt_prepare(MYSQL_STMT *stmt, const char *query, unsigned long) {
+    stmt->kind = strncmp(query, "SELECT", 6) == 0 ? 0 : 1;
+    return doPrepare(stmt);
+}
+
+my_bool mysql_stmt_bind_param(MYSQL_STMT *stmt, MYSQL_BIND *bind) {
+    stmt->param = bind;
+    return 0;
+}
+
+my_bool mysql_stmt_bind_result(MYSQL_STMT *stmt, MYSQL_BIND *bind) {
+    stmt->result = bind;
+    return 0;
+}
+
+int mysql_stmt_execute(MYSQL_STMT *stmt) {
+    int ms = delayMs;
+    if (ms > 0) {
+        usleep(ms * 1000);
+    }
+    return doExecute(stmt);
+}
+
+int mysql_stmt_store_result(MYSQL_STMT *) {
+    return 0;
+}
+
+int mysql_stmt_fetch(MYSQL_STMT *stmt) {
+    if (!stmt->hasRow) {
+        return MYSQL_NO_DATA;
+    }
+    stmt->hasRow = 0;
+    MYSQL_BIND *bind = stmt->result;
+    *bind->length = stmt->rowLen;
+    if (bind->buffer_length < stmt->rowLen) {
+        return MYSQL_DATA_TRUNCATED;
+    }
+    memcpy(bind->buffer, stmt->row, stmt->rowLen);
+    return 0;
+}
+
+my_bool mysql_stmt_free_result(MYSQL_STMT *stmt) {
+    stmt->hasRow = 0;
+    return 0;
+}
+
+my_bool mysql_stmt_close(MYSQL_STMT *stmt) {
+    free(stmt);
+    return 0;
+}
+
+unsigned int mysql_stmt_errno(MYSQL_STMT *stmt) {
+    return stmt->err;
+}
+
+const char *mysql_stmt_error(MYSQL_STMT *stmt) {
+    switch (stmt->err) {
+        case 0:
+            return "";
+        case CR_SERVER_LOST:
+            return "Lost connection to MySQL server during query";
+        case ER_DUP_ENTRY:
+            return "Duplicate entry";
+        case ER_UNKNOWN_STMT_HANDLER:
+            return "Unknown prepared statement handler";
+        default:
+            return "fake mysql error";
+    }
+}
+
+unsigned int mysql_stmt_field_count(MYSQL_STMT *stmt) {
+    return stmt->kind == 0 ? 1 : 0;
+}
+
+int mysql_stmt_prepare_start(int *ret, MYSQL_STMT *stmt, const char *query, unsigned long) {
+    stmt->kind = strncmp(query, "SELECT", 6) == 0 ? 0 : 1;
+    return start(ret, stmt, OP_PREPARE);
+}
+
+int mysql_stmt_prepare_cont(int *ret, MYSQL_STMT *stmt, int status) {
+    return cont(ret, stmt, OP_PREPARE, status);
+}
+
+int mysql_stmt_execute_start(int *ret, MYSQL_STMT *stmt) {
+    return start(ret, stmt, OP_EXECUTE);
+}
+
+int mysql_stmt_execute_cont(int *ret, MYSQL_STMT *stmt, int status) {
+    return cont(ret, stmt, OP_EXECUTE, status);
+}
+
+int mysql_stmt_store_result_start(int *ret, MYSQL_STMT *) {
+    *ret = 0;  // 结果在 execute 时已经"取回"
+    return 0;
+}
+
+int mysql_stmt_store_result_cont(int *ret, MYSQL_STMT *, int) {
+    *ret = 0;
+    return 0;
+}
+
+}  // extern "C"
@@ -0,0 +1,46 @@
+#ifndef FAKEMYSQL_H
+#define FAKEMYSQL_H
+
+#include <mysql/mysql.h>
+
+#include <string>
+
+/*
+ * 测试用的假 MySQL 客户端库, 代替 libmysqlclient 链接进测试程序, 不需要数据库
+ * 进程内一张 user 表, 只认项目里的两条预编译语句(按用户名查密码、插入用户); 非阻塞接口用 timerfd 模拟等待服务端
+ * 这里的函数控制它的行为并读取计数, 各用例开始时先 reset()
+ */
+namespace fakemysql {
+
+void reset();  // 清空用户表和计数, 各项行为恢复默认
+
+void setDown(bool down);        // 数据库不可达: 建连失败(CR_CONN_HOST_ERROR), ping 和执行返回 CR_SERVER_LOST
+void setDelayMs(int ms);        // 阻塞接口每次执行的耗时; 非阻塞接口每轮等待的时长(至少 1 毫秒)
+void setWaitRounds(int rounds); // 非阻塞接口每个操作要经过几轮 _cont 才完成, 默认 1; 0 为 _start 直接完成
+void setHang(bool hang);        // 非阻塞接口的等待永远不就绪, 只能等到 MYSQL_WAIT_TIMEOUT, 之后报 CR_SERVER_LOST
+void setTimeoutMs(int ms);      // > 0 时非阻塞接口同时要求 MYSQL_WAIT_TIMEOUT, mysql_get_timeout_value_ms 返回它
+void setReconnectEvery(int n);  // 每个连接每 n 次执行模拟一次断线自动重连: 这次返回 CR_SERVER_LOST, 连接的 thread id 变化
+
+/* 模拟客户端自动重连了这个连接: thread id 变化, 之前 prepare 的语句在服务端已失效, 再执行返回 1243 */
+void reconnect(MYSQL *conn);
+
+void addUser(const std::string &name, const std::string &pwd);
+bool hasUser(const std::string &name);
+
+struct Counters {
+    int connects;       // 建连成功
+    int connectErrors;
+    int pings;
+    int pingErrors;
+    int closes;         // mysql_close 已建立的连接
+    int prepares;       // prepare 完成(含失败)
+    int executes;       // 执行完成(含失败)
+    int conts;          // 非阻塞接口 _cont 的调用次数
+    int timeouts;       // 以 MYSQL_WAIT_TIMEOUT 结束的等待
+};
+Counters counters();
+int openConns();  // 已建立未关闭的连接数
+
+}  // namespace fakemysql
+
+#endif  // FAKEMYSQL_H
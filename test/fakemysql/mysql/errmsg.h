@@ -0,0 +1,11 @@
+#ifndef FAKE_ERRMSG_H
+#define FAKE_ERRMSG_H
+
+/* 客户端错误码, 取值与 MySQL/MariaDB 相同 */
+#define CR_MIN_ERROR 2000
+#define CR_MAX_ERROR 2999
+#define CR_CONN_HOST_ERROR 2003
+#define CR_SERVER_GONE_ERROR 2006
+#define CR_SERVER_LOST 2013
+
+#endif /* FAKE_ERRMSG_H */
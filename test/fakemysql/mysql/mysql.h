@@ -0,0 +1,97 @@
+#ifndef FAKE_MYSQL_H
+#define FAKE_MYSQL_H
+
+/*
+ * 测试用的假 MySQL 客户端库头文件, 只声明项目用到的接口, 形状与 MariaDB Connector/C 相同(含非阻塞接口)
+ * 编译测试时用 -I 把它放在系统头文件之前, 实现和控制接口见 ../fakemysql.h
+ */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef char my_bool;
+
+enum mysql_option {
+    MYSQL_OPT_CONNECT_TIMEOUT = 0,
+    MYSQL_OPT_NONBLOCK = 6000,
+};
+
+enum enum_field_types {
+    MYSQL_TYPE_STRING = 254,
+};
+
+typedef struct st_mysql {
+    int fd;              /* timerfd, 非阻塞接口等待"服务端回复"用 */
+    unsigned long tid;   /* 服务端线程 id, 模拟重连时变化 */
+    unsigned int err;
+    int execs;
+} MYSQL;
+
+typedef struct st_mysql_bind {
+    unsigned long *length;
+    my_bool *is_null;
+    void *buffer;
+    my_bool *error;
+    enum enum_field_types buffer_type;
+    unsigned long buffer_length;
+} MYSQL_BIND;
+
+typedef struct st_mysql_stmt {
+    MYSQL *mysql;
+    int kind;            /* 0 SELECT, 1 INSERT */
+    unsigned long tid;   /* prepare 时连接的线程 id */
+    MYSQL_BIND *param;
+    MYSQL_BIND *result;
+    int hasRow;
+    char row[256];
+    unsigned long rowLen;
+    unsigned int err;
+    int pending;         /* 非阻塞接口还要等待的轮数 */
+} MYSQL_STMT;
+
+#define MYSQL_WAIT_READ 1
+#define MYSQL_WAIT_WRITE 2
+#define MYSQL_WAIT_EXCEPT 4
+#define MYSQL_WAIT_TIMEOUT 8
+
+#define MYSQL_NO_DATA 100
+#define MYSQL_DATA_TRUNCATED 101
+
+MYSQL *mysql_init(MYSQL *mysql);
+int mysql_options(MYSQL *mysql, enum mysql_option option, const void *arg);
+MYSQL *mysql_real_connect(MYSQL *mysql, const char *host, const char *user, const char *passwd, const char *db,
+                          unsigned int port, const char *unixSocket, unsigned long clientFlag);
+void mysql_close(MYSQL *mysql);
+int mysql_ping(MYSQL *mysql);
+unsigned int mysql_errno(MYSQL *mysql);
+const char *mysql_error(MYSQL *mysql);
+unsigned long mysql_thread_id(MYSQL *mysql);
+void mysql_library_end(void);
+int mysql_get_socket(const MYSQL *mysql);
+unsigned int mysql_get_timeout_value_ms(const MYSQL *mysql);
+
+MYSQL_STMT *mysql_stmt_init(MYSQL *mysql);
+int mysql_stmt_prepare(MYSQL_STMT *stmt, const char *query, unsigned long length);
+my_bool mysql_stmt_bind_param(MYSQL_STMT *stmt, MYSQL_BIND *bind);
+my_bool mysql_stmt_bind_result(MYSQL_STMT *stmt, MYSQL_BIND *bind);
+int mysql_stmt_execute(MYSQL_STMT *stmt);
+int mysql_stmt_store_result(MYSQL_STMT *stmt);
+int mysql_stmt_fetch(MYSQL_STMT *stmt);
+my_bool mysql_stmt_free_result(MYSQL_STMT *stmt);
+my_bool mysql_stmt_close(MYSQL_STMT *stmt);
+unsigned int mysql_stmt_errno(MYSQL_STMT *stmt);
+const char *mysql_stmt_error(MYSQL_STMT *stmt);
+unsigned int mysql_stmt_field_count(MYSQL_STMT *stmt);
+
+int mysql_stmt_prepare_start(int *ret, MYSQL_STMT *stmt, const char *query, unsigned long length);
+int mysql_stmt_prepare_cont(int *ret, MYSQL_STMT *stmt, int status);
+int mysql_stmt_execute_start(int *ret, MYSQL_STMT *stmt);
+int mysql_stmt_execute_cont(int *ret, MYSQL_STMT *stmt, int status);
+int mysql_stmt_store_result_start(int *ret, MYSQL_STMT *stmt);
+int mysql_stmt_store_result_cont(int *ret, MYSQL_STMT *stmt, int status);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FAKE_MYSQL_H */
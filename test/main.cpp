@@ -0,0 +1,51 @@
+#include <cstring>
+
+#include "test.h"
+
+int test::failures = 0;
+
+/* 用法: test [名字...], 不带参数时依次运行全部 */
+namespace {
+struct Entry {
+    const char *name;
+    void (*run)();
+    const char *desc;
+};
+
+const Entry TESTS[] = {
+    {"sqlconnpool", testSqlConnPool, "SqlConnPool growth, wait timeout, connect backoff, ping recovery, idle trimming"},
+    {"asyncsql", testAsyncSql, "AsyncSql _start/_cont rounds on a Reactor, wait timeout, statement errors, waiting for a connection"},
+    {"stmtcache", testStmtCache, "prepared statements re-prepared after a reconnect, stale statement errors"},
+    {"usercache", testUserCache, "UserCache TTL, negative entries, invalidation racing a lookup"},
+};
+}  // namespace
+
+int main(int argc, char *argv[]) {
+    for (int i = 1; i < argc; i++) {
+        bool known = false;
+        for (const Entry &entry : TESTS) {
+            known = known || strcmp(argv[i], entry.name) == 0;
+        }
+        if (!known) {
+            fprintf(stderr, "unknown test: %s\n", argv[i]);
+            return 1;
+        }
+    }
+    for (const Entry &entry : TESTS) {
+        bool selected = argc <= 1;
+        for (int i = 1; i < argc && !selected; i++) {
+            selected = strcmp(argv[i], entry.name) == 0;
+        }
+        if (selected) {
+            int before = test::failures;
+            entry.run();
+            printf("%-12s %s  %s\n", entry.name, test::failures == before ? "ok  " : "FAIL", entry.desc);
+            fflush(stdout);
+        }
+    }
+    if (test::failures) {
+        printf("%d check(s) failed\n", test::failures);
+        return 1;
+    }
+    return 0;
+}
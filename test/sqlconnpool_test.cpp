@@ -0,0 +1,163 @@
+#include <vector>
+
+#include "../sqlconnpool/sqlconnpool.h"
+#include "../userstore/mysqluserstore.h"
+#include "fakemysql/fakemysql.h"
+#include "test.h"
+
+namespace {
+
+/* 后台线程的时间都调到几十毫秒, 每个用例重新 init, 结束时 close */
+SqlConnPool *initPool(int maxConn, int minConn, int waitTimeoutMs, SqlConnPool::Timing timing = SqlConnPool::Timing()) {
+    timing.keeperTick = 10;
+    SqlConnPool *pool = SqlConnPool::instance();
+    pool->setTiming(timing);
+    pool->init("localhost", 3306, "root", "root", "webserver", maxConn, minConn, waitTimeoutMs);
+    return pool;
+}
+
+/* 有人等待时从 minConn 扩到 maxConn, 到上限后取连接超时返回 nullptr, 空闲久了缩回 minConn */
+void growAndTrim() {
+    fakemysql::reset();
+    SqlConnPool::Timing timing;
+    timing.idleTimeout = 100;
+    SqlConnPool *pool = initPool(4, 1, 1000, timing);
+    CHECK(pool->stats().total == 1);
+    CHECK(fakemysql::counters().connects == 1);
+
+    std::vector<MYSQL *> conns;
+    for (int i = 0; i < 4; i++) {
+        conns.push_back(pool->getConn());
+        CHECK(conns.back() != nullptr);
+    }
+    SqlConnPool::Stats st = pool->stats();
+    CHECK(st.total == 4);
+    CHECK(st.inUse == 4);
+    CHECK(st.acquired == 4);
+    CHECK(st.waited == 3);  // 第一个取的是空闲连接, 其余等后台线程新建
+    CHECK(fakemysql::counters().connects == 4);
+
+    // 已到上限: 等满时限后返回 nullptr, 不再建连
+    uint64_t start = test::nowMs();
+    CHECK(pool->getConn(50) == nullptr);
+    CHECK(test::nowMs() - start >= 50);
+    st = pool->stats();
+    CHECK(st.timeouts == 1);
+    CHECK(st.total == 4);
+    CHECK(st.waiting == 0);
+    CHECK(fakemysql::counters().connects == 4);
+
+    for (MYSQL *conn : conns) {
+        pool->freeConn(conn);
+    }
+    CHECK(pool->stats().idle == 4);
+    // 空闲超过 idleTimeout 后只留 minConn 个
+    CHECK(test::waitUntil([pool] { return pool->stats().total == 1; }, 1000));
+    st = pool->stats();
+    CHECK(st.trimmed == 3);
+    CHECK(st.idle == 1);
+    CHECK(fakemysql::openConns() == 1);
+
+    pool->close();
+    CHECK(fakemysql::openConns() == 0);
+}
+
+/* 连接池耗尽时用户存储按不可用返回(回 503), 有连接后照常查到用户 */
+void exhaustedIsUnavailable() {
+    fakemysql::reset();
+    fakemysql::addUser("alice", "secret");
+    SqlConnPool *pool = initPool(1, 1, 50);
+    MysqlUserStore store;
+    std::string pwd;
+
+    MYSQL *held = pool->getConn();
+    CHECK(held != nullptr);
+    CHECK(store.find("alice", &pwd) == UserStore::UNAVAILABLE);
+    CHECK(store.add("bob", "pwd") == HttpRequest::AUTH_UNAVAILABLE);
+    CHECK(pool->stats().timeouts == 2);
+    pool->freeConn(held);
+
+    CHECK(store.find("alice", &pwd) == UserStore::FOUND);
+    CHECK(pwd == "secret");
+    CHECK(store.find("bob", &pwd) == UserStore::NOT_FOUND);
+    CHECK(store.add("bob", "pwd") == HttpRequest::AUTH_OK);
+    CHECK(store.add("bob", "pwd") == HttpRequest::AUTH_FAIL);  // 重复的用户名是注册失败, 连接没坏
+    CHECK(pool->stats().broken == 0);
+    pool->close();
+}
+
+/* 数据库连不上时照常启动, 之后每隔 retryInterval 才重试一次, 恢复后补足连接 */
+void connectBackoff() {
+    fakemysql::reset();
+    fakemysql::setDown(true);
+    SqlConnPool::Timing timing;
+    timing.retryInterval = 200;
+    uint64_t start = test::nowMs();
+    SqlConnPool *pool = initPool(2, 1, 1000, timing);
+    SqlConnPool::Stats st = pool->stats();
+    CHECK(st.total == 0);
+    CHECK(st.connectErrors == 1);
+
+    // 退避期间等待者超时, 后台线程不重试
+    CHECK(pool->getConn(50) == nullptr);
+    CHECK(pool->stats().timeouts == 1);
+    CHECK(fakemysql::counters().connectErrors == 1);
+
+    // 到期后重试仍失败, 再退避
+    CHECK(test::waitUntil([] { return fakemysql::counters().connectErrors == 2; }, 1000));
+    CHECK(test::nowMs() - start >= 200);
+    CHECK(pool->stats().connectErrors == 2);
+
+    fakemysql::setDown(false);
+    MYSQL *conn = pool->getConn();
+    CHECK(conn != nullptr);
+    CHECK(test::nowMs() - start >= 400);
+    CHECK(fakemysql::counters().connectErrors == 2);
+    if (conn) {
+        pool->freeConn(conn);
+    }
+    pool->close();
+}
+
+/* 空闲连接定期 ping, 不通时关掉重建; 建不上时退避, 数据库恢复后补回 minConn; 使用中坏掉的连接也会补建 */
+void pingRecovery() {
+    fakemysql::reset();
+    SqlConnPool::Timing timing;
+    timing.pingInterval = 30;
+    timing.retryInterval = 50;
+    SqlConnPool *pool = initPool(2, 2, 1000, timing);
+    CHECK(pool->stats().total == 2);
+    CHECK(test::waitUntil([] { return fakemysql::counters().pings >= 2; }, 1000));
+    CHECK(pool->stats().pingFailures == 0);
+
+    fakemysql::setDown(true);
+    CHECK(test::waitUntil([pool] { return pool->stats().pingFailures >= 1; }, 1000));
+    CHECK(pool->stats().connectErrors >= 1);  // 断开后的重建也失败
+    CHECK(pool->stats().total < 2);
+
+    fakemysql::setDown(false);
+    CHECK(test::waitUntil([pool] {
+        SqlConnPool::Stats st = pool->stats();
+        return st.total == 2 && st.idle == 2;
+    }, 1000));
+    MYSQL *conn = pool->getConn();
+    CHECK(conn != nullptr);
+    CHECK(conn && mysql_ping(conn) == 0);
+
+    int connects = fakemysql::counters().connects;
+    pool->freeConn(conn, true);
+    CHECK(pool->stats().broken == 1);
+    CHECK(test::waitUntil([pool] { return pool->stats().idle == 2; }, 1000));
+    CHECK(fakemysql::counters().connects == connects + 1);
+    pool->close();
+    CHECK(fakemysql::openConns() == 0);
+}
+
+}  // namespace
+
+void testSqlConnPool() {
+    growAndTrim();
+    exhaustedIsUnavailable();
+    connectBackoff();
+    pingRecovery();
+}
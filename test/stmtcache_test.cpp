@@ -0,0 +1,112 @@
+#include <string>
+
+#include "../sqlconnpool/sqlconnpool.h"
+#include "../sqlconnpool/userstmt.h"
+#include "../userstore/mysqluserstore.h"
+#include "fakemysql/fakemysql.h"
+#include "test.h"
+
+namespace {
+
+SqlConnPool *initPool() {
+    SqlConnPool::Timing timing;
+    timing.keeperTick = 10;
+    SqlConnPool *pool = SqlConnPool::instance();
+    pool->setTiming(timing);
+    pool->init("localhost", 3306, "root", "root", "webserver", 1, 1, 1000);
+    return pool;
+}
+
+/* 连接自动重连后(mysql_thread_id 变化)缓存的语句作废, 下次使用时重新 prepare, 阻塞和协程版本都一样 */
+void reprepareAfterReconnect(test::ReactorThread *rt) {
+    fakemysql::reset();
+    fakemysql::addUser("alice", "secret");
+    SqlConnPool *pool = initPool();
+    MysqlUserStore store;
+    std::string pwd;
+
+    CHECK(store.find("alice", &pwd) == UserStore::FOUND);
+    CHECK(store.find("alice", &pwd) == UserStore::FOUND);
+    CHECK(fakemysql::counters().prepares == 1);  // 第二次用的是缓存
+
+    MYSQL *conn = pool->getConn();
+    CHECK(conn != nullptr);
+    MYSQL_STMT *old = pool->cachedStmt(conn, SqlConnPool::STMT_SELECT_USER);
+    CHECK(old != nullptr);
+    fakemysql::reconnect(conn);
+    CHECK(pool->cachedStmt(conn, SqlConnPool::STMT_SELECT_USER) == nullptr);
+    MYSQL_STMT *stmt = pool->getStmt(conn, SqlConnPool::STMT_SELECT_USER);
+    CHECK(stmt != nullptr);
+    CHECK(fakemysql::counters().prepares == 2);
+    CHECK(pool->cachedStmt(conn, SqlConnPool::STMT_SELECT_USER) == stmt);
+    pool->freeConn(conn);
+    CHECK(store.find("alice", &pwd) == UserStore::FOUND);
+
+    // 协程版本经 AsyncSql::prepare 走同一份缓存
+    conn = pool->getConn();
+    fakemysql::reconnect(conn);
+    pool->freeConn(conn);
+    UserStore::FIND_RESULT found = UserStore::UNAVAILABLE;
+    CHECK(rt->run([&]() -> Task<void> {
+        found = co_await store.findAsync(rt->get(), nullptr, "alice", &pwd);
+    }));
+    CHECK(found == UserStore::FOUND);
+    CHECK(pwd == "secret");
+    CHECK(fakemysql::counters().prepares == 3);
+    CHECK(fakemysql::counters().executes == 4);
+    CHECK(pool->stats().broken == 0);
+    pool->close();
+}
+
+/* 执行已失效的语句: 服务端返回语句错误, 连接没坏, onStmtError 丢掉缓存, 之后重新 prepare */
+void staleStmtError() {
+    fakemysql::reset();
+    fakemysql::addUser("alice", "secret");
+    SqlConnPool *pool = initPool();
+
+    MYSQL *conn = pool->getConn();
+    MYSQL_STMT *stmt = pool->getStmt(conn, SqlConnPool::STMT_SELECT_USER);
+    CHECK(stmt != nullptr);
+    fakemysql::reconnect(conn);
+    UserStmt user("alice");
+    CHECK(user.bindSelect(stmt));
+    CHECK(mysql_stmt_execute(stmt) != 0);
+    CHECK(!SqlConnPool::isConnError(mysql_stmt_errno(stmt)));
+    CHECK(!pool->onStmtError(conn, stmt));
+    CHECK(pool->cachedStmt(conn, SqlConnPool::STMT_SELECT_USER) == nullptr);
+    pool->freeConn(conn);
+
+    MysqlUserStore store;
+    std::string pwd;
+    CHECK(store.find("alice", &pwd) == UserStore::FOUND);
+    CHECK(fakemysql::counters().prepares == 2);
+    CHECK(pool->stats().broken == 0);
+    pool->close();
+}
+
+/* 执行中断线(CR_SERVER_LOST)是连接错误: 这次按不可用返回, 连接关掉重建, 新连接从空缓存开始 */
+void lostDuringExecute() {
+    fakemysql::reset();
+    fakemysql::addUser("alice", "secret");
+    fakemysql::setReconnectEvery(2);
+    SqlConnPool *pool = initPool();
+    MysqlUserStore store;
+    std::string pwd;
+
+    CHECK(store.find("alice", &pwd) == UserStore::FOUND);
+    CHECK(store.find("alice", &pwd) == UserStore::UNAVAILABLE);
+    CHECK(pool->stats().broken == 1);
+    CHECK(store.find("alice", &pwd) == UserStore::FOUND);
+    CHECK(fakemysql::counters().connects == 2);
+    CHECK(fakemysql::counters().prepares == 2);
+    pool->close();
+}
+
+}  // namespace
+
+void testStmtCache() {
+    test::ReactorThread rt;
+    reprepareAfterReconnect(&rt);
+    staleStmtError();
+    lostDuringExecute();
+}
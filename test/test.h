@@ -0,0 +1,103 @@
+#ifndef TEST_H
+#define TEST_H
+
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <future>
+#include <memory>
+#include <thread>
+
+#include "../coroutine/task.h"
+#include "../webserver/reactor.h"
+
+/*
+ * 单元测试, 每项一个函数, 在 main.cpp 的表里登记; CHECK 失败时打印位置并计数, 不中断, 有失败时进程返回 1
+ * 数据库客户端链接的是 fakemysql/ 下的假实现, 不需要 MySQL
+ */
+namespace test {
+
+extern int failures;
+
+#define CHECK(cond)                                                                  \
+    do {                                                                             \
+        if (!(cond)) {                                                               \
+            fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond); \
+            test::failures++;                                                        \
+        }                                                                            \
+    } while (0)
+
+inline uint64_t nowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/* 每毫秒检查一次, 条件在 timeoutMs 内成立返回 true; 等后台线程的结果用 */
+inline bool waitUntil(const std::function<bool()> &cond, int timeoutMs) {
+    uint64_t deadline = nowMs() + timeoutMs;
+    while (!cond()) {
+        if (nowMs() >= deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+/*
+ * 在单独线程上运行的 Reactor, 用来驱动协程; 监听 fd 是一个不会就绪的 eventfd, 不接受连接
+ * run() 把协程放到 Reactor 线程上执行并等它结束, 协程帧里的局部变量在调用方看来是同步的
+ */
+class ReactorThread {
+public:
+    ReactorThread()
+        : dummyFd_(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)),
+          reactor_(dummyFd_, EPOLLRDHUP, EPOLLONESHOT | EPOLLRDHUP, ConnLimits(), nullptr, nullptr, false),
+          thread_([this] { reactor_.loop(); }) {
+    }
+    ~ReactorThread() {
+        reactor_.stop();
+        thread_.join();
+        close(dummyFd_);
+    }
+
+    Reactor *get() { return &reactor_; }
+
+    /* timeoutMs 内没有结束返回 false, 此时协程帧还挂在 Reactor 上, body 引用的变量不能释放 */
+    bool run(std::function<Task<void>()> body, int timeoutMs = 5000) {
+        auto done = std::make_shared<std::promise<void>>();
+        std::future<void> finished = done->get_future();
+        spawn(runOn_(&reactor_, std::move(body), done));
+        return finished.wait_for(std::chrono::milliseconds(timeoutMs)) == std::future_status::ready;
+    }
+
+private:
+    struct PostAwaiter {
+        Reactor *reactor;
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> h) { reactor->post(h); }
+        void await_resume() const noexcept {}
+    };
+
+    static Task<void> runOn_(Reactor *reactor, std::function<Task<void>()> body, std::shared_ptr<std::promise<void>> done) {
+        co_await PostAwaiter{reactor};
+        co_await body();
+        done->set_value();
+    }
+
+    int dummyFd_;
+    Reactor reactor_;
+    std::thread thread_;
+};
+
+}  // namespace test
+
+void testSqlConnPool();
+void testAsyncSql();
+void testStmtCache();
+void testUserCache();
+
+#endif  // TEST_H
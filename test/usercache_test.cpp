@@ -0,0 +1,112 @@
+#include <string>
+
+#include "../sqlconnpool/sqlconnpool.h"
+#include "../usercache/usercache.h"
+#include "../userstore/mysqluserstore.h"
+#include "fakemysql/fakemysql.h"
+#include "test.h"
+
+namespace {
+
+void sleepMs(int ms) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+/* 存在的用户按 ttl 过期, 不存在的按更短的 negativeTtl 过期; 各用例用不同的用户名, 单例里的旧条目互不影响 */
+void ttl() {
+    UserCache *cache = UserCache::instance();
+    cache->init(150, 40);
+    uint64_t version;
+
+    CHECK(cache->lookup("ttl-user", "pwd", &version) == UserCache::MISS);
+    cache->putUser("ttl-user", "pwd", version);
+    CHECK(cache->lookup("ttl-user", "pwd", &version) == UserCache::MATCH);
+    CHECK(cache->lookup("ttl-user", "other", &version) == UserCache::MISMATCH);
+
+    CHECK(cache->lookup("ttl-nobody", "pwd", &version) == UserCache::MISS);
+    cache->putNoUser("ttl-nobody", version);
+    CHECK(cache->lookup("ttl-nobody", "pwd", &version) == UserCache::NO_USER);
+
+    sleepMs(80);  // 负缓存已过期, 正缓存还在
+    CHECK(cache->lookup("ttl-nobody", "pwd", &version) == UserCache::MISS);
+    CHECK(cache->lookup("ttl-user", "pwd", &version) == UserCache::MATCH);
+
+    sleepMs(100);
+    CHECK(cache->lookup("ttl-user", "pwd", &version) == UserCache::MISS);
+
+    // ttl 为 0 时什么都不缓存, negativeTtl 为 0 时只不缓存不存在的用户
+    cache->init(0, 40);
+    CHECK(cache->lookup("off-user", "pwd", &version) == UserCache::MISS);
+    cache->putUser("off-user", "pwd", version);
+    cache->putNoUser("off-nobody", version);
+    CHECK(cache->lookup("off-user", "pwd", &version) == UserCache::MISS);
+    CHECK(cache->lookup("off-nobody", "pwd", &version) == UserCache::MISS);
+    cache->init(150, 0);
+    CHECK(cache->lookup("off-nobody", "pwd", &version) == UserCache::MISS);
+    cache->putNoUser("off-nobody", version);
+    CHECK(cache->lookup("off-nobody", "pwd", &version) == UserCache::MISS);
+}
+
+/* 负缓存只对登录下结论, 注册仍要写库; 查库期间被失效的结果不写入 */
+void negative() {
+    UserCache *cache = UserCache::instance();
+    cache->init(1000, 1000);
+    bool ok = true;
+    CHECK(UserCache::decided(UserCache::NO_USER, true, &ok));
+    CHECK(!ok);
+    CHECK(!UserCache::decided(UserCache::NO_USER, false, &ok));
+    CHECK(!UserCache::decided(UserCache::MISS, true, &ok));
+    CHECK(UserCache::decided(UserCache::MATCH, false, &ok));  // 注册已存在的用户名
+    CHECK(!ok);
+    CHECK(UserCache::decided(UserCache::MATCH, true, &ok));
+    CHECK(ok);
+
+    uint64_t version;
+    CHECK(cache->lookup("neg-race", "pwd", &version) == UserCache::MISS);
+    cache->invalidate("neg-race");  // 查库期间有人注册了这个用户名
+    cache->putNoUser("neg-race", version);
+    CHECK(cache->lookup("neg-race", "pwd", &version) == UserCache::MISS);
+
+    cache->putNoUser("neg-race", version);
+    CHECK(cache->lookup("neg-race", "pwd", &version) == UserCache::NO_USER);
+    cache->invalidate("neg-race");
+    CHECK(cache->lookup("neg-race", "pwd", &version) == UserCache::MISS);
+}
+
+/* 经过 UserStore 校验: 缓存命中时不访问数据库, 注册后丢掉负缓存 */
+void throughStore() {
+    fakemysql::reset();
+    fakemysql::addUser("store-alice", "secret");
+    UserCache::instance()->init(1000, 1000);
+    SqlConnPool::Timing timing;
+    timing.keeperTick = 10;
+    SqlConnPool *pool = SqlConnPool::instance();
+    pool->setTiming(timing);
+    pool->init("localhost", 3306, "root", "root", "webserver", 1, 1, 1000);
+    MysqlUserStore store;
+
+    CHECK(store.verify("store-alice", "secret", true) == HttpRequest::AUTH_OK);
+    CHECK(store.verify("store-alice", "secret", true) == HttpRequest::AUTH_OK);
+    CHECK(store.verify("store-alice", "wrong", true) == HttpRequest::AUTH_FAIL);
+    CHECK(store.verify("store-alice", "secret", false) == HttpRequest::AUTH_FAIL);  // 用户名已被使用
+    CHECK(fakemysql::counters().executes == 1);
+
+    CHECK(store.verify("store-bob", "pwd", true) == HttpRequest::AUTH_FAIL);
+    CHECK(store.verify("store-bob", "pwd", true) == HttpRequest::AUTH_FAIL);
+    CHECK(fakemysql::counters().executes == 2);  // 第二次由负缓存回答
+
+    CHECK(store.verify("store-bob", "pwd", false) == HttpRequest::AUTH_OK);  // 负缓存不挡注册
+    CHECK(fakemysql::hasUser("store-bob"));
+    CHECK(fakemysql::counters().executes == 4);  // 先查再插入
+    CHECK(store.verify("store-bob", "pwd", true) == HttpRequest::AUTH_OK);
+    CHECK(fakemysql::counters().executes == 5);  // 注册后失效, 重新查库
+    pool->close();
+}
+
+}  // namespace
+
+void testUserCache() {
+    ttl();
+    negative();
+    throughStore();
+}
@@ -0,0 +1,94 @@
+#ifndef INPLACE_FUNCTION_H
+#define INPLACE_FUNCTION_H
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+template <typename Signature, size_t Capacity = 48>
+class InplaceFunction;
+
+/*
+ * 只能移动的 std::function 替代品, 可调用对象直接放在对象内部的 Capacity 字节里
+ * 不会退回到堆上分配: 捕获超出容量在编译期报错
+ */
+template <typename R, typename... Args, size_t Capacity>
+class InplaceFunction<R(Args...), Capacity> {
+public:
+    InplaceFunction() noexcept : ops_(nullptr) {}
+
+    template <typename F, typename = std::enable_if_t<!std::is_same<std::decay_t<F>, InplaceFunction>::value>>
+    InplaceFunction(F &&f) {  // 与 std::function 一样允许隐式转换
+        using Fn = std::decay_t<F>;
+        static_assert(sizeof(Fn) <= Capacity, "callable too large for InplaceFunction, capture less or raise Capacity");
+        static_assert(alignof(Fn) <= alignof(std::max_align_t), "over-aligned callable");
+        static_assert(std::is_nothrow_move_constructible<Fn>::value, "callable must be nothrow movable");
+        ::new (static_cast<void *>(storage_)) Fn(std::forward<F>(f));
+        ops_ = &OpsFor<Fn>::OPS;
+    }
+
+    InplaceFunction(InplaceFunction &&other) noexcept : ops_(other.ops_) {
+        if (ops_) {
+            ops_->move(storage_, other.storage_);
+            other.ops_ = nullptr;
+        }
+    }
+
+    InplaceFunction &operator=(InplaceFunction &&other) noexcept {
+        if (this != &other) {
+            reset();
+            ops_ = other.ops_;
+            if (ops_) {
+                ops_->move(storage_, other.storage_);
+                other.ops_ = nullptr;
+            }
+        }
+        return *this;
+    }
+
+    InplaceFunction(const InplaceFunction &) = delete;
+    InplaceFunction &operator=(const InplaceFunction &) = delete;
+
+    ~InplaceFunction() { reset(); }
+
+    void reset() noexcept {
+        if (ops_) {
+            ops_->destroy(storage_);
+            ops_ = nullptr;
+        }
+    }
+
+    explicit operator bool() const noexcept { return ops_ != nullptr; }
+
+    R operator()(Args... args) {
+        return ops_->invoke(storage_, std::forward<Args>(args)...);
+    }
+
+private:
+    struct Ops {
+        R (*invoke)(void *self, Args &&...args);
+        void (*move)(void *dst, void *src);  // 移动构造到 dst 并析构 src
+        void (*destroy)(void *self);
+    };
+
+    template <typename Fn>
+    struct OpsFor {
+        static R invoke(void *self, Args &&...args) {
+            return (*static_cast<Fn *>(self))(std::forward<Args>(args)...);
+        }
+        static void move(void *dst, void *src) {
+            ::new (dst) Fn(std::move(*static_cast<Fn *>(src)));
+            static_cast<Fn *>(src)->~Fn();
+        }
+        static void destroy(void *self) {
+            static_cast<Fn *>(self)->~Fn();
+        }
+        static constexpr Ops OPS = {&invoke, &move, &destroy};
+    };
+
+    alignas(std::max_align_t) unsigned char storage_[Capacity];
+    const Ops *ops_;
+};
+
+#endif  // INPLACE_FUNCTION_H
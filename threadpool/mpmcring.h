@@ -0,0 +1,125 @@
+#ifndef MPMC_RING_H
+#define MPMC_RING_H
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <utility>
+
+/*
+ * 有界无锁多生产者多消费者环形队列 (Dmitry Vyukov 的算法)
+ * 每个格子带一个序号, 生产者和消费者各自 CAS 推进位置, 元素原地构造, 不分配内存
+ * 满时 tryPush 返回 false, 由调用方决定怎么处理(背压)
+ */
+template <typename T>
+class MpmcRing {
+public:
+    explicit MpmcRing(size_t capacity);
+    ~MpmcRing();
+    MpmcRing(const MpmcRing &) = delete;
+    MpmcRing &operator=(const MpmcRing &) = delete;
+
+    bool tryPush(T &&item);
+    bool tryPop(T &item);
+
+    size_t size() const;  // 并发下只是近似值
+    bool empty() const;
+    size_t capacity() const;
+
+private:
+    struct Cell {
+        std::atomic<size_t> seq;
+        alignas(T) unsigned char storage[sizeof(T)];
+
+        T *item() { return reinterpret_cast<T *>(storage); }
+    };
+
+    const size_t mask_;
+    std::unique_ptr<Cell[]> cells_;
+    alignas(64) std::atomic<size_t> enqueuePos_;
+    alignas(64) std::atomic<size_t> dequeuePos_;
+};
+
+template <typename T>
+MpmcRing<T>::MpmcRing(size_t capacity) : mask_(capacity - 1), cells_(new Cell[capacity]), enqueuePos_(0), dequeuePos_(0) {
+    assert(capacity >= 2 && (capacity & (capacity - 1)) == 0);
+    for (size_t i = 0; i < capacity; i++) {
+        cells_[i].seq.store(i, std::memory_order_relaxed);
+    }
+}
+
+template <typename T>
+MpmcRing<T>::~MpmcRing() {
+    T item;
+    while (tryPop(item)) {
+    }
+}
+
+template <typename T>
+bool MpmcRing<T>::tryPush(T &&item) {
+    size_t pos = enqueuePos_.load(std::memory_order_relaxed);
+    Cell *cell;
+    for (;;) {
+        cell = &cells_[pos & mask_];
+        size_t seq = cell->seq.load(std::memory_order_acquire);
+        intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+        if (diff == 0) {
+            if (enqueuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return false;  // 满了
+        } else {
+            pos = enqueuePos_.load(std::memory_order_relaxed);
+        }
+    }
+    ::new (cell->storage) T(std::move(item));
+    cell->seq.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+template <typename T>
+bool MpmcRing<T>::tryPop(T &item) {
+    size_t pos = dequeuePos_.load(std::memory_order_relaxed);
+    Cell *cell;
+    for (;;) {
+        cell = &cells_[pos & mask_];
+        size_t seq = cell->seq.load(std::memory_order_acquire);
+        intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+        if (diff == 0) {
+            if (dequeuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return false;  // 空了, 或者生产者还没写完
+        } else {
+            pos = dequeuePos_.load(std::memory_order_relaxed);
+        }
+    }
+    item = std::move(*cell->item());
+    cell->item()->~T();
+    cell->seq.store(pos + mask_ + 1, std::memory_order_release);
+    return true;
+}
+
+template <typename T>
+size_t MpmcRing<T>::size() const {
+    size_t enq = enqueuePos_.load(std::memory_order_seq_cst);
+    size_t deq = dequeuePos_.load(std::memory_order_seq_cst);
+    return enq > deq ? enq - deq : 0;
+}
+
+template <typename T>
+bool MpmcRing<T>::empty() const {
+    return size() == 0;
+}
+
+template <typename T>
+size_t MpmcRing<T>::capacity() const {
+    return mask_ + 1;
+}
+
+#endif  // MPMC_RING_H
@@ -1,25 +1,20 @@
 #include "threadpool.h"
 
-ThreadPool::ThreadPool(size_t threadNum) : pool_(std::make_shared<Pool>()) {
+namespace {
+/* 当前线程所属的线程池和下标, 工作线程提交任务时直接放进自己的队列 */
+thread_local const void *tlsPool = nullptr;
+thread_local size_t tlsId = 0;
+}  // namespace
+
+ThreadPool::ThreadPool(size_t threadNum, size_t queueCapacity, const std::vector<int> &cpus) : pool_(std::make_shared<Pool>(queueCapacity)) {
     assert(threadNum > 0);
     for (size_t i = 0; i < threadNum; i++) {
-        std::thread([pool = pool_]() {
-                std::unique_lock<std::mutex> locker(pool->mtx);
-                while (!pool->isClose)
-                {
-                    if (!pool->tasks.empty())
-                    {
-                        auto task = std::move(pool->tasks.front());
-                        pool->tasks.pop();
-                        locker.unlock();
-                        task();
-                        locker.lock();
-                    }
-                    else
-                    {
-                        pool->cond.wait(locker);
-                    }
-                } }).detach();
+        pool_->locals.emplace_back(new MpmcRing<Task>(LOCAL_CAPACITY));
+    }
+    pool_->workerStats.reset(new WorkerStat[threadNum]);
+    // 队列都建好之后再启动线程, 窃取时会遍历 locals
+    for (size_t i = 0; i < threadNum; i++) {
+        std::thread(run_, pool_, i, cpus.empty() ? -1 : cpus[i % cpus.size()]).detach();
     }
 }
 
@@ -32,3 +27,136 @@ ThreadPool::~ThreadPool() {
         pool_->cond.notify_all();
     }
 }
+
+ThreadPool::Stats ThreadPool::stats() const {
+    Stats st = {};
+    if (!pool_) {
+        return st;
+    }
+    Pool *pool = pool_.get();
+    st.threads = pool->locals.size();
+    st.queued = pool->inject.size();
+    for (auto &local : pool->locals) {
+        st.queued += local->size();
+    }
+    st.capacity = pool->inject.capacity();
+    st.submitted = pool->submitted.load(std::memory_order_relaxed);
+    st.rejected = pool->rejected.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < st.threads; i++) {
+        st.busy += pool->workerStats[i].busy.load(std::memory_order_relaxed);
+        st.completed += pool->workerStats[i].completed.load(std::memory_order_relaxed);
+    }
+    return st;
+}
+
+bool ThreadPool::push_(Task &&task) {
+    Pool *pool = pool_.get();
+    // tryPush 失败时不会移走 task, 可以接着试下一个队列
+    bool pushed = tlsPool == pool && pool->locals[tlsId]->tryPush(std::move(task));
+    if (!pushed && !pool->inject.tryPush(std::move(task))) {
+        pool->rejected.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    pool->submitted.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);  // 与 park_ 配对, 见那里的说明
+    wakeOne_(pool);
+    return true;
+}
+
+void ThreadPool::run_(std::shared_ptr<Pool> pool, size_t id, int cpu) {
+    CpuAffinity::pinThread(cpu);
+    tlsPool = pool.get();
+    tlsId = id;
+    uint32_t seed = static_cast<uint32_t>(id) * 2654435761u + 1;
+    Task task;
+    while (!pool->isClose) {
+        bool found = next_(pool.get(), id, &seed, &task);
+        for (int i = 0; !found && i < SPIN_ROUNDS && !pool->isClose; i++) {
+            std::this_thread::yield();
+            found = next_(pool.get(), id, &seed, &task);
+        }
+        if (found) {
+            WorkerStat &stat = pool->workerStats[id];
+            stat.busy.store(true, std::memory_order_relaxed);
+            task();
+            task.reset();
+            stat.busy.store(false, std::memory_order_relaxed);
+            stat.completed.store(stat.completed.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        } else {
+            park_(pool.get());
+        }
+    }
+}
+
+bool ThreadPool::next_(Pool *pool, size_t id, uint32_t *seed, Task *task) {
+    MpmcRing<Task> &local = *pool->locals[id];
+    if (local.tryPop(*task)) {
+        return true;
+    }
+    /*
+     * 注入队列: 按线程数均分的份额(不超过 INJECT_BATCH)搬到本地队列, 其余线程从这里窃取, 不必都去争注入队列
+     * 本地队列放不下(窃取者还没让出格子)时直接执行手上这个
+     */
+    size_t n = pool->locals.size();
+    size_t share = pool->inject.size() / n;
+    size_t batch = 1 + (share < INJECT_BATCH ? share : INJECT_BATCH);
+    for (size_t i = 0; i < batch && pool->inject.tryPop(*task); i++) {
+        if (!local.tryPush(std::move(*task))) {
+            return true;
+        }
+    }
+    if (local.tryPop(*task)) {
+        return true;
+    }
+    /* 从随机位置开始依次尝试窃取 */
+    *seed ^= *seed << 13;
+    *seed ^= *seed >> 17;
+    *seed ^= *seed << 5;
+    size_t start = *seed % n;
+    for (size_t i = 0; i < n; i++) {
+        size_t victim = (start + i) % n;
+        if (victim != id && pool->locals[victim]->tryPop(*task)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ThreadPool::hasTask_(Pool *pool) {
+    if (!pool->inject.empty()) {
+        return true;
+    }
+    for (auto &local : pool->locals) {
+        if (!local->empty()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::park_(Pool *pool) {
+    /*
+     * 先登记 idle 再检查有没有任务, 提交方先放任务再看 idle (都是 seq_cst),
+     * 两边至少有一方能看到对方, 不会出现任务已提交而线程睡死的情况
+     */
+    pool->idle.fetch_add(1);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    {
+        std::unique_lock<std::mutex> locker(pool->mtx);
+        if (!pool->isClose && !hasTask_(pool)) {
+            pool->cond.wait(locker);
+        }
+    }
+    pool->idle.fetch_sub(1);
+}
+
+void ThreadPool::wakeOne_(Pool *pool) {
+    if (pool->idle.load() == 0) {
+        return;
+    }
+    {
+        // 与 park_ 中的检查和 wait 串行, 避免通知落在两者之间
+        std::lock_guard<std::mutex> locker(pool->mtx);
+    }
+    pool->cond.notify_one();
+}
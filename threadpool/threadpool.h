@@ -1,39 +1,94 @@
 #ifndef THREADPOOL_H
 #define THREADPOOL_H
 
+#include <atomic>
 #include <cassert>
 #include <condition_variable>
-#include <functional>
+#include <memory>
 #include <mutex>
-#include <queue>
 #include <thread>
+#include <vector>
 
+#include "../affinity/cpuaffinity.h"
+#include "inplacefunction.h"
+#include "mpmcring.h"
+
+/*
+ * 工作窃取线程池, 任务都原地存放在有界无锁环形队列的格子里, 提交和执行都不分配内存
+ * 外部线程(Reactor)提交的任务进共享的注入队列, 队列满时 addTask 返回 false
+ * 每个工作线程另有自己的本地队列: 从注入队列取任务时按份额搬一批过来, 别的线程空闲时从这里窃取;
+ * 工作线程提交的也进自己的本地队列, 满了再进注入队列, 都满时同样返回 false
+ * 工作线程取任务的顺序: 自己的队列 -> 注入队列(顺带搬一批) -> 随机窃取
+ * 都取不到时先自旋一会儿再睡眠, 只在有睡眠的线程时才加锁唤醒, 且每次只唤醒一个
+ * cpus 非空时第 i 个工作线程绑定到 cpus[i % cpus.size()]
+ */
 class ThreadPool {
 public:
-    explicit ThreadPool(size_t threadNum = 8);
+    /* 任务的捕获放在任务对象内部, 超过 TASK_CAPACITY 字节编译报错 */
+    static const size_t TASK_CAPACITY = 48;
+    using Task = InplaceFunction<void(), TASK_CAPACITY>;
+
+    explicit ThreadPool(size_t threadNum = 8, size_t queueCapacity = 4096, const std::vector<int> &cpus = {});
     ThreadPool() = default;
     ThreadPool(ThreadPool &&) = default;
     ~ThreadPool();
 
+    /* 注入队列满时返回 false, 任务没有提交, 由调用方处理(背压) */
     template <typename T>
-    void addTask(T &&task);
+    bool addTask(T &&task);
+
+    /* 饱和度统计, 各项分别读取, 彼此之间不是同一时刻的快照 */
+    struct Stats {
+        size_t threads;
+        size_t busy;          // 正在执行任务的线程数
+        size_t queued;        // 注入队列和各本地队列中等待的任务数
+        size_t capacity;      // 注入队列容量
+        uint64_t submitted;   // 提交成功的任务数
+        uint64_t rejected;    // 队列满被拒绝的次数
+        uint64_t completed;
+    };
+    Stats stats() const;
 
 private:
+    /* 每个工作线程一份, 只由自己写, 独占缓存行 */
+    struct alignas(64) WorkerStat {
+        std::atomic<uint64_t> completed{0};
+        std::atomic<bool> busy{false};
+    };
+
     struct Pool {
-        std::queue<std::function<void()>> tasks;
-        std::mutex mtx;
+        explicit Pool(size_t queueCapacity) : inject(queueCapacity) {}
+
+        std::vector<std::unique_ptr<MpmcRing<Task>>> locals;  // 每个工作线程一个, 只有所有者放入, 所有者和窃取者取出
+        std::unique_ptr<WorkerStat[]> workerStats;
+        MpmcRing<Task> inject;
+        std::atomic<uint64_t> submitted{0};
+        std::atomic<uint64_t> rejected{0};
+
+        std::mutex mtx;  // 只用于睡眠和唤醒
         std::condition_variable cond;
-        bool isClose;
+        std::atomic<int> idle{0};  // 正在睡眠或即将睡眠的线程数
+        std::atomic<bool> isClose{false};
     };
+
+    bool push_(Task &&task);
+
+    static void run_(std::shared_ptr<Pool> pool, size_t id, int cpu);
+    static bool next_(Pool *pool, size_t id, uint32_t *seed, Task *task);
+    static bool hasTask_(Pool *pool);
+    static void park_(Pool *pool);
+    static void wakeOne_(Pool *pool);
+
+    static const int SPIN_ROUNDS = 64;  // 睡眠前空转查找的轮数
+    static const size_t LOCAL_CAPACITY = 256;
+    static const size_t INJECT_BATCH = 16;  // 一次从注入队列最多搬到本地队列的任务数
+
     std::shared_ptr<Pool> pool_;
 };
+
 template <typename T>
-void ThreadPool::addTask(T &&task) {
-    {
-        std::lock_guard<std::mutex> locker(pool_->mtx);
-        pool_->tasks.emplace(std::forward<T>(task));  // 这里使用完美转发
-    }
-    pool_->cond.notify_one();
+bool ThreadPool::addTask(T &&task) {
+    return push_(Task(std::forward<T>(task)));  // 这里使用完美转发
 }
 
 #endif  // THREADPOOL_H
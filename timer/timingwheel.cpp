@@ -0,0 +1,150 @@
+#include "timingwheel.h"
+
+#include <climits>
+
+TimingWheel::TimingWheel(const TimeoutCallBack &cb)
+    : bitmap_(0), current_(0), count_(0), start_(std::chrono::steady_clock::now()), cb_(cb) {
+    for (int level = 0; level < LEVEL_NUM; level++) {
+        for (int i = 0; i < SLOT_NUM; i++) {
+            slots_[level][i].prev = slots_[level][i].next = &slots_[level][i];
+        }
+    }
+}
+
+TimingWheel::~TimingWheel() {
+    clear();
+}
+
+void TimingWheel::add(TimerNode *node, int timeoutMs) {
+    assert(node && timeoutMs >= 0);
+    uint64_t expire = (nowMs_() + timeoutMs + TICK_MS - 1) / TICK_MS;
+    if (node->linked()) {
+        if (node->expire == expire) {
+            return;  // 同一个 tick 内的重复刷新
+        }
+        unlink_(node);
+    } else {
+        count_++;
+    }
+    node->expire = expire;
+    place_(node);
+}
+
+void TimingWheel::cancel(TimerNode *node) {
+    assert(node);
+    if (node->linked()) {
+        unlink_(node);
+        count_--;
+    }
+}
+
+void TimingWheel::clear() {
+    for (int level = 0; level < LEVEL_NUM; level++) {
+        for (int i = 0; i < SLOT_NUM; i++) {
+            TimerNode *head = &slots_[level][i];
+            while (head->next != head) {
+                unlink_(head->next);
+            }
+        }
+    }
+    bitmap_ = 0;
+    count_ = 0;
+}
+
+void TimingWheel::tick() {
+    uint64_t now = nowMs_() / TICK_MS;
+    if (count_ == 0) {
+        current_ = now + 1;  // 空的时候直接跳过
+        return;
+    }
+    while (current_ <= now) {
+        int idx = current_ & (SLOT_NUM - 1);
+        if (idx == 0) {
+            cascade_(1);
+        }
+        /* 回调中可能关闭连接或重新 add, 每次都从表头取 */
+        TimerNode *head = &slots_[0][idx];
+        while (head->next != head) {
+            TimerNode *node = head->next;
+            unlink_(node);
+            count_--;
+            cb_(node);
+        }
+        current_++;
+    }
+}
+
+int TimingWheel::getNextTick() {
+    tick();
+    if (count_ == 0) {
+        return -1;
+    }
+    /* 第 0 层本轮内最近的非空槽; 本轮没有时醒在下一次搬移, 届时再算 */
+    int idx = current_ & (SLOT_NUM - 1);
+    uint64_t target = (current_ | (SLOT_NUM - 1)) + 1;
+    uint64_t mask;
+    while ((mask = bitmap_ & (~0ULL << idx)) != 0) {
+        int slot = __builtin_ctzll(mask);
+        if (slots_[0][slot].next != &slots_[0][slot]) {
+            target = current_ - idx + slot;
+            break;
+        }
+        bitmap_ &= ~(1ULL << slot);
+    }
+    int64_t ms = static_cast<int64_t>(target * TICK_MS) - static_cast<int64_t>(nowMs_());
+    if (ms < 0) {
+        return 0;
+    }
+    return ms > INT_MAX ? INT_MAX : static_cast<int>(ms);
+}
+
+void TimingWheel::place_(TimerNode *node) {
+    if (node->expire < current_) {
+        node->expire = current_;  // 已经过期的放在下一个要处理的槽
+    }
+    uint64_t diff = node->expire - current_;
+    for (int level = 0; level < LEVEL_NUM; level++) {
+        if (diff < (1ULL << (LEVEL_BITS * (level + 1)))) {
+            int idx = (node->expire >> (LEVEL_BITS * level)) & (SLOT_NUM - 1);
+            link_(&slots_[level][idx], node);
+            if (level == 0) {
+                bitmap_ |= 1ULL << idx;
+            }
+            return;
+        }
+    }
+    /* 超出时间轮范围, 放在最高层的最远处, 搬移下来后会重新计算 */
+    node->expire = current_ + (1ULL << (LEVEL_BITS * LEVEL_NUM)) - 1;
+    int idx = (node->expire >> (LEVEL_BITS * (LEVEL_NUM - 1))) & (SLOT_NUM - 1);
+    link_(&slots_[LEVEL_NUM - 1][idx], node);
+}
+
+void TimingWheel::cascade_(int level) {
+    int idx = (current_ >> (LEVEL_BITS * level)) & (SLOT_NUM - 1);
+    if (idx == 0 && level + 1 < LEVEL_NUM) {
+        cascade_(level + 1);  // 先把更高层的搬下来
+    }
+    TimerNode *head = &slots_[level][idx];
+    while (head->next != head) {
+        TimerNode *node = head->next;
+        unlink_(node);
+        place_(node);
+    }
+}
+
+uint64_t TimingWheel::nowMs_() const {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start_).count();
+}
+
+void TimingWheel::link_(TimerNode *head, TimerNode *node) {
+    node->prev = head->prev;
+    node->next = head;
+    head->prev->next = node;
+    head->prev = node;
+}
+
+void TimingWheel::unlink_(TimerNode *node) {
+    node->prev->next = node->next;
+    node->next->prev = node->prev;
+    node->prev = node->next = nullptr;
+}
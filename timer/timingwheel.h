@@ -0,0 +1,62 @@
+#ifndef TIMING_WHEEL_H
+#define TIMING_WHEEL_H
+
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+
+/* 侵入式定时器节点, 放在连接槽里, 不另外分配 */
+struct TimerNode {
+    TimerNode *prev = nullptr;  // 未挂在时间轮上时为 nullptr
+    TimerNode *next = nullptr;
+    uint64_t expire = 0;        // 到期的 tick
+    void *data = nullptr;       // 由使用者设置, 到期回调据此找到所属对象
+
+    bool linked() const { return prev != nullptr; }
+};
+
+/*
+ * 分层时间轮, 每层 64 个槽, 共 LEVEL_NUM 层, 精度 TICK_MS
+ * 添加、刷新、取消都是 O(1) 的链表操作; 到期时由高层向低层逐级搬移
+ * 不是线程安全的, 只能在所属事件循环的线程上使用
+ * 由事件循环的 epoll_wait/io_uring 超时驱动: getNextTick() 处理到期节点并返回下次需要醒来的毫秒数
+ */
+class TimingWheel {
+public:
+    using TimeoutCallBack = std::function<void(TimerNode *node)>;
+
+    explicit TimingWheel(const TimeoutCallBack &cb);
+    ~TimingWheel();
+    TimingWheel(const TimingWheel &) = delete;
+    TimingWheel &operator=(const TimingWheel &) = delete;
+
+    void add(TimerNode *node, int timeoutMs);  // 已挂上的节点会先摘下, 即刷新
+    void cancel(TimerNode *node);
+    void clear();
+
+    void tick();
+    int getNextTick();  // 没有定时器时返回 -1
+
+private:
+    static const int LEVEL_BITS = 6;
+    static const int SLOT_NUM = 1 << LEVEL_BITS;
+    static const int LEVEL_NUM = 5;
+    static const int TICK_MS = 10;
+
+    void place_(TimerNode *node);
+    void cascade_(int level);
+    uint64_t nowMs_() const;
+
+    static void link_(TimerNode *head, TimerNode *node);
+    static void unlink_(TimerNode *node);
+
+    TimerNode slots_[LEVEL_NUM][SLOT_NUM];  // 各槽链表的哨兵, 环形双向链表
+    uint64_t bitmap_;                       // 第 0 层的非空槽, 摘除时不清, 查找时顺便清
+    uint64_t current_;                      // 下一个要处理的 tick
+    size_t count_;
+    std::chrono::steady_clock::time_point start_;
+    TimeoutCallBack cb_;
+};
+
+#endif  // TIMING_WHEEL_H
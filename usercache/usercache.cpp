@@ -0,0 +1,218 @@
+#include "usercache.h"
+
+#include <chrono>
+#include <functional>
+#include <random>
+
+/* SHA-256 (FIPS 180-4), 只用来生成校验值 */
+namespace {
+
+const uint32_t SHA256_K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+inline uint32_t rotr(uint32_t x, int n) {
+    return (x >> n) | (x << (32 - n));
+}
+
+void sha256Block(uint32_t h[8], const uint8_t *p) {
+    uint32_t w[64];
+    for (int i = 0; i < 16; i++) {
+        w[i] = (uint32_t)p[i * 4] << 24 | (uint32_t)p[i * 4 + 1] << 16 | (uint32_t)p[i * 4 + 2] << 8 | p[i * 4 + 3];
+    }
+    for (int i = 16; i < 64; i++) {
+        uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+    uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4], f = h[5], g = h[6], k = h[7];
+    for (int i = 0; i < 64; i++) {
+        uint32_t t1 = k + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + SHA256_K[i] + w[i];
+        uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        k = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+    h[0] += a;
+    h[1] += b;
+    h[2] += c;
+    h[3] += d;
+    h[4] += e;
+    h[5] += f;
+    h[6] += g;
+    h[7] += k;
+}
+
+void sha256(const std::string &data, uint8_t out[32]) {
+    uint32_t h[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+    size_t len = data.size();
+    const uint8_t *p = reinterpret_cast<const uint8_t *>(data.data());
+    size_t i = 0;
+    for (; i + 64 <= len; i += 64) {
+        sha256Block(h, p + i);
+    }
+    // 末尾补 0x80、若干 0 和 64 位的比特长度
+    uint8_t tail[128] = {0};
+    size_t rest = len - i;
+    memcpy(tail, p + i, rest);
+    tail[rest] = 0x80;
+    size_t tailLen = rest + 9 <= 64 ? 64 : 128;
+    uint64_t bits = (uint64_t)len * 8;
+    for (int j = 0; j < 8; j++) {
+        tail[tailLen - 1 - j] = (uint8_t)(bits >> (j * 8));
+    }
+    for (size_t j = 0; j < tailLen; j += 64) {
+        sha256Block(h, tail + j);
+    }
+    for (int j = 0; j < 8; j++) {
+        out[j * 4] = (uint8_t)(h[j] >> 24);
+        out[j * 4 + 1] = (uint8_t)(h[j] >> 16);
+        out[j * 4 + 2] = (uint8_t)(h[j] >> 8);
+        out[j * 4 + 3] = (uint8_t)h[j];
+    }
+}
+
+}  // namespace
+
+UserCache::UserCache() : ttlMs_(0), negativeTtlMs_(0), maxEntries_(0) {
+    std::random_device rd;
+    for (size_t i = 0; i < sizeof(salt_); i++) {
+        salt_[i] = (uint8_t)rd();
+    }
+}
+
+UserCache *UserCache::instance() {
+    static UserCache inst;
+    return &inst;
+}
+
+void UserCache::init(int ttlMs, int negativeTtlMs, size_t maxEntries) {
+    ttlMs_ = ttlMs > 0 ? ttlMs : 0;
+    negativeTtlMs_ = negativeTtlMs > 0 ? negativeTtlMs : 0;
+    maxEntries_ = maxEntries / SHARD_NUM;
+}
+
+UserCache::RESULT UserCache::lookup(const std::string &name, const std::string &pwd, uint64_t *version) {
+    // 校验值在锁外算好, 负缓存命中时白算一次, 换来临界区里只有查表和比较
+    uint8_t verifier[VERIFIER_LEN];
+    verifier_(name, pwd, verifier);
+
+    Shard &shard = shard_(name);
+    std::lock_guard<std::mutex> locker(shard.mtx);
+    *version = shard.version;
+    auto it = shard.map.find(name);
+    if (it == shard.map.end() || it->second.expireMs <= nowMs_()) {
+        if (it != shard.map.end()) {
+            shard.map.erase(it);
+        }
+        shard.stats.misses++;
+        return MISS;
+    }
+    shard.stats.hits++;
+    if (!it->second.exists) {
+        shard.stats.negativeHits++;
+        return NO_USER;
+    }
+    return memcmp(it->second.verifier, verifier, VERIFIER_LEN) == 0 ? MATCH : MISMATCH;
+}
+
+void UserCache::putUser(const std::string &name, const std::string &storedPwd, uint64_t version) {
+    if (ttlMs_ == 0) {
+        return;
+    }
+    Entry entry;
+    entry.expireMs = nowMs_() + ttlMs_;
+    entry.exists = true;
+    verifier_(name, storedPwd, entry.verifier);
+    put_(name, entry, version);
+}
+
+void UserCache::putNoUser(const std::string &name, uint64_t version) {
+    if (ttlMs_ == 0 || negativeTtlMs_ == 0) {
+        return;
+    }
+    Entry entry;
+    entry.expireMs = nowMs_() + negativeTtlMs_;
+    entry.exists = false;
+    put_(name, entry, version);
+}
+
+void UserCache::invalidate(const std::string &name) {
+    Shard &shard = shard_(name);
+    std::lock_guard<std::mutex> locker(shard.mtx);
+    shard.version++;
+    shard.map.erase(name);
+    shard.stats.invalidations++;
+}
+
+bool UserCache::decided(RESULT result, bool isLogin, bool *ok) {
+    if (result == MISS || (!isLogin && result == NO_USER)) {
+        return false;
+    }
+    *ok = isLogin && result == MATCH;
+    return true;
+}
+
+UserCache::Stats UserCache::stats() {
+    Stats total;
+    for (Shard &shard : shards_) {
+        std::lock_guard<std::mutex> locker(shard.mtx);
+        total.hits += shard.stats.hits;
+        total.negativeHits += shard.stats.negativeHits;
+        total.misses += shard.stats.misses;
+        total.evictions += shard.stats.evictions;
+        total.invalidations += shard.stats.invalidations;
+        total.entries += shard.map.size();
+    }
+    return total;
+}
+
+UserCache::Shard &UserCache::shard_(const std::string &name) {
+    return shards_[std::hash<std::string>()(name) % SHARD_NUM];
+}
+
+void UserCache::put_(const std::string &name, const Entry &entry, uint64_t version) {
+    Shard &shard = shard_(name);
+    std::lock_guard<std::mutex> locker(shard.mtx);
+    if (shard.version != version) {
+        return;  // 查库期间有注册, 结果可能已过时
+    }
+    if (shard.map.size() >= maxEntries_ && shard.map.find(name) == shard.map.end()) {
+        uint64_t now = nowMs_();
+        for (auto it = shard.map.begin(); it != shard.map.end();) {
+            it = it->second.expireMs <= now ? shard.map.erase(it) : std::next(it);
+        }
+        if (shard.map.size() >= maxEntries_) {
+            if (shard.map.empty()) {
+                return;
+            }
+            shard.map.erase(shard.map.begin());
+            shard.stats.evictions++;
+        }
+    }
+    shard.map[name] = entry;
+}
+
+void UserCache::verifier_(const std::string &name, const std::string &pwd, uint8_t *out) const {
+    // 用户名以 '\0' 结尾, 避免 ("ab", "c") 和 ("a", "bc") 得到同一个输入
+    std::string input(reinterpret_cast<const char *>(salt_), sizeof(salt_));
+    input.append(name).push_back('\0');
+    input.append(pwd);
+    sha256(input, out);
+}
+
+uint64_t UserCache::nowMs_() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
@@ -0,0 +1,87 @@
+#ifndef USERCACHE_H
+#define USERCACHE_H
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "../log/log.h"
+
+/*
+ * 登录/注册时按用户名查库结果的进程内缓存, 挡在 UserStore 后端前面
+ * 分片加锁; 存在的用户只保存校验值 SHA-256(盐 + 用户名 + 密码), 盐在进程启动时随机生成, 不保存明文密码
+ * 不存在的用户也缓存(负缓存), 有效期更短; 注册写库后显式失效
+ * 每个分片有版本号, 失效时递增: 查库期间版本变了的结果不再写入, 避免注册后又被旧的负缓存覆盖
+ * 条目到期或分片满时淘汰, 分片满时先清掉过期条目, 仍满再随便淘汰一个
+ */
+class UserCache {
+public:
+    enum RESULT {
+        MISS = 0,  // 没有缓存或已过期, 需要查库
+        NO_USER,   // 用户不存在
+        MATCH,     // 用户存在, 密码一致
+        MISMATCH,  // 用户存在, 密码不一致
+    };
+
+    struct Stats {
+        uint64_t hits = 0;          // 含负缓存命中
+        uint64_t negativeHits = 0;
+        uint64_t misses = 0;
+        uint64_t evictions = 0;     // 分片满时淘汰的未过期条目
+        uint64_t invalidations = 0;
+        size_t entries = 0;
+    };
+
+    static UserCache *instance();
+    /* ttlMs 为 0 时不缓存 */
+    void init(int ttlMs = 60000, int negativeTtlMs = 5000, size_t maxEntries = 65536);
+
+    /* version 返回分片当前版本, 查库后原样传给 putUser/putNoUser */
+    RESULT lookup(const std::string &name, const std::string &pwd, uint64_t *version);
+    void putUser(const std::string &name, const std::string &storedPwd, uint64_t version);  // storedPwd 为库里的密码
+    void putNoUser(const std::string &name, uint64_t version);
+    void invalidate(const std::string &name);
+
+    /* 缓存结果能否直接得出校验结论: 登录看密码是否一致, 注册时用户已存在即失败; 用户不存在的注册仍要写库 */
+    static bool decided(RESULT result, bool isLogin, bool *ok);
+
+    Stats stats();
+
+private:
+    UserCache();
+    ~UserCache() = default;
+
+    static const int SHARD_NUM = 16;
+    static const size_t VERIFIER_LEN = 32;
+
+    struct Entry {
+        uint64_t expireMs;
+        bool exists;
+        uint8_t verifier[VERIFIER_LEN];  // exists 为 false 时无意义
+    };
+
+    struct Shard {
+        std::mutex mtx;
+        std::unordered_map<std::string, Entry> map;
+        uint64_t version = 0;
+        Stats stats;
+    };
+
+    Shard &shard_(const std::string &name);
+    void put_(const std::string &name, const Entry &entry, uint64_t version);
+    void verifier_(const std::string &name, const std::string &pwd, uint8_t *out) const;
+    static uint64_t nowMs_();
+
+private:
+    int ttlMs_;
+    int negativeTtlMs_;
+    size_t maxEntries_;  // 每个分片
+    uint8_t salt_[16];
+
+    Shard shards_[SHARD_NUM];
+};
+
+#endif  // USERCACHE_H
@@ -0,0 +1,48 @@
+#include "memoryuserstore.h"
+
+#include <fstream>
+#include <functional>
+#include <sstream>
+
+bool MemoryUserStore::load(const char *path) {
+    std::ifstream in(path);
+    if (!in) {
+        LOG_ERROR("User file %s open error!", path);
+        return false;
+    }
+    std::string line, name, pwd;
+    size_t count = 0;
+    while (std::getline(in, line)) {
+        std::istringstream fields(line);
+        if (!(fields >> name >> pwd) || name[0] == '#') {
+            continue;
+        }
+        Shard &shard = shard_(name);
+        std::lock_guard<std::mutex> locker(shard.mtx);
+        shard.users[name] = pwd;
+        count++;
+    }
+    LOG_INFO("Loaded %zu users from %s", count, path);
+    return true;
+}
+
+UserStore::FIND_RESULT MemoryUserStore::find(const std::string &name, std::string *pwd) {
+    Shard &shard = shard_(name);
+    std::lock_guard<std::mutex> locker(shard.mtx);
+    auto it = shard.users.find(name);
+    if (it == shard.users.end()) {
+        return NOT_FOUND;
+    }
+    *pwd = it->second;
+    return FOUND;
+}
+
+HttpRequest::AUTH_RESULT MemoryUserStore::add(const std::string &name, const std::string &pwd) {
+    Shard &shard = shard_(name);
+    std::lock_guard<std::mutex> locker(shard.mtx);
+    return shard.users.emplace(name, pwd).second ? HttpRequest::AUTH_OK : HttpRequest::AUTH_FAIL;
+}
+
+MemoryUserStore::Shard &MemoryUserStore::shard_(const std::string &name) {
+    return shards_[std::hash<std::string>()(name) % SHARD_NUM];
+}
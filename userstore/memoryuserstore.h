@@ -0,0 +1,38 @@
+#ifndef MEMORY_USERSTORE_H
+#define MEMORY_USERSTORE_H
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "userstore.h"
+
+/*
+ * 存在进程内的哈希表里, 分片加锁, 进程退出即丢失
+ * 不访问网络和磁盘, find/add 不阻塞, 在 Reactor 线程上直接完成; 压测时用来排除数据库的耗时和抖动
+ */
+class MemoryUserStore : public UserStore {
+public:
+    /* 预置用户, 每行 "用户名 密码", 空行和 # 开头的行跳过; 文件打不开返回 false */
+    bool load(const char *path);
+
+    KIND kind() const override { return STORE_MEMORY; }
+    bool blocking() const override { return false; }
+
+    FIND_RESULT find(const std::string &name, std::string *pwd) override;
+    HttpRequest::AUTH_RESULT add(const std::string &name, const std::string &pwd) override;
+
+private:
+    static const int SHARD_NUM = 16;
+
+    struct Shard {
+        std::mutex mtx;
+        std::unordered_map<std::string, std::string> users;  // 用户名 -> 密码
+    };
+
+    Shard &shard_(const std::string &name);
+
+    Shard shards_[SHARD_NUM];
+};
+
+#endif  // MEMORY_USERSTORE_H
@@ -0,0 +1,89 @@
+#include "mysqluserstore.h"
+
+UserStore::FIND_RESULT MysqlUserStore::find(const std::string &name, std::string *pwd) {
+    SqlConnPool *pool = SqlConnPool::instance();
+    MYSQL *conn;
+    SqlConnRAII connRAII(&conn, pool);  // 具名对象, 连接在函数返回时才归还
+    if (!conn) {
+        LOG_WARN("MySql conn unavailable!");
+        return UNAVAILABLE;
+    }
+
+    UserStmt user(name);
+    MYSQL_STMT *stmt = pool->getStmt(conn, SqlConnPool::STMT_SELECT_USER);
+    if (!stmt || !user.bindSelect(stmt) || mysql_stmt_execute(stmt) || mysql_stmt_store_result(stmt)) {
+        if (pool->onStmtError(conn, stmt)) {
+            connRAII.markBroken();
+        }
+        return UNAVAILABLE;
+    }
+    return user.fetch(stmt, pwd) ? FOUND : NOT_FOUND;
+}
+
+HttpRequest::AUTH_RESULT MysqlUserStore::add(const std::string &name, const std::string &pwd) {
+    SqlConnPool *pool = SqlConnPool::instance();
+    MYSQL *conn;
+    SqlConnRAII connRAII(&conn, pool);
+    if (!conn) {
+        LOG_WARN("MySql conn unavailable!");
+        return HttpRequest::AUTH_UNAVAILABLE;
+    }
+
+    UserStmt user(name, pwd);
+    MYSQL_STMT *stmt = pool->getStmt(conn, SqlConnPool::STMT_INSERT_USER);
+    if (stmt && user.bindInsert(stmt) && !mysql_stmt_execute(stmt)) {
+        return HttpRequest::AUTH_OK;
+    }
+    // 服务端拒绝(多为用户名重复)算注册失败, 连接断开才是不可用
+    if (pool->onStmtError(conn, stmt)) {
+        connRAII.markBroken();
+        return HttpRequest::AUTH_UNAVAILABLE;
+    }
+    return HttpRequest::AUTH_FAIL;
+}
+
+Task<UserStore::FIND_RESULT> MysqlUserStore::findAsync(Reactor *reactor, ThreadPool *pool, std::string name, std::string *pwd) {
+    if (!AsyncSql::isNonBlocking()) {
+        // 取连接、prepare、执行整个交给 IO 通道, 只跨一次线程
+        co_return co_await UserStore::findAsync(reactor, pool, std::move(name), pwd);
+    }
+    AsyncSql sql(reactor, SqlConnPool::instance());
+    MYSQL *conn = co_await sql.acquire();
+    if (!conn) {
+        LOG_WARN("MySql conn unavailable!");
+        co_return UNAVAILABLE;
+    }
+
+    UserStmt user(std::move(name));
+    MYSQL_STMT *stmt = co_await sql.prepare(conn, SqlConnPool::STMT_SELECT_USER);
+    if (!stmt || !user.bindSelect(stmt) || !co_await sql.execute(conn, stmt)) {
+        sql.release(conn, SqlConnPool::instance()->onStmtError(conn, stmt));
+        co_return UNAVAILABLE;
+    }
+    FIND_RESULT found = user.fetch(stmt, pwd) ? FOUND : NOT_FOUND;
+    sql.release(conn);
+    co_return found;
+}
+
+Task<HttpRequest::AUTH_RESULT> MysqlUserStore::addAsync(Reactor *reactor, ThreadPool *pool, std::string name, std::string pwd) {
+    if (!AsyncSql::isNonBlocking()) {
+        co_return co_await UserStore::addAsync(reactor, pool, std::move(name), std::move(pwd));
+    }
+    AsyncSql sql(reactor, SqlConnPool::instance());
+    MYSQL *conn = co_await sql.acquire();
+    if (!conn) {
+        LOG_WARN("MySql conn unavailable!");
+        co_return HttpRequest::AUTH_UNAVAILABLE;
+    }
+
+    UserStmt user(std::move(name), std::move(pwd));
+    MYSQL_STMT *stmt = co_await sql.prepare(conn, SqlConnPool::STMT_INSERT_USER);
+    HttpRequest::AUTH_RESULT result = HttpRequest::AUTH_OK;
+    bool broken = false;
+    if (!stmt || !user.bindInsert(stmt) || !co_await sql.execute(conn, stmt)) {
+        broken = SqlConnPool::instance()->onStmtError(conn, stmt);
+        result = broken ? HttpRequest::AUTH_UNAVAILABLE : HttpRequest::AUTH_FAIL;
+    }
+    sql.release(conn, broken);
+    co_return result;
+}
@@ -0,0 +1,25 @@
+#ifndef MYSQL_USERSTORE_H
+#define MYSQL_USERSTORE_H
+
+#include "../sqlconnpool/asyncsql.h"
+#include "../sqlconnpool/sqlconnRAII.h"
+#include "../sqlconnpool/userstmt.h"
+#include "userstore.h"
+
+/*
+ * 存在 MySQL user 表里, 连接取自 SqlConnPool, 语句用连接上缓存的预编译语句
+ * 协程版本: 客户端库支持非阻塞接口时由 AsyncSql 在 Reactor 上等待, 否则整个 find/add 交给 IO 通道
+ */
+class MysqlUserStore : public UserStore {
+public:
+    KIND kind() const override { return STORE_MYSQL; }
+    bool blocking() const override { return !AsyncSql::isNonBlocking(); }
+
+    FIND_RESULT find(const std::string &name, std::string *pwd) override;
+    HttpRequest::AUTH_RESULT add(const std::string &name, const std::string &pwd) override;
+
+    Task<FIND_RESULT> findAsync(Reactor *reactor, ThreadPool *pool, std::string name, std::string *pwd) override;
+    Task<HttpRequest::AUTH_RESULT> addAsync(Reactor *reactor, ThreadPool *pool, std::string name, std::string pwd) override;
+};
+
+#endif  // MYSQL_USERSTORE_H
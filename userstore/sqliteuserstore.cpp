@@ -0,0 +1,125 @@
+#include "sqliteuserstore.h"
+
+#include <atomic>
+#include <unordered_map>
+
+namespace {
+std::atomic<uint64_t> nextStoreId{1};
+}
+
+SqliteUserStore::SqliteUserStore() : id_(nextStoreId.fetch_add(1, std::memory_order_relaxed)), shared_(false) {}
+
+SqliteUserStore::~SqliteUserStore() = default;
+
+SqliteUserStore::Conn::~Conn() {
+    sqlite3_finalize(select);
+    sqlite3_finalize(insert);
+    sqlite3_close(db);
+}
+
+bool SqliteUserStore::open(const char *path) {
+    path_ = path;
+    // 在当前线程先开一个连接, 顺带建表, 路径不可用时启动就能发现
+    if (!conn_()) {
+        return false;
+    }
+    shared_ = path_ == ":memory:";
+    return true;
+}
+
+bool SqliteUserStore::openConn_(Conn *conn) {
+    // 连接只在打开它的线程上用, 不再要 SQLite 自己的锁
+    int flags = SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_NOMUTEX;
+    if (sqlite3_open_v2(path_.c_str(), &conn->db, flags, nullptr) != SQLITE_OK) {
+        LOG_ERROR("SQLite open %s error: %s", path_.c_str(), conn->db ? sqlite3_errmsg(conn->db) : "out of memory");
+        return false;
+    }
+    sqlite3_busy_timeout(conn->db, BUSY_TIMEOUT);
+    // WAL 下读不被写挡住; 内存数据库等不支持时保持原来的日志模式
+    sqlite3_exec(conn->db, "PRAGMA journal_mode=WAL", nullptr, nullptr, nullptr);
+    const char *schema =
+        "CREATE TABLE IF NOT EXISTS user("
+        "username CHAR(50) PRIMARY KEY NOT NULL, "
+        "password CHAR(50) NOT NULL)";
+    if (sqlite3_exec(conn->db, schema, nullptr, nullptr, nullptr) != SQLITE_OK ||
+        sqlite3_prepare_v2(conn->db, "SELECT password FROM user WHERE username = ? LIMIT 1", -1, &conn->select, nullptr) != SQLITE_OK ||
+        sqlite3_prepare_v2(conn->db, "INSERT INTO user(username, password) VALUES(?, ?)", -1, &conn->insert, nullptr) != SQLITE_OK) {
+        LOG_ERROR("SQLite init %s error: %s", path_.c_str(), sqlite3_errmsg(conn->db));
+        return false;
+    }
+    return true;
+}
+
+SqliteUserStore::Conn *SqliteUserStore::conn_() {
+    if (shared_) {
+        return conns_[0].get();  // open 之后 conns_ 不再变
+    }
+    // 按实例编号而不是地址查找, 实例析构后同一地址上的新实例不会拿到已关闭的连接
+    thread_local std::unordered_map<uint64_t, Conn *> conns;
+    auto it = conns.find(id_);
+    if (it != conns.end()) {
+        return it->second;
+    }
+    std::unique_ptr<Conn> conn(new Conn());
+    if (!openConn_(conn.get())) {
+        return nullptr;  // 下次调用再重试
+    }
+    Conn *raw = conn.get();
+    {
+        std::lock_guard<std::mutex> locker(mtx_);
+        conns_.push_back(std::move(conn));
+    }
+    conns.emplace(id_, raw);
+    return raw;
+}
+
+UserStore::FIND_RESULT SqliteUserStore::find(const std::string &name, std::string *pwd) {
+    Conn *conn = conn_();
+    if (!conn) {
+        return UNAVAILABLE;
+    }
+    std::unique_lock<std::mutex> locker(mtx_, std::defer_lock);
+    if (shared_) {
+        locker.lock();
+    }
+    sqlite3_stmt *select = conn->select;
+    sqlite3_bind_text(select, 1, name.data(), name.size(), SQLITE_STATIC);
+    FIND_RESULT found = UNAVAILABLE;
+    int rc = sqlite3_step(select);
+    if (rc == SQLITE_ROW) {
+        const char *text = reinterpret_cast<const char *>(sqlite3_column_text(select, 0));
+        pwd->assign(text ? text : "", sqlite3_column_bytes(select, 0));
+        found = FOUND;
+    } else if (rc == SQLITE_DONE) {
+        found = NOT_FOUND;
+    } else {
+        LOG_ERROR("SQLite select error: %s", sqlite3_errmsg(conn->db));
+    }
+    sqlite3_reset(select);
+    sqlite3_clear_bindings(select);
+    return found;
+}
+
+HttpRequest::AUTH_RESULT SqliteUserStore::add(const std::string &name, const std::string &pwd) {
+    Conn *conn = conn_();
+    if (!conn) {
+        return HttpRequest::AUTH_UNAVAILABLE;
+    }
+    std::unique_lock<std::mutex> locker(mtx_, std::defer_lock);
+    if (shared_) {
+        locker.lock();
+    }
+    sqlite3_stmt *insert = conn->insert;
+    sqlite3_bind_text(insert, 1, name.data(), name.size(), SQLITE_STATIC);
+    sqlite3_bind_text(insert, 2, pwd.data(), pwd.size(), SQLITE_STATIC);
+    HttpRequest::AUTH_RESULT result = HttpRequest::AUTH_OK;
+    int rc = sqlite3_step(insert);
+    if (rc != SQLITE_DONE) {
+        // 主键冲突是用户名重复, 其余(磁盘满、库被锁)算不可用
+        result = (rc & 0xff) == SQLITE_CONSTRAINT ? HttpRequest::AUTH_FAIL : HttpRequest::AUTH_UNAVAILABLE;
+        LOG_WARN("SQLite insert error: %s", sqlite3_errmsg(conn->db));
+    }
+    sqlite3_reset(insert);
+    sqlite3_clear_bindings(insert);
+    return result;
+}
@@ -0,0 +1,54 @@
+#ifndef SQLITE_USERSTORE_H
+#define SQLITE_USERSTORE_H
+
+#include <sqlite3.h>
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "userstore.h"
+
+/*
+ * 存在本地 SQLite 数据库文件的 user 表里, 表结构与 MySQL 的相同, 没有时自动创建
+ * 每个调用线程各开一个连接(IO 通道的线程各用各的), 两条语句在连接上 prepare 一次后反复 reset 复用
+ * WAL 模式下读互不阻塞, 也不被写挡住; 写仍由 SQLite 串行, 冲突时按 BUSY_TIMEOUT 等待
+ * 路径为 :memory: 时每个连接是一份独立的库, 只能所有线程共用 open 时的连接, 加锁串行
+ * 访问磁盘会阻塞, 协程版本交给 IO 通道执行
+ */
+class SqliteUserStore : public UserStore {
+public:
+    SqliteUserStore();
+    ~SqliteUserStore() override;
+
+    bool open(const char *path);
+
+    KIND kind() const override { return STORE_SQLITE; }
+    bool blocking() const override { return true; }
+
+    FIND_RESULT find(const std::string &name, std::string *pwd) override;
+    HttpRequest::AUTH_RESULT add(const std::string &name, const std::string &pwd) override;
+
+private:
+    static const int BUSY_TIMEOUT = 1000;  // 毫秒, 文件被别的连接锁住时最多等这么久
+
+    struct Conn {
+        ~Conn();
+
+        sqlite3 *db = nullptr;
+        sqlite3_stmt *select = nullptr;
+        sqlite3_stmt *insert = nullptr;
+    };
+
+    Conn *conn_();  // 当前线程的连接, 第一次用时打开, 失败返回 nullptr
+    bool openConn_(Conn *conn);
+
+    const uint64_t id_;  // 区分实例, 线程局部的连接表按它查找
+    std::string path_;
+    bool shared_;  // 内存数据库, 共用 conns_[0]
+    std::mutex mtx_;  // 保护 conns_, shared_ 时也串行所有语句
+    std::vector<std::unique_ptr<Conn>> conns_;  // 所有线程的连接, 随本对象一起关闭
+};
+
+#endif  // SQLITE_USERSTORE_H
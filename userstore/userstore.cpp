@@ -0,0 +1,171 @@
+#include "userstore.h"
+
+#include <cstring>
+
+#include "../webserver/reactor.h"
+#include "memoryuserstore.h"
+#ifdef WITH_MYSQL
+#include "mysqluserstore.h"
+#endif
+#ifdef WITH_SQLITE
+#include "sqliteuserstore.h"
+#endif
+
+std::unique_ptr<UserStore> &UserStore::current_() {
+#ifdef WITH_MYSQL
+    static std::unique_ptr<UserStore> store(new MysqlUserStore());
+#else
+    static std::unique_ptr<UserStore> store(new MemoryUserStore());
+#endif
+    return store;
+}
+
+UserStore *UserStore::instance() {
+    return current_().get();
+}
+
+bool UserStore::init(const char *spec) {
+    // "类型" 或 "类型:参数"
+    std::string kind = spec ? spec : "mysql";
+    std::string arg;
+    size_t colon = kind.find(':');
+    if (colon != std::string::npos) {
+        arg = kind.substr(colon + 1);
+        kind.resize(colon);
+    }
+
+    std::unique_ptr<UserStore> store;
+    if (kind == "memory") {
+        std::unique_ptr<MemoryUserStore> mem(new MemoryUserStore());
+        if (!arg.empty() && !mem->load(arg.c_str())) {
+            return false;
+        }
+        store = std::move(mem);
+#ifdef WITH_MYSQL
+    } else if (kind == "mysql" && arg.empty()) {
+        store.reset(new MysqlUserStore());
+#endif
+#ifdef WITH_SQLITE
+    } else if (kind == "sqlite" && !arg.empty()) {
+        std::unique_ptr<SqliteUserStore> lite(new SqliteUserStore());
+        if (!lite->open(arg.c_str())) {
+            return false;
+        }
+        store = std::move(lite);
+#endif
+    } else {
+        // mysql/sqlite 要在编译时打开(make MYSQL=1 SQLITE=1, 默认都打开)
+        LOG_ERROR("Unknown or not built user store: %s", spec);
+        return false;
+    }
+    current_() = std::move(store);
+    return true;
+}
+
+const char *UserStore::kindName(KIND kind) {
+    static const char *NAMES[] = {"mysql", "memory", "sqlite"};
+    return NAMES[kind];
+}
+
+Task<UserStore::FIND_RESULT> UserStore::findAsync(Reactor *reactor, ThreadPool *pool, std::string name, std::string *pwd) {
+    if (!blocking()) {
+        co_return find(name, pwd);
+    }
+    FIND_RESULT found = UNAVAILABLE;
+    if (!co_await reactor->offload(pool, [&] { found = find(name, pwd); })) {
+        LOG_WARN("IO lane full, user lookup rejected");
+    }
+    co_return found;
+}
+
+Task<HttpRequest::AUTH_RESULT> UserStore::addAsync(Reactor *reactor, ThreadPool *pool, std::string name, std::string pwd) {
+    if (!blocking()) {
+        co_return add(name, pwd);
+    }
+    HttpRequest::AUTH_RESULT result = HttpRequest::AUTH_UNAVAILABLE;
+    if (!co_await reactor->offload(pool, [&] { result = add(name, pwd); })) {
+        LOG_WARN("IO lane full, user insert rejected");
+    }
+    co_return result;
+}
+
+HttpRequest::AUTH_RESULT UserStore::verify(const std::string &name, const std::string &pwd, bool isLogin) {
+    uint64_t version = 0;
+    HttpRequest::AUTH_RESULT result;
+    if (checkCache_(name, pwd, isLogin, &version, &result)) {
+        return result;
+    }
+    std::string stored;
+    FIND_RESULT found = find(name, &stored);
+    if (checkFound_(name, pwd, isLogin, found, stored, version, &result)) {
+        return result;
+    }
+    return added_(name, add(name, pwd));
+}
+
+Task<HttpRequest::AUTH_RESULT> UserStore::verifyAsync(Reactor *reactor, ThreadPool *pool, std::string name, std::string pwd, bool isLogin) {
+    uint64_t version = 0;
+    HttpRequest::AUTH_RESULT result;
+    if (checkCache_(name, pwd, isLogin, &version, &result)) {
+        co_return result;
+    }
+    std::string stored;
+    FIND_RESULT found = co_await findAsync(reactor, pool, name, &stored);
+    if (checkFound_(name, pwd, isLogin, found, stored, version, &result)) {
+        co_return result;
+    }
+    result = co_await addAsync(reactor, pool, name, pwd);
+    co_return added_(name, result);
+}
+
+bool UserStore::checkCache_(const std::string &name, const std::string &pwd, bool isLogin,
+                            uint64_t *version, HttpRequest::AUTH_RESULT *result) {
+    if (name == "" || pwd == "") {
+        *result = HttpRequest::AUTH_FAIL;
+        return true;
+    }
+    LOG_INFO("Verify name: %s", name.c_str());  // 不记密码, 日志里只有用户名
+
+    // 缓存能给出结论时不访问后端
+    bool ok = false;
+    if (UserCache::decided(UserCache::instance()->lookup(name, pwd, version), isLogin, &ok)) {
+        LOG_DEBUG("verify %s (cached)", ok ? "success" : "fail");
+        *result = ok ? HttpRequest::AUTH_OK : HttpRequest::AUTH_FAIL;
+        return true;
+    }
+    return false;
+}
+
+bool UserStore::checkFound_(const std::string &name, const std::string &pwd, bool isLogin,
+                            FIND_RESULT found, const std::string &stored, uint64_t version, HttpRequest::AUTH_RESULT *result) {
+    if (found == UNAVAILABLE) {
+        LOG_WARN("User store unavailable!");
+        *result = HttpRequest::AUTH_UNAVAILABLE;
+        return true;
+    }
+    UserCache *cache = UserCache::instance();
+    if (found == FOUND) {
+        cache->putUser(name, stored, version);
+    } else {
+        cache->putNoUser(name, version);
+    }
+
+    bool ok = found == FOUND && stored == pwd;
+    if (isLogin) {
+        LOG_INFO("%s %s", name.c_str(), ok ? "LOGIN SUCCESS" : "PASSWORD ERROR");
+        *result = ok ? HttpRequest::AUTH_OK : HttpRequest::AUTH_FAIL;
+        return true;
+    }
+    if (found == FOUND) {
+        LOG_INFO("%s USERNAME USED", name.c_str());
+        *result = HttpRequest::AUTH_FAIL;
+        return true;
+    }
+    LOG_DEBUG("register");
+    return false;
+}
+
+HttpRequest::AUTH_RESULT UserStore::added_(const std::string &name, HttpRequest::AUTH_RESULT result) {
+    UserCache::instance()->invalidate(name);  // 丢掉负缓存, 插入失败时也可能是别处刚注册了同名用户
+    return result;
+}
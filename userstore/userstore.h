@@ -0,0 +1,71 @@
+#ifndef USERSTORE_H
+#define USERSTORE_H
+
+#include <memory>
+#include <string>
+
+#include "../coroutine/task.h"
+#include "../http/httprequest.h"
+#include "../log/log.h"
+#include "../threadpool/threadpool.h"
+#include "../usercache/usercache.h"
+
+class Reactor;
+
+/*
+ * 用户存储后端, 登录/注册的校验都经过这里, 启动时按配置选定一种:
+ *   "mysql"           SqlConnPool 连接的 MySQL, 默认
+ *   "memory[:文件]"   进程内的哈希表, 可从文件预置用户(每行 "用户名 密码"), 不依赖外部服务, 压测时隔离数据库的影响
+ *   "sqlite:文件"     本地 SQLite 数据库, 没有 user 表时自动创建
+ * mysql 和 sqlite 由编译选项 WITH_MYSQL/WITH_SQLITE 控制(makefile 的 MYSQL/SQLITE), 没编译进来的不能选, 也不链接其客户端库
+ * 后端只提供按用户名查密码(find)和插入用户(add), 缓存和登录/注册的判断在 verify/verifyAsync 中, 各后端相同
+ * find/add 会阻塞的后端(blocking() 为 true)在协程版本里交给 IO 通道线程池执行,
+ * 不阻塞的就地执行; 也可以重写 findAsync/addAsync 自己在 Reactor 上等待(如非阻塞的 MySQL 客户端)
+ */
+class UserStore {
+public:
+    enum KIND {
+        STORE_MYSQL = 0,
+        STORE_MEMORY,
+        STORE_SQLITE,
+    };
+    enum FIND_RESULT {
+        FOUND = 0,
+        NOT_FOUND,
+        UNAVAILABLE,  // 后端不可用, 回 503
+    };
+
+    static UserStore *instance();  // 没有 init 过时为 MySQL, 没有编译 MySQL 时为空的内存表
+    /* 按配置创建并替换当前后端, 在启动阶段调用; 配置无法识别或后端打不开时返回 false, 保持原来的后端 */
+    static bool init(const char *spec);
+    static const char *kindName(KIND kind);
+
+    virtual ~UserStore() = default;
+    virtual KIND kind() const = 0;
+    virtual bool blocking() const = 0;
+
+    /* 用户存在时把密码放入 *pwd */
+    virtual FIND_RESULT find(const std::string &name, std::string *pwd) = 0;
+    /* 用户名已存在返回 AUTH_FAIL */
+    virtual HttpRequest::AUTH_RESULT add(const std::string &name, const std::string &pwd) = 0;
+
+    /* 协程版本, 在 reactor 的线程上调用; 会阻塞的后端交给 pool 执行, pool 为 nullptr 或队列满时不执行, 按不可用返回 */
+    virtual Task<FIND_RESULT> findAsync(Reactor *reactor, ThreadPool *pool, std::string name, std::string *pwd);
+    virtual Task<HttpRequest::AUTH_RESULT> addAsync(Reactor *reactor, ThreadPool *pool, std::string name, std::string pwd);
+
+    /* 登录/注册校验: 先查 UserCache, 没有结论时才访问后端 */
+    HttpRequest::AUTH_RESULT verify(const std::string &name, const std::string &pwd, bool isLogin);
+    Task<HttpRequest::AUTH_RESULT> verifyAsync(Reactor *reactor, ThreadPool *pool, std::string name, std::string pwd, bool isLogin);
+
+private:
+    /* 校验的两步, 能得出结论时放入 *result 返回 true; 都返回 false 时是新用户注册, 接着 add */
+    static bool checkCache_(const std::string &name, const std::string &pwd, bool isLogin,
+                            uint64_t *version, HttpRequest::AUTH_RESULT *result);
+    static bool checkFound_(const std::string &name, const std::string &pwd, bool isLogin,
+                            FIND_RESULT found, const std::string &stored, uint64_t version, HttpRequest::AUTH_RESULT *result);
+    static HttpRequest::AUTH_RESULT added_(const std::string &name, HttpRequest::AUTH_RESULT result);
+
+    static std::unique_ptr<UserStore> &current_();
+};
+
+#endif  // USERSTORE_H
@@ -0,0 +1,38 @@
+#include "connslab.h"
+
+ConnSlab::ConnSlab() {
+    for (int i = 0; i < PAGE_NUM; i++) {
+        pages_[i].store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+ConnSlab::~ConnSlab() {
+    for (int i = 0; i < PAGE_NUM; i++) {
+        delete[] pages_[i].load(std::memory_order_relaxed);
+    }
+}
+
+ConnSlab *ConnSlab::instance() {
+    static ConnSlab inst;
+    return &inst;
+}
+
+ConnSlot *ConnSlab::get(int fd) {
+    assert(fd >= 0 && fd < MAX_FD);
+    int page = fd / PAGE_SLOTS;
+    ConnSlot *slots = pages_[page].load(std::memory_order_acquire);
+    if (!slots) {
+        slots = allocPage_(page);
+    }
+    return &slots[fd % PAGE_SLOTS];
+}
+
+ConnSlot *ConnSlab::allocPage_(int page) {
+    std::lock_guard<std::mutex> locker(mtx_);
+    ConnSlot *slots = pages_[page].load(std::memory_order_relaxed);
+    if (!slots) {  // 双重检查, 其他 Reactor 可能已经分配
+        slots = new ConnSlot[PAGE_SLOTS];
+        pages_[page].store(slots, std::memory_order_release);
+    }
+    return slots;
+}
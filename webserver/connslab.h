@@ -0,0 +1,55 @@
+#ifndef CONNSLAB_H
+#define CONNSLAB_H
+
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <mutex>
+
+#include "../http/httpconn.h"
+#include "../timer/timingwheel.h"
+
+/*
+ * 连接槽: epoll_event.data.ptr 直接指向它
+ * gen 在连接建立和关闭时递增, 线程池任务持有旧 gen 时即可识别出 fd 已被复用
+ * timer 是超时节点, phase 等阶段信息和 deadline 也只由接受该连接的 Reactor 线程读写;
+ * 请求交给工作线程处理期间 deadline 为 0, 处理完回到 Reactor 线程后才重新计算
+ */
+struct alignas(64) ConnSlot {
+    HttpConn conn;
+    std::atomic<uint32_t> gen{0};
+    TimerNode timer;
+
+    uint8_t phase = 0;
+    uint64_t phaseStart = 0;    // 进入当前阶段的时刻, ms
+    uint64_t lastProgress = 0;  // 最近一次读到或写出数据的时刻, ms
+    uint64_t phaseWritten = 0;  // 进入写阶段时连接已写出的字节数
+    uint64_t deadline = 0;      // 0 表示当前阶段不限时
+};
+
+/*
+ * 以 fd 为下标的连接表, 上限为 MAX_FD
+ * fd 在进程内唯一, 所以所有 Reactor 共用一张表
+ * 按页懒分配, 页一旦分配地址就不再变化
+ */
+class ConnSlab {
+public:
+    static const int MAX_FD = 65535;
+
+    static ConnSlab *instance();
+    ConnSlot *get(int fd);
+
+private:
+    ConnSlab();
+    ~ConnSlab();
+    ConnSlot *allocPage_(int page);
+
+private:
+    static const int PAGE_SLOTS = 256;
+    static const int PAGE_NUM = (MAX_FD + PAGE_SLOTS - 1) / PAGE_SLOTS;
+
+    std::atomic<ConnSlot *> pages_[PAGE_NUM];
+    std::mutex mtx_;
+};
+
+#endif  // CONNSLAB_H
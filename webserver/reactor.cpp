@@ -0,0 +1,554 @@
+#include "reactor.h"
+
+#include <sys/eventfd.h>
+
+#include "../userstore/userstore.h"
+
+Reactor::Reactor(int listenFd, uint32_t listenEvent, uint32_t connEvent, const ConnLimits& limits,
+                 ThreadPool* cpuPool, ThreadPool* ioPool, bool useUring, int cpu)
+    : listenFd_(listenFd), listenEvent_(listenEvent), connEvent_(connEvent), limits_(limits), minTimeout_(-1), cpu_(cpu), isClose_(false),
+      lanes_{nullptr, cpuPool, ioPool}, poolFullCnt_{}, statsInterval_(0), nextStatsMs_(0), lastStats_{}, wakeFd_(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)), timer_(new TimingWheel([this](TimerNode* node) { onTimer_(node); })), poller_(Poller::create(useUring)),
+      asyncIo_(poller_->asyncIo()), slab_(ConnSlab::instance()) {
+    for (int t : {limits_.headerTimeout, limits_.idleTimeout, limits_.writeTimeout}) {
+        if (t > 0 && (minTimeout_ < 0 || t < minTimeout_)) {
+            minTimeout_ = t;
+        }
+    }
+    // 监听 fd 的 data.ptr 为 nullptr, 与连接槽区分
+    if (!poller_->addFd(listenFd_, listenEvent_ | EPOLLIN, nullptr)) {
+        LOG_ERROR("Add Listen Error!");
+        isClose_ = true;
+    }
+    if (wakeFd_ < 0 || !poller_->addFd(wakeFd_, EPOLLIN, &wakeFd_)) {
+        LOG_ERROR("Add Wake Fd Error!");
+        isClose_ = true;
+    }
+}
+
+Reactor::~Reactor() {
+    // 还挂起着的协程帧随进程退出回收
+    if (wakeFd_ >= 0) {
+        close(wakeFd_);
+    }
+}
+
+void Reactor::loop() {
+    // 先绑核再处理连接, 之后本线程首次写入的内存(如连接缓冲区)按 first-touch 落在本节点上
+    CpuAffinity::pinThread(cpu_);
+    int timeout = -1;
+    while (!isClose_) {
+        timeout = timer_->getNextTick();  // 没有连接时限时也可能有协程在 sleep
+        int eventCnt = poller_->wait(timeout);
+        bool hasListen = false;
+        for (int i = 0; i < eventCnt; i++) {
+            void* ptr = poller_->getEventPtr(i);
+            uint32_t events = poller_->getEvents(i);
+            if (ptr == &wakeFd_) {
+                runPosted_();
+                continue;
+            }
+            if (isTagged_(ptr)) {
+                Waiter* waiter = untag_<Waiter>(ptr);
+                timer_->cancel(&waiter->timer);
+                waiter->revents = events;
+                waiter->handle.resume();
+                continue;
+            }
+            ConnSlot* slot = static_cast<ConnSlot*>(ptr);
+            if (slot == nullptr) {
+                hasListen = true;  // 本轮事件处理完再 accept, 避免同一批次里的旧事件落到复用 fd 的新连接上
+            } else if (slot->conn.isClosed()) {
+                continue;
+            } else if (events & Poller::IO_DONE) {
+                onIoDone_(slot, events, poller_->getResult(i));
+            } else if (events & (EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+                closeConn_(slot);
+            } else if (events & EPOLLIN) {
+                dealRead_(slot);
+            } else if (events & EPOLLOUT) {
+                dealWrite_(slot);
+            } else {
+                LOG_ERROR("Unexpected Event");
+            }
+        }
+        if (hasListen) {
+            dealListen_();
+        }
+        if (statsInterval_ > 0) {
+            reportStats_();
+        }
+    }
+}
+
+void Reactor::stop() {
+    isClose_ = true;
+    wake_();  // 没有定时器时 loop 阻塞在 wait(-1), 不唤醒就看不到 isClose_
+}
+
+const char* Reactor::ioBackend() const {
+    return poller_->name();
+}
+
+void Reactor::forgetFd(int fd) {
+    poller_->delFd(fd);
+}
+
+void Reactor::post(std::coroutine_handle<> h) {
+    bool wasEmpty;
+    {
+        std::lock_guard<std::mutex> locker(postMtx_);
+        wasEmpty = posted_.empty();
+        posted_.push_back(h);
+    }
+    // 队列原本不空时 eventfd 已经写过, 还没被 runPosted_ 取走
+    if (wasEmpty) {
+        wake_();
+    }
+}
+
+void Reactor::wake_() {
+    uint64_t one = 1;
+    ssize_t ret = write(wakeFd_, &one, sizeof(one));
+    (void)ret;
+}
+
+void Reactor::runPosted_() {
+    uint64_t cnt;
+    ssize_t ret = read(wakeFd_, &cnt, sizeof(cnt));
+    (void)ret;
+    std::vector<std::coroutine_handle<>> handles;
+    {
+        std::lock_guard<std::mutex> locker(postMtx_);
+        handles.swap(posted_);
+    }
+    for (std::coroutine_handle<> h : handles) {
+        h.resume();
+    }
+}
+
+bool Reactor::watchFd_(FdAwaiter* waiter) {
+    /* EPOLLONESHOT: 触发一次后 fd 仍留在 Poller 中, 再次等待时走 modFd */
+    uint32_t events = waiter->events | EPOLLONESHOT;
+    void* ptr = tag_(static_cast<Waiter*>(waiter));
+    if (poller_->modFd(waiter->fd, events, ptr) || poller_->addFd(waiter->fd, events, ptr)) {
+        if (waiter->timeoutMs >= 0) {
+            waiter->timer.data = ptr;
+            timer_->add(&waiter->timer, waiter->timeoutMs);
+        }
+        return true;
+    }
+    LOG_ERROR("Watch fd[%d] error!", waiter->fd);
+    waiter->revents = EPOLLERR;
+    return false;  // 不挂起, 调用方从返回的 EPOLLERR 得知失败
+}
+
+void Reactor::sleep_(SleepAwaiter* waiter) {
+    waiter->timer.data = tag_(static_cast<Waiter*>(waiter));
+    timer_->add(&waiter->timer, waiter->ms);
+}
+
+void Reactor::onTimer_(TimerNode* node) {
+    if (isTagged_(node->data)) {
+        Waiter* waiter = untag_<Waiter>(node->data);
+        if (waiter->fd >= 0) {
+            // 等 fd 超时: 撤掉注册, 之后不会再有指向这个等待者的事件; 再次等待时重新 addFd
+            poller_->delFd(waiter->fd);
+            waiter->revents = 0;
+        }
+        waiter->handle.resume();
+        return;
+    }
+    onTimeout_(static_cast<ConnSlot*>(node->data));
+}
+
+void Reactor::enableStats(int intervalMs) {
+    statsInterval_ = intervalMs;
+}
+
+/*
+ * 只在区间内有变化时输出: 线程忙碌数、排队数和被拒绝数看出通道是否饱和,
+ * 用户缓存的命中数看出有多少登录/注册没有走到数据库, 连接池的等待时间和超时数看出数据库是否跟得上
+ */
+void Reactor::reportStats_() {
+    uint64_t now = nowMs_();
+    if (now < nextStatsMs_) {
+        return;
+    }
+    nextStatsMs_ = now + statsInterval_;
+    for (int i = RouteStats::LANE_CPU; i < RouteStats::LANE_NUM; i++) {
+        if (!lanes_[i]) {
+            continue;
+        }
+        ThreadPool::Stats st = lanes_[i]->stats();
+        ThreadPool::Stats& last = lastStats_[i];
+        if (st.submitted != last.submitted || st.rejected != last.rejected) {
+            LOG_INFO("Lane %s: busy %zu/%zu, queued %zu/%zu, submitted +%llu, rejected +%llu, completed +%llu",
+                     RouteStats::laneName(static_cast<RouteStats::LANE>(i)), st.busy, st.threads, st.queued, st.capacity,
+                     (unsigned long long)(st.submitted - last.submitted), (unsigned long long)(st.rejected - last.rejected),
+                     (unsigned long long)(st.completed - last.completed));
+        }
+        last = st;
+    }
+
+    UserCache::Stats uc = UserCache::instance()->stats();
+    UserCache::Stats& lastUc = lastUserCache_;
+    if (uc.hits != lastUc.hits || uc.misses != lastUc.misses) {
+        LOG_INFO("UserCache: entries %zu, hits +%llu (negative +%llu), misses +%llu, evictions +%llu, invalidations +%llu",
+                 uc.entries, (unsigned long long)(uc.hits - lastUc.hits), (unsigned long long)(uc.negativeHits - lastUc.negativeHits),
+                 (unsigned long long)(uc.misses - lastUc.misses), (unsigned long long)(uc.evictions - lastUc.evictions),
+                 (unsigned long long)(uc.invalidations - lastUc.invalidations));
+    }
+    lastUc = uc;
+
+#ifdef WITH_MYSQL
+    SqlConnPool::Stats sp = SqlConnPool::instance()->stats();
+    SqlConnPool::Stats& lastSp = lastSqlPool_;
+    uint64_t errors = sp.connectErrors + sp.pingFailures + sp.broken;
+    if (sp.acquired != lastSp.acquired || sp.timeouts != lastSp.timeouts ||
+        errors != lastSp.connectErrors + lastSp.pingFailures + lastSp.broken) {
+        uint64_t waited = sp.waited - lastSp.waited;
+        LOG_INFO("SqlConnPool: conns %d [%d, %d], in use %d, waiting %zu, acquired +%llu, waited +%llu (avg %llu ms, max %llu ms), "
+                 "timeouts +%llu, connect errors +%llu, ping failures +%llu, broken +%llu, trimmed +%llu",
+                 sp.total, sp.minConn, sp.maxConn, sp.inUse, sp.waiting, (unsigned long long)(sp.acquired - lastSp.acquired),
+                 (unsigned long long)waited, (unsigned long long)(waited ? (sp.waitMsTotal - lastSp.waitMsTotal) / waited : 0),
+                 (unsigned long long)sp.waitMsMax, (unsigned long long)(sp.timeouts - lastSp.timeouts),
+                 (unsigned long long)(sp.connectErrors - lastSp.connectErrors), (unsigned long long)(sp.pingFailures - lastSp.pingFailures),
+                 (unsigned long long)(sp.broken - lastSp.broken), (unsigned long long)(sp.trimmed - lastSp.trimmed));
+    }
+    lastSp = sp;
+#endif
+}
+
+int Reactor::setFdNonblock(int fd) {
+    assert(fd > 0);
+    return fcntl(fd, F_SETFL, fcntl(fd, F_GETFD, 0) | O_NONBLOCK);  // fcntl(fd, F_GETFD, 0)是获取当前fd状态标志，再设置为nonblock
+}
+
+void Reactor::addClient(int fd, struct sockaddr_in addr) {
+    assert(fd > 0);
+    ConnSlot* slot = slab_->get(fd);
+    slot->conn.init(fd, addr);
+    ++slot->gen;
+    slot->phase = READ_HEADER;
+    slot->phaseStart = slot->lastProgress = nowMs_();
+    slot->timer.data = slot;
+    updateDeadline_(slot, false);
+    setFdNonblock(fd);
+    LOG_INFO("Client[%d] In!", fd);
+    if (asyncIo_) {
+        waitRead_(slot);
+    } else {
+        poller_->addFd(fd, EPOLLIN | connEvent_, slot);
+    }
+}
+
+void Reactor::dealListen_() {
+    struct sockaddr_in addr;
+    socklen_t len = sizeof(addr);
+    do {
+        int fd = accept(listenFd_, (struct sockaddr*)&addr, &len);
+        if (fd <= 0) {
+            return;
+        } else if (HttpConn::userCount >= ConnSlab::MAX_FD || fd >= ConnSlab::MAX_FD) {
+            sendError_(fd, "Server Busy!");
+            LOG_WARN("Server Busy!");
+            return;
+        }
+        addClient(fd, addr);
+    } while (listenEvent_ & EPOLLET);
+}
+
+void Reactor::dealWrite_(ConnSlot* slot) {
+    assert(slot);
+    onWrite_(slot);
+}
+
+void Reactor::dealRead_(ConnSlot* slot) {
+    assert(slot);
+    onRead_(slot);
+}
+
+/*
+ * 读写是非阻塞的, 都在本线程做; 处理请求时按路由分通道:
+ * 缓存命中的静态文件、304、错误页等直接在本线程处理, 省掉跨线程的唤醒和 HttpConn 缓存行的来回迁移;
+ * RouteStats 判定为耗时的交给 CPU 通道; 查数据库的(登录、注册)由本线程上的协程处理, 查库不阻塞线程,
+ * 数据库慢或连接池耗尽时只有这些请求在等, 不影响其他请求
+ */
+void Reactor::dispatch_(ConnSlot* slot, bool progress) {
+    bool cold = false;
+    RouteStats::LANE lane = laneOf_(&slot->conn, &cold);
+    if (lane == RouteStats::LANE_IO) {
+        spawn(serveIo_(slot, progress));
+        return;
+    }
+    if (lanes_[lane]) {
+        spawn(serveCpu_(slot, progress, lane, cold));
+        return;
+    }
+    finishProcess_(slot, progress, slot->conn.process(lane, cold));
+}
+
+RouteStats::LANE Reactor::laneOf_(HttpConn* client, bool* cold) {
+    /* 请求行还没收全时解析不会阻塞, 留在本线程 */
+    if (!client->nextRoute(&routeKey_)) {
+        return RouteStats::LANE_INLINE;
+    }
+    return client->laneOf(routeKey_, cold);
+}
+
+/* 通道的线程池队列满了, 请求改在本线程处理; 连接由 EPOLLONESHOT 独占, 在这里处理和交给工作线程一样安全 */
+void Reactor::onPoolFull_(RouteStats::LANE lane) {
+    if (poolFullCnt_[lane]++ % 1024 == 0) {
+        LOG_WARN("Lane %s queue full, handled in reactor, count:%zu", RouteStats::laneName(lane), poolFullCnt_[lane]);
+    }
+}
+
+void Reactor::sendError_(int fd, const char* info) {
+    assert(fd > 0);
+    int ret = send(fd, info, strlen(info), 0);
+    if (ret < 0) {
+        LOG_WARN("Send Error To Client[%d] Error!", fd);
+    }
+    close(fd);
+}
+
+/* 在处理完读写、改 epoll 事件之前调用, 按连接当前的阶段算出 deadline 并挂上定时器; 只在本线程调用 */
+void Reactor::updateDeadline_(ConnSlot* slot, bool progress) {
+    HttpConn* client = &slot->conn;
+    uint64_t now = nowMs_();
+    PHASE phase;
+    if (client->toWriteBytes() > 0) {
+        phase = WRITE;
+    } else if (client->isReadingBody()) {
+        phase = READ_BODY;
+    } else if (client->hasPartialRequest() || client->requestCount() == 0) {
+        phase = READ_HEADER;
+    } else {
+        phase = IDLE;
+    }
+    if (phase != slot->phase) {
+        slot->phase = phase;
+        slot->phaseStart = now;
+        slot->lastProgress = now;
+        slot->phaseWritten = client->writtenBytes();
+    } else if (progress) {
+        slot->lastProgress = now;
+    }
+
+    uint64_t deadline = 0;
+    switch (phase) {
+        case READ_HEADER:
+            if (limits_.headerTimeout > 0) {
+                deadline = slot->phaseStart + limits_.headerTimeout;
+            }
+            break;
+        case READ_BODY:
+            if (limits_.headerTimeout > 0) {
+                deadline = slot->lastProgress + limits_.headerTimeout;
+            }
+            break;
+        case IDLE:
+            if (limits_.idleTimeout > 0) {
+                deadline = slot->phaseStart + limits_.idleTimeout;
+            }
+            break;
+        case WRITE:
+            if (limits_.writeTimeout > 0) {
+                deadline = slot->lastProgress + limits_.writeTimeout;
+                if (limits_.minSendRate > 0) {
+                    /* 宽限 writeTimeout 之后, 平均速率低于 minSendRate 即到期 */
+                    uint64_t sent = client->writtenBytes() - slot->phaseWritten;
+                    deadline = std::min(deadline, slot->phaseStart + limits_.writeTimeout + sent * 1000 / limits_.minSendRate);
+                }
+            }
+            break;
+    }
+    slot->deadline = deadline;
+    armTimer_(slot);
+}
+
+void Reactor::armTimer_(ConnSlot* slot) {
+    if (minTimeout_ <= 0 || slot->conn.isClosed()) {
+        return;
+    }
+    uint64_t deadline = slot->deadline;
+    if (deadline == 0) {
+        timer_->cancel(&slot->timer);
+        return;
+    }
+    int64_t ms = std::max<int64_t>(static_cast<int64_t>(deadline - nowMs_()), 0);
+    timer_->add(&slot->timer, static_cast<int>(std::min<int64_t>(ms, INT_MAX)));
+}
+
+void Reactor::closeConn_(ConnSlot* slot) {
+    assert(slot);
+    LOG_INFO("Client[%d] quit!", slot->conn.getFd());
+    slot->gen++;
+    timer_->cancel(&slot->timer);
+    poller_->delFd(slot->conn.getFd());
+    slot->conn.close();
+}
+
+void Reactor::onTimeout_(ConnSlot* slot) {
+    if (slot->conn.isClosed()) {
+        return;
+    }
+    uint64_t deadline = slot->deadline;
+    if (deadline == 0 || deadline > nowMs_()) {
+        armTimer_(slot);  // 阶段变了, 按新的 deadline 重新挂上; 交给工作线程期间 deadline 为 0, 不会关闭
+        return;
+    }
+    static const char* PHASE_NAME[] = {"header", "body", "idle", "write"};
+    LOG_INFO("Client[%d] %s timeout!", slot->conn.getFd(), PHASE_NAME[slot->phase]);
+    closeConn_(slot);
+}
+
+uint64_t Reactor::nowMs_() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Reactor::onRead_(ConnSlot* slot) {
+    assert(slot);
+    HttpConn* client = &slot->conn;
+    int ret = -1;
+    int readErrno = 0;
+    ret = client->read(&readErrno);
+    if (ret <= 0 && readErrno != EAGAIN) {
+        closeConn_(slot);
+        return;
+    }
+    dispatch_(slot, ret > 0);
+}
+
+void Reactor::onWrite_(ConnSlot* slot) {
+    assert(slot);
+    HttpConn* client = &slot->conn;
+    int ret = -1;
+    int writeErrno = 0;
+    ret = client->write(&writeErrno);
+    afterWrite_(slot, ret, writeErrno);
+}
+
+void Reactor::afterWrite_(ConnSlot* slot, ssize_t ret, int writeErrno) {
+    HttpConn* client = &slot->conn;
+    if (client->toWriteBytes() == 0) {
+        if (client->isKeepAlive()) {
+            dispatch_(slot, true);
+            return;
+        }
+    } else if (ret > 0 || writeErrno == EAGAIN) {
+        /* 还有没写完的(LT 下 write 在剩余量不大时就会返回), 等下次可写 */
+        updateDeadline_(slot, ret > 0);
+        waitWrite_(slot);
+        return;
+    }
+    closeConn_(slot);
+}
+
+/* 等连接可读: 完成式读写时直接提交 recv, 读进读缓冲区留出的空间 */
+void Reactor::waitRead_(ConnSlot* slot) {
+    HttpConn* client = &slot->conn;
+    if (!asyncIo_) {
+        poller_->modFd(client->getFd(), connEvent_ | EPOLLIN, slot);
+        return;
+    }
+    size_t len = 0;
+    char* buf = client->recvBuffer(&len);
+    if (!poller_->submitRecv(client->getFd(), buf, len, slot)) {
+        LOG_ERROR("Client[%d] submit recv error!", client->getFd());
+        closeConn_(slot);
+    }
+}
+
+/*
+ * 等连接可写: 完成式读写时直接提交 writev
+ * 本批含文件段(sendfile)时仍等就绪后由 write() 发送, 用一次性的 poll, 免得之后又提交 recv 时还挂着
+ */
+void Reactor::waitWrite_(ConnSlot* slot) {
+    HttpConn* client = &slot->conn;
+    if (!asyncIo_) {
+        poller_->modFd(client->getFd(), connEvent_ | EPOLLOUT, slot);
+        return;
+    }
+    const struct iovec* iov = nullptr;
+    int cnt = client->sendIov(&iov);
+    if (cnt == 0) {
+        poller_->modFd(client->getFd(), EPOLLOUT | EPOLLONESHOT, slot);
+    } else if (!poller_->submitWritev(client->getFd(), iov, cnt, slot)) {
+        LOG_ERROR("Client[%d] submit writev error!", client->getFd());
+        closeConn_(slot);
+    }
+}
+
+/* Poller 代发的 recv/writev 完成, 按结果接着走 onRead_/onWrite_ 之后的流程 */
+void Reactor::onIoDone_(ConnSlot* slot, uint32_t events, int res) {
+    HttpConn* client = &slot->conn;
+    if (events & EPOLLIN) {
+        if (res > 0) {
+            client->recvDone(res);
+            dispatch_(slot, true);
+        } else if (res == -EAGAIN || res == -EINTR) {
+            waitRead_(slot);
+        } else {
+            closeConn_(slot);  // 对端关闭(0)或出错
+        }
+        return;
+    }
+    if (res == -EAGAIN) {
+        /* 发送缓冲区满, 等可写再由 write() 接着发; 不立即重新提交, 免得反复得到 EAGAIN */
+        poller_->modFd(client->getFd(), EPOLLOUT | EPOLLONESHOT, slot);
+        return;
+    }
+    if (res > 0) {
+        client->sendDone(res);
+    }
+    afterWrite_(slot, res < 0 ? -1 : res, res < 0 ? -res : 0);
+}
+
+/*
+ * CPU 通道的请求: 只有 process() 在工作线程上执行, 完成后回到本线程算时限、改 epoll 事件
+ * 交出之前撤掉定时器并把 deadline 置 0, 工作线程处理期间连接不会被超时关闭, 阶段信息也只有本线程读写
+ * 队列满时 offload 不执行, 本线程直接处理, 处理期间不再接收新事件, 由此形成背压
+ */
+Task<> Reactor::serveCpu_(ConnSlot* slot, bool progress, RouteStats::LANE lane, bool cold) {
+    HttpConn* client = &slot->conn;
+    slot->deadline = 0;
+    timer_->cancel(&slot->timer);
+    bool hasResponse = false;
+    if (!co_await offload(lanes_[lane], [client, lane, cold, &hasResponse] { hasResponse = client->process(lane, cold); })) {
+        onPoolFull_(lane);
+        hasResponse = client->process(lane, cold);
+    }
+    finishProcess_(slot, progress, hasResponse);
+}
+
+/*
+ * IO 通道的请求: 解析和生成响应在本线程, 查用户存储时协程挂起, 结果到达后回到本线程继续
+ * 由 UserStore 决定怎么等: 非阻塞的 MySQL 客户端把 socket 挂在本线程的 Poller 上, 内存表就地完成, 会阻塞的交给 IO 线程池
+ * 等待期间连接不在 Poller 上, 只可能被本线程的超时关闭, 恢复后按 gen 判断
+ */
+Task<> Reactor::serveIo_(ConnSlot* slot, bool progress) {
+    HttpConn* client = &slot->conn;
+    uint32_t gen = slot->gen;
+    bool hasResponse = client->process(RouteStats::LANE_IO);
+    std::string name, pwd;
+    bool isLogin = false;
+    while (client->pendingAuth(&name, &pwd, &isLogin)) {
+        HttpRequest::AUTH_RESULT result = co_await UserStore::instance()->verifyAsync(this, lanes_[RouteStats::LANE_IO], name, pwd, isLogin);
+        if (slot->gen != gen) {
+            co_return;
+        }
+        hasResponse = client->finishAuth(result);
+    }
+    finishProcess_(slot, progress, hasResponse);
+}
+
+void Reactor::finishProcess_(ConnSlot* slot, bool progress, bool hasResponse) {
+    /* modFd 之后连接可能马上被别的线程取走, 阶段信息要在这之前算好 */
+    updateDeadline_(slot, progress);
+    if (hasResponse) {
+        waitWrite_(slot);
+    } else {
+        waitRead_(slot);
+    }
+}
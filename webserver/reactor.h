@@ -0,0 +1,213 @@
+#ifndef REACTOR_H
+#define REACTOR_H
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <climits>
+#include <coroutine>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "../affinity/cpuaffinity.h"
+#include "../coroutine/task.h"
+#include "../epoller/poller.h"
+#include "../http/httpconn.h"
+#include "../log/log.h"
+#include "../threadpool/threadpool.h"
+#include "../timer/timingwheel.h"
+#include "../usercache/usercache.h"
+#ifdef WITH_MYSQL
+#include "../sqlconnpool/sqlconnpool.h"
+#endif
+#include "connslab.h"
+
+/*
+ * 连接各阶段的时限, 毫秒, <= 0 表示不限
+ * 慢速客户端(slowloris、慢读)按阶段分别计时, 持续有零星数据也不能无限占住连接
+ */
+struct ConnLimits {
+    int headerTimeout = 10000;  // 收齐请求头: 从连接建立或下一个请求的首字节算起, 期间有数据也不续期; 收请求体时按每次读到数据续期
+    int idleTimeout = 60000;    // keep-alive 连接两个请求之间的空闲
+    int writeTimeout = 10000;   // 响应发送停滞, 也是下面最低速率的宽限时间
+    int minSendRate = 1024;     // 响应发送的最低平均速率, 字节/秒
+    int maxRequests = 100;      // 每个连接最多处理的请求数, 不是时限
+};
+
+/*
+ * 一个事件循环: 独占自己的 Poller(epoll 或 io_uring)、TimingWheel, 连接放在全局的 ConnSlab 中
+ * 读写总在本线程; Poller 支持完成式读写(io_uring)时连接的 recv/writev 交给它提交, 完成后按结果继续, 否则等就绪再自己读写; 请求按 RouteStats 分到执行通道: 廉价的在本线程处理, 耗时的交给 CPU 通道线程池,
+ * 查数据库的交给阻塞 IO 通道线程池. 对应的线程池为 nullptr 时在本线程处理 (one loop per thread)
+ * cpu >= 0 时 loop() 先把运行它的线程绑定到该 cpu
+ */
+class Reactor {
+public:
+    Reactor(int listenFd, uint32_t listenEvent, uint32_t connEvent, const ConnLimits& limits,
+            ThreadPool* cpuPool, ThreadPool* ioPool, bool useUring, int cpu = -1);
+    ~Reactor();
+
+    void loop();
+    void stop();
+    const char* ioBackend() const;
+    void enableStats(int intervalMs);  // 按间隔把各通道线程池、用户缓存和数据库连接池的统计写入日志, 这些都是进程共用的, 只需一个 Reactor 开启
+
+    /*
+     * 协程接口, 除 post 外只能在本 Reactor 的线程上使用:
+     *   co_await waitFd(fd, EPOLLIN, ms)  等 fd 就绪(一次性), 返回就绪的事件, ms >= 0 时超时返回 0; 关闭 fd 前先 forgetFd
+     *   co_await sleep(ms)                挂在时间轮上, 精度同时间轮
+     *   co_await offload(pool, fn)        fn 在线程池上执行, 完成后回到本线程, 返回 true;
+     *                                     pool 为 nullptr 或队列满时不执行 fn, 返回 false, 由调用方按失败处理,
+     *                                     fn 多是阻塞调用, 不能退回到本线程上执行
+     *   post(h)                           任意线程调用, 在本线程上恢复协程
+     * 等待者放在协程帧里, 注册到 Poller/时间轮时用最低位为 1 的指针与连接槽区分
+     */
+    struct Waiter {
+        std::coroutine_handle<> handle;
+        TimerNode timer;
+        int fd = -1;           // sleep 时为 -1
+        uint32_t revents = 0;  // 超时为 0
+    };
+
+    struct FdAwaiter : Waiter {
+        FdAwaiter(Reactor* r, int f, uint32_t ev, int ms) : reactor(r), events(ev), timeoutMs(ms) { fd = f; }
+
+        bool await_ready() const noexcept { return false; }
+        bool await_suspend(std::coroutine_handle<> h) {
+            handle = h;
+            return reactor->watchFd_(this);
+        }
+        uint32_t await_resume() const noexcept { return revents; }
+
+        Reactor* reactor;
+        uint32_t events;
+        int timeoutMs;
+    };
+
+    struct SleepAwaiter : Waiter {
+        SleepAwaiter(Reactor* r, int m) : reactor(r), ms(m) {}
+
+        bool await_ready() const noexcept { return ms <= 0; }
+        void await_suspend(std::coroutine_handle<> h) {
+            handle = h;
+            reactor->sleep_(this);
+        }
+        void await_resume() const noexcept {}
+
+        Reactor* reactor;
+        int ms;
+    };
+
+    template <typename F>
+    struct OffloadAwaiter {
+        Reactor* reactor;
+        ThreadPool* pool;
+        F fn;
+        bool done;
+
+        bool await_ready() const noexcept { return pool == nullptr; }
+        bool await_suspend(std::coroutine_handle<> h) {
+            // 队列满时 addTask 返回 false, 协程立即恢复, fn 没有执行
+            return pool->addTask([this, h] {
+                fn();
+                done = true;
+                reactor->post(h);
+            });
+        }
+        bool await_resume() const noexcept { return done; }
+    };
+
+    FdAwaiter waitFd(int fd, uint32_t events, int timeoutMs = -1) { return FdAwaiter(this, fd, events, timeoutMs); }
+    void forgetFd(int fd);
+    SleepAwaiter sleep(int ms) { return SleepAwaiter(this, ms); }
+    template <typename F>
+    OffloadAwaiter<std::decay_t<F>> offload(ThreadPool* pool, F&& fn) {
+        return OffloadAwaiter<std::decay_t<F>>{this, pool, std::forward<F>(fn), false};
+    }
+    void post(std::coroutine_handle<> h);
+
+    static int setFdNonblock(int fd);
+
+private:
+    /* 连接所处的阶段, 各自对应 ConnLimits 中的一项时限 */
+    enum PHASE : uint8_t {
+        READ_HEADER,
+        READ_BODY,
+        IDLE,
+        WRITE,
+    };
+
+    void addClient(int fd, struct sockaddr_in addr);
+
+    void dealListen_();
+    void dealWrite_(ConnSlot* slot);
+    void dealRead_(ConnSlot* slot);
+
+    void onPoolFull_(RouteStats::LANE lane);
+    void reportStats_();
+    void sendError_(int fd, const char* info);
+    void updateDeadline_(ConnSlot* slot, bool progress);
+    void armTimer_(ConnSlot* slot);
+    void closeConn_(ConnSlot* slot);
+    void onTimeout_(ConnSlot* slot);
+    static uint64_t nowMs_();
+
+    void onRead_(ConnSlot* slot);
+    void onWrite_(ConnSlot* slot);
+    void afterWrite_(ConnSlot* slot, ssize_t ret, int writeErrno);
+    void waitRead_(ConnSlot* slot);
+    void waitWrite_(ConnSlot* slot);
+    void onIoDone_(ConnSlot* slot, uint32_t events, int res);
+    void dispatch_(ConnSlot* slot, bool progress);
+    RouteStats::LANE laneOf_(HttpConn* client, bool* cold);
+    Task<> serveCpu_(ConnSlot* slot, bool progress, RouteStats::LANE lane, bool cold);
+    void finishProcess_(ConnSlot* slot, bool progress, bool hasResponse);
+    Task<> serveIo_(ConnSlot* slot, bool progress);
+
+    bool watchFd_(FdAwaiter* waiter);
+    void sleep_(SleepAwaiter* waiter);
+    void onTimer_(TimerNode* node);
+    void runPosted_();
+    void wake_();
+    static void* tag_(void* waiter) { return reinterpret_cast<void*>(reinterpret_cast<uintptr_t>(waiter) | 1); }
+    static bool isTagged_(void* ptr) { return reinterpret_cast<uintptr_t>(ptr) & 1; }
+    template <typename T>
+    static T* untag_(void* ptr) { return reinterpret_cast<T*>(reinterpret_cast<uintptr_t>(ptr) & ~uintptr_t(1)); }
+
+private:
+    int listenFd_;
+    uint32_t listenEvent_;
+    uint32_t connEvent_;
+    ConnLimits limits_;
+    int minTimeout_;  // 各项时限中最短的, 都不限时为 -1
+    int cpu_;         // 绑定的 cpu, -1 为不绑定
+    std::atomic<bool> isClose_;
+
+    ThreadPool* lanes_[RouteStats::LANE_NUM];  // 各通道的线程池, 不持有, 由 WebServer 管理; LANE_INLINE 恒为 nullptr
+    size_t poolFullCnt_[RouteStats::LANE_NUM];  // 线程池队列满, 请求改在本线程处理的次数
+    std::string routeKey_;                     // laneOf_ 用的暂存, 只在本线程使用
+
+    int statsInterval_;  // <= 0 不输出统计
+    uint64_t nextStatsMs_;
+    ThreadPool::Stats lastStats_[RouteStats::LANE_NUM];
+    UserCache::Stats lastUserCache_;
+#ifdef WITH_MYSQL
+    SqlConnPool::Stats lastSqlPool_;
+#endif
+    int wakeFd_;  // eventfd, post 和 stop 时唤醒 wait
+    std::mutex postMtx_;
+    std::vector<std::coroutine_handle<>> posted_;
+    std::unique_ptr<TimingWheel> timer_;
+    std::unique_ptr<Poller> poller_;
+    bool asyncIo_;  // 连接的读写交给 Poller 提交
+    ConnSlab* slab_;
+};
+
+#endif  // REACTOR_H
@@ -1,24 +1,64 @@
 #include "webserver.h"
 
-WebServer::WebServer(int port, int trigMode, int timeout, bool optLinger,
+#include "../userstore/userstore.h"
+
+WebServer::WebServer(int port, int trigMode, const ConnLimits& limits, bool optLinger,
                      const char* sqlHost, int sqlPort, const char* sqlUser, const char* sqlPwd, const char* dbName,
-                     int connPoolNum, int threadNum,
-                     bool openLog, int logLevel, int logQueSize) : port_(port), openLinger_(optLinger), timeout_(timeout), timer_(new HeapTimer()), threadpool_(new ThreadPool(threadNum)), epoller_(new Epoller()) {
+                     int connPoolNum, int threadNum, int ioThreadNum, int reactorNum, bool useUring, int sendfileThreshold,
+                     bool openLog, int logLevel, int logQueSize, const char* topologyConf, const char* userStore) : port_(port), openLinger_(optLinger), limits_(limits) {
+    // 日志最先初始化, 后面读配置、建 socket 出错时才能记下来
+    if (openLog) {
+        Log::instance()->init(logLevel, "./logs", ".log", logQueSize);
+    }
+    if (topologyConf) {
+        if (affinity_.load(topologyConf)) {
+            Log::instance()->setWriteThreadAffinity(affinity_.logCpus());
+        } else {
+            LOG_WARN("Topology config %s not loaded, threads are not pinned", topologyConf);
+        }
+    }
+
     srcDir_ = getcwd(nullptr, 256);
     assert(srcDir_);
     strncat(srcDir_, "/resources/", 16);
     HttpConn::userCount = 0;
     HttpConn::srcDir = srcDir_;
-    SqlConnPool::instance()->init(sqlHost, sqlPort, sqlUser, sqlPwd, dbName, connPoolNum);
+    HttpConn::maxRequests = limits_.maxRequests;
+    HttpConn::keepAliveTimeout = limits_.idleTimeout / 1000;  // 向下取整, 不宣告比实际更长的时间
+    FileCache::instance()->init(srcDir_, &HttpResponse::fileMeta, sendfileThreshold > 0 ? sendfileThreshold : 0);
+    bool storeOk = UserStore::init(userStore);
+    UserStore* store = UserStore::instance();
+    if (storeOk && store->blocking() && ioThreadNum <= 0) {
+        // 会阻塞的后端只能在 IO 通道上执行, 没有 IO 通道时登录注册都会被拒绝
+        LOG_ERROR("User store %s blocks, IO lane threads must be > 0", UserStore::kindName(store->kind()));
+        storeOk = false;
+    }
+#ifdef WITH_MYSQL
+    if (store->kind() == UserStore::STORE_MYSQL) {
+        SqlConnPool::instance()->init(sqlHost, sqlPort, sqlUser, sqlPwd, dbName, connPoolNum, -1, SQL_WAIT_TIMEOUT);
+    }
+#endif
+    UserCache::instance()->init(USER_CACHE_TTL, USER_NEGATIVE_TTL);
+
+    if (reactorNum < 1) {
+        reactorNum = 1;
+    }
+    if (reactorNum == 1) {
+        // 单 Reactor: 主线程负责事件分发和读写, 耗时的请求交给 CPU 通道
+        cpuPool_.reset(new ThreadPool(threadNum, 4096, affinity_.workerCpus()));
+    }
+    if (ioThreadNum > 0 && store->blocking()) {
+        // 用户存储会阻塞(没有非阻塞接口的 MySQL 客户端、SQLite)时, 单独一组线程, 不占 CPU 通道和 Reactor
+        ioPool_.reset(new ThreadPool(ioThreadNum, 4096, affinity_.ioCpus()));
+    }
 
     isClose_ = false;
     initEventMode_(trigMode);
-    if (!initSocket_()) {
+    if (!storeOk || !initSocket_(reactorNum, useUring)) {
         isClose_ = true;
     }
 
     if (openLog) {
-        Log::instance()->init(logLevel, "./logs", ".log", logQueSize);
         if (isClose_) {
             LOG_ERROR("========== Server init error!==========");
         } else {
@@ -27,63 +67,87 @@ WebServer::WebServer(int port, int trigMode, int timeout, bool optLinger,
             LOG_INFO("Listen Mode: %s, OpenConn Mode: %s",
                      (listenEvent_ & EPOLLET ? "ET" : "LT"),
                      (connEvent_ & EPOLLET ? "ET" : "LT"));
+            LOG_INFO("IO Backend: %s, sendfile threshold: %d", reactors_[0]->ioBackend(), sendfileThreshold);
+            LOG_INFO("Timeout(ms) header: %d, idle: %d, write: %d, min send rate: %d B/s, max requests: %d",
+                     limits_.headerTimeout, limits_.idleTimeout, limits_.writeTimeout, limits_.minSendRate, limits_.maxRequests);
             LOG_INFO("LogSys level: %d", logLevel);
             LOG_INFO("srcDir: %s", HttpConn::srcDir);
-            LOG_INFO("SqlConnPool num: %d, ThreadPool num: %d", connPoolNum, threadNum);
+            LOG_INFO("User store: %s, %s", UserStore::kindName(store->kind()), store->blocking() ? "blocking, on IO lane" : "non-blocking, on reactor");
+#ifdef WITH_MYSQL
+            if (store->kind() == UserStore::STORE_MYSQL) {
+                SqlConnPool::Stats sp = SqlConnPool::instance()->stats();
+                LOG_INFO("SqlConnPool conns: [%d, %d], wait timeout(ms): %d", sp.minConn, sp.maxConn, SQL_WAIT_TIMEOUT);
+            }
+#endif
+            LOG_INFO("CPU lane threads: %d, IO lane threads: %d, Reactor num: %d",
+                     cpuPool_ ? threadNum : 0, ioPool_ ? ioThreadNum : 0, reactorNum);
+            LOG_INFO("UserCache ttl(ms): %d, negative ttl(ms): %d", USER_CACHE_TTL, USER_NEGATIVE_TTL);
+            for (int i = 0; i < reactorNum; i++) {
+                int cpu = affinity_.reactorCpu(i);
+                if (cpu >= 0) {
+                    LOG_INFO("Reactor[%d] cpu: %d, node: %d", i, cpu, CpuAffinity::cpuNode(cpu));
+                }
+            }
         }
     }
 }
 
 WebServer::~WebServer() {
-    close(listenFd_);
     isClose_ = true;
+    for (auto& reactor : reactors_) {
+        reactor->stop();
+    }
+    for (auto& t : reactorThreads_) {
+        if (t.joinable()) {
+            t.join();
+        }
+    }
+    for (int fd : listenFds_) {
+        close(fd);
+    }
+    FileCache::instance()->close();
     free(srcDir_);
+#ifdef WITH_MYSQL
     SqlConnPool::instance()->close();
+#endif
 }
 
 void WebServer::start() {
-    int timeout = -1;
-    if (!isClose_) {
-        LOG_INFO("========== Server start ==========");
+    if (isClose_) {
+        return;
     }
-    while (!isClose_) {
-        if (timeout_ > 0) {
-            timeout = timer_->getNextTick();
-        }
-        int eventCnt = epoller_->wait(timeout);
-        for (int i = 0; i < eventCnt; i++) {
-            int fd = epoller_->getEventFd(i);
-            uint32_t events = epoller_->getEvents(i);
-            if (fd == listenFd_) {
-                dealListen_();
-            } else if (events & (EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
-                assert(users_.count(fd) > 0);
-                closeConn_(&users_[fd]);
-            } else if (events & EPOLLIN) {
-                assert(users_.count(fd) > 0);
-                dealRead_(&users_[fd]);
-            } else if (events & EPOLLOUT) {
-                assert(users_.count(fd) > 0);
-                dealWrite_(&users_[fd]);
-            } else {
-                LOG_ERROR("Unexpected Event");
-            }
-        }
+    LOG_INFO("========== Server start ==========");
+    // reactors_[0] 在主线程上运行, 其余各占一个线程, 连接 accept 之后不再跨线程
+    for (size_t i = 1; i < reactors_.size(); i++) {
+        reactorThreads_.emplace_back(&Reactor::loop, reactors_[i].get());
     }
+    reactors_[0]->loop();
 }
 
-int WebServer::setFdNonblock(int fd) {
-    assert(fd > 0);
-    return fcntl(fd, F_SETFL, fcntl(fd, F_GETFD, 0) | O_NONBLOCK);  // fcntl(fd, F_GETFD, 0)是获取当前fd状态标志，再设置为nonblock
-}
-
-bool WebServer::initSocket_() {
-    int ret;
-    struct sockaddr_in addr;
+bool WebServer::initSocket_(int reactorNum, bool useUring) {
     if (port_ > 65535 || port_ < 1024) {
         LOG_ERROR("Port:%d Error!", port_);
         return false;
     }
+    /* 多 Reactor 时每个 Reactor 各自 listen 同一端口, 由内核按 SO_REUSEPORT 分发连接 */
+    bool reusePort = reactorNum > 1;
+    for (int i = 0; i < reactorNum; i++) {
+        int cpu = affinity_.reactorCpu(i);
+        int fd = createListenFd_(reusePort, cpu);
+        if (fd < 0) {
+            return false;
+        }
+        listenFds_.push_back(fd);
+        reactors_.emplace_back(new Reactor(fd, listenEvent_, connEvent_, limits_, cpuPool_.get(), ioPool_.get(), useUring, cpu));
+    }
+    reactors_[0]->enableStats(STATS_INTERVAL);  // 线程池和用户缓存为所有 Reactor 共用, 一个输出即可
+    LOG_INFO("Server Port:%d", port_);
+    return true;
+}
+
+int WebServer::createListenFd_(bool reusePort, int cpu) {
+    int ret;
+    struct sockaddr_in addr;
     addr.sin_family = AF_INET;
     addr.sin_addr.s_addr = htonl(INADDR_ANY);
     addr.sin_port = htons(port_);
@@ -94,51 +158,59 @@ bool WebServer::initSocket_() {
         optLinger.l_linger = 1;
     }
 
-    listenFd_ = socket(AF_INET, SOCK_STREAM, 0);
-    if (listenFd_ < 0) {
+    int listenFd = socket(AF_INET, SOCK_STREAM, 0);
+    if (listenFd < 0) {
         LOG_ERROR("Create Socket Error!");
-        return false;
+        return -1;
     }
 
-    ret = setsockopt(listenFd_, SOL_SOCKET, SO_LINGER, &optLinger, sizeof(optLinger));
+    ret = setsockopt(listenFd, SOL_SOCKET, SO_LINGER, &optLinger, sizeof(optLinger));
     if (ret < 0) {
         LOG_ERROR("Init Linger Error!");
-        close(listenFd_);
-        return false;
+        close(listenFd);
+        return -1;
     }
 
     int optval = 1;
     // 端口复用
-    ret = setsockopt(listenFd_, SOL_SOCKET, SO_REUSEADDR, (const void*)&optval, sizeof(int));
+    ret = setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, (const void*)&optval, sizeof(int));
     if (ret == -1) {
         LOG_ERROR("Set Socket Setsockopt Error!");
-        close(listenFd_);
-        return false;
+        close(listenFd);
+        return -1;
+    }
+
+    if (reusePort) {
+        ret = setsockopt(listenFd, SOL_SOCKET, SO_REUSEPORT, (const void*)&optval, sizeof(int));
+        if (ret == -1) {
+            LOG_ERROR("Set SO_REUSEPORT Error!");
+            close(listenFd);
+            return -1;
+        }
+        /*
+         * Reactor 绑了核时, 让内核优先把在该 cpu 上收包(网卡中断/RPS)的连接分给它,
+         * 连接从软中断到读写都在同一个 cpu 上. 失败不影响正确性
+         */
+        if (cpu >= 0 && setsockopt(listenFd, SOL_SOCKET, SO_INCOMING_CPU, &cpu, sizeof(cpu)) == -1) {
+            LOG_WARN("Set SO_INCOMING_CPU %d Error!", cpu);
+        }
     }
 
-    ret = bind(listenFd_, (struct sockaddr*)&addr, sizeof(addr));
+    ret = bind(listenFd, (struct sockaddr*)&addr, sizeof(addr));
     if (ret < 0) {
         LOG_ERROR("Bind Port:%d Error!", port_);
-        close(listenFd_);
-        return false;
+        close(listenFd);
+        return -1;
     }
 
-    ret = listen(listenFd_, 6);
+    ret = listen(listenFd, SOMAXCONN);  // 登录等请求可能成千上万地并发涌入
     if (ret < 0) {
         LOG_ERROR("Listen Port:%d Error!", port_);
-        close(listenFd_);
-        return false;
+        close(listenFd);
+        return -1;
     }
-
-    ret = epoller_->addFd(listenFd_, listenEvent_ | EPOLLIN);
-    if (ret == 0) {
-        LOG_ERROR("Add Listen Error!");
-        close(listenFd_);
-        return false;
-    }
-    setFdNonblock(listenFd_);
-    LOG_INFO("Server Port:%d", port_);
-    return true;
+    Reactor::setFdNonblock(listenFd);
+    return listenFd;
 }
 
 void WebServer::initEventMode_(int trigMode) {
@@ -162,105 +234,5 @@ void WebServer::initEventMode_(int trigMode) {
             connEvent_ |= EPOLLET;
             break;
     }
+    HttpConn::isET = (connEvent_ & EPOLLET);
 }
-
-void WebServer::addClient(int fd, struct sockaddr_in addr) {
-    assert(fd > 0);
-    users_[fd].init(fd, addr);
-    if (timeout_ > 0) {
-        timer_->add(fd, timeout_, std::bind(&WebServer::closeConn_, this, &users_[fd]));
-    }
-    epoller_->addFd(fd, EPOLLIN | connEvent_);
-    setFdNonblock(fd);
-    LOG_INFO("Client[%d] In!", users_[fd].getFd());
-}
-
-void WebServer::dealListen_() {
-    struct sockaddr_in addr;
-    socklen_t len = sizeof(addr);
-    do {
-        int fd = accept(listenFd_, (struct sockaddr*)&addr, &len);
-        if (fd <= 0) {
-            return;
-        } else if (HttpConn::userCount >= MAX_FD) {
-            sendError_(fd, "Server Busy!");
-            LOG_WARN("Server Busy!");
-            return;
-        }
-        addClient(fd, addr);
-    } while (listenEvent_ & EPOLLET);
-}
-
-void WebServer::dealWrite_(HttpConn* client) {
-    assert(client);
-    extentTime_(client);
-    threadpool_->addTask(std::bind(&WebServer::onWrite_, this, client));
-}
-
-void WebServer::dealRead_(HttpConn* client) {
-    assert(client);
-    extentTime_(client);
-    threadpool_->addTask(std::bind(&WebServer::onRead_, this, client));
-}
-
-void WebServer::sendError_(int fd, const char* info) {
-    assert(fd > 0);
-    int ret = send(fd, info, strlen(info), 0);
-    if (ret < 0) {
-        LOG_WARN("Send Error To Client[%d] Error!", fd);
-    }
-    close(fd);
-}
-
-void WebServer::extentTime_(HttpConn* client) {
-    assert(client);
-    if (timeout_ > 0) {
-        timer_->adjust(client->getFd(), timeout_);
-    }
-}
-
-void WebServer::closeConn_(HttpConn* client) {
-    assert(client);
-    LOG_INFO("Client[%d] quit!", client->getFd());
-    epoller_->delFd(client->getFd());
-    client->close();
-}
-
-void WebServer::onRead_(HttpConn* client) {
-    assert(client);
-    int ret = -1;
-    int readErrno = 0;
-    ret = client->read(&readErrno);
-    if (ret <= 0 && readErrno != EAGAIN) {
-        closeConn_(client);
-        return;
-    }
-    onProcess(client);
-}
-
-void WebServer::onWrite_(HttpConn* client) {
-    assert(client);
-    int ret = -1;
-    int writeErrno = 0;
-    ret = client->write(&writeErrno);
-    if (client->toWriteBytes() == 0) {
-        if (client->isKeepAlive()) {
-            onProcess(client);
-            return;
-        }
-    } else if (ret < 0) {
-        if (writeErrno == EAGAIN) {
-            epoller_->modFd(client->getFd(), connEvent_ | EPOLLOUT);
-            return;
-        }
-    }
-    closeConn_(client);
-}
-
-void WebServer::onProcess(HttpConn* client) {
-    if (client->process()) {
-        epoller_->modFd(client->getFd(), connEvent_ | EPOLLOUT);
-    } else {
-        epoller_->modFd(client->getFd(), connEvent_ | EPOLLIN);
-    }
-}
\ No newline at end of file
@@ -8,59 +8,51 @@
 #include <unistd.h>
 
 #include <cassert>
-#include <unordered_map>
+#include <thread>
+#include <vector>
 
-#include "../epoller/epoller.h"
 #include "../http/httpconn.h"
 #include "../log/log.h"
 #include "../threadpool/threadpool.h"
-#include "../timer/heaptimer.h"
+#include "reactor.h"
 
 class WebServer {
 public:
-    WebServer(int port, int trigMode, int timeout, bool optLinger,
+    WebServer(int port, int trigMode, const ConnLimits& limits, bool optLinger,
               const char* sqlHost, int sqlPort, const char* sqlUser, const char* sqlPwd, const char* dbName,
-              int connPollNum, int threadNum,
-              bool openLog, int logLevel, int logQueSize);
+              int connPollNum, int threadNum, int ioThreadNum, int reactorNum, bool useUring, int sendfileThreshold,
+              bool openLog, int logLevel, int logQueSize, const char* topologyConf = nullptr,
+              const char* userStore = "mysql");
     ~WebServer();
 
     void start();
 
 private:
-    static const int MAX_FD = 65535;
-    static int setFdNonblock(int fd);
-
-    bool initSocket_();
+    bool initSocket_(int reactorNum, bool useUring);
+    int createListenFd_(bool reusePort, int cpu);
     void initEventMode_(int trigMode);
-    void addClient(int fd, struct sockaddr_in addr);
-
-    void dealListen_();
-    void dealWrite_(HttpConn* client);
-    void dealRead_(HttpConn* client);
-
-    void sendError_(int fd, const char* info);
-    void extentTime_(HttpConn* client);
-    void closeConn_(HttpConn* client);
-
-    void onRead_(HttpConn* client);
-    void onWrite_(HttpConn* client);
-    void onProcess(HttpConn* client);
 
 private:
     int port_;
     bool openLinger_;
-    int timeout_;
+    ConnLimits limits_;
+    CpuAffinity affinity_;  // 没有配置文件时为空, 线程都不绑定
     bool isClose_;
-    int listenFd_;
     char* srcDir_;
 
     uint32_t listenEvent_;
     uint32_t connEvent_;
 
-    std::unique_ptr<HeapTimer> timer_;
-    std::unique_ptr<ThreadPool> threadpool_;
-    std::unique_ptr<Epoller> epoller_;
-    std::unordered_map<int, HttpConn> users_;
+    static const int STATS_INTERVAL = 10000;  // 通道和用户缓存统计写日志的间隔, 毫秒
+    static const int USER_CACHE_TTL = 60000;    // 用户缓存有效期, 毫秒; 库里的密码被别处修改后最多这么久才生效
+    static const int USER_NEGATIVE_TTL = 5000;  // 不存在的用户缓存得短些, 别的实例注册后很快就能登录
+    static const int SQL_WAIT_TIMEOUT = 1000;   // 取数据库连接最多等这么久, 超时回 503
+
+    std::unique_ptr<ThreadPool> cpuPool_;  // CPU 通道, 单 Reactor 模式下才有
+    std::unique_ptr<ThreadPool> ioPool_;   // 阻塞 IO 通道(查用户存储), 所有 Reactor 共用; 用户存储不阻塞时不需要
+    std::vector<int> listenFds_;              // 每个 Reactor 一个监听 fd (SO_REUSEPORT)
+    std::vector<std::unique_ptr<Reactor>> reactors_;
+    std::vector<std::thread> reactorThreads_;
 };
 
-#endif  // WEBSERVER_H
\ No newline at end of file
+#endif  // WEBSERVER_H